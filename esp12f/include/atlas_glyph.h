@@ -0,0 +1,16 @@
+#ifndef ATLAS_GLYPH_H
+#define ATLAS_GLYPH_H
+
+#include <Arduino.h>
+
+// A pre-scaled glyph generated by tools/gen_glyph_atlas.py (see
+// glyph_atlas.h). All metrics are already multiplied by ATLAS_SCALE.
+struct AtlasGlyph {
+  uint16_t column;  // first entry in ATLAS_COLUMNS
+  uint8_t width;    // columns
+  uint8_t xAdvance;
+  int8_t xOffset;
+  int8_t yOffset;   // top row relative to the baseline
+};
+
+#endif // ATLAS_GLYPH_H
@@ -0,0 +1,40 @@
+#ifndef COUNTING_DISPLAY_H
+#define COUNTING_DISPLAY_H
+
+#include <Adafruit_SSD1306.h>
+
+// Adafruit_SSD1306 that counts the primitive pixel operations Adafruit_GFX
+// reduces everything to (pixels, horizontal and vertical spans), so draw()
+// can report how much work a frame took next to its time. Writes that go
+// straight to the buffer (background copy, atlas text) are not counted.
+
+struct PixelOps {
+  uint32_t pixels;
+  uint32_t hlines;
+  uint32_t vlines;
+};
+
+class CountingSSD1306 : public Adafruit_SSD1306 {
+public:
+  CountingSSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst)
+      : Adafruit_SSD1306(w, h, twi, rst), ops() {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    ops.pixels++;
+    Adafruit_SSD1306::drawPixel(x, y, color);
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w,
+                     uint16_t color) override {
+    ops.hlines++;
+    Adafruit_SSD1306::drawFastHLine(x, y, w, color);
+  }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h,
+                     uint16_t color) override {
+    ops.vlines++;
+    Adafruit_SSD1306::drawFastVLine(x, y, h, color);
+  }
+
+  PixelOps ops; // reset by the caller at the start of a frame
+};
+
+#endif // COUNTING_DISPLAY_H
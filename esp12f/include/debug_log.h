@@ -0,0 +1,50 @@
+#ifndef DEBUG_LOG_H
+#define DEBUG_LOG_H
+
+#include <Arduino.h>
+
+// Where the GPS and the debug log live.
+//
+// GPS_HW_UART 0: GPS on SoftwareSerial (GPIO12 RX / GPIO13 TX), log on
+//                UART0 as before.
+// GPS_HW_UART 1: GPS on UART0 swapped to GPIO13 (RX) / GPIO15 (TX), so the
+//                NMEA stream is received by the UART FIFO + interrupt-fed
+//                ring buffer instead of bit-banged. Wire the GPS TX to
+//                GPIO13 and its RX to GPIO15.
+//
+// With the GPS on UART0 the log moves to UART1, which is TX-only on GPIO2.
+// GPIO2 is also the OLED SDA on this board, so LOG_UART1 defaults to off
+// and the log is compiled out; set it to 1 once the OLED is moved.
+
+#ifndef GPS_HW_UART
+#define GPS_HW_UART 0
+#endif
+#ifndef LOG_UART1
+#define LOG_UART1 0
+#endif
+
+#define LOG_BAUD 115200
+
+#if !GPS_HW_UART
+#define LOG Serial
+#elif LOG_UART1
+#define LOG Serial1
+#else
+class NullLog : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t n) override { return n; }
+};
+inline NullLog nullLog;
+#define LOG nullLog
+#endif
+
+inline void logBegin() {
+#if !GPS_HW_UART
+  Serial.begin(LOG_BAUD);
+#elif LOG_UART1
+  Serial1.begin(LOG_BAUD);
+#endif
+}
+
+#endif // DEBUG_LOG_H
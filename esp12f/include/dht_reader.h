@@ -0,0 +1,66 @@
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include <Arduino.h>
+
+// Interrupt-driven DHT11 reader.
+//
+// The Adafruit driver bit-bangs the whole 40-bit frame with interrupts off
+// (~5 ms per read). Here loop() only drives the start pulse and releases
+// the line; a CHANGE interrupt stamps every edge with the CPU cycle counter
+// and the frame is decoded afterwards from the high-pulse widths (~27 us
+// = 0, ~70 us = 1). Nothing waits: the 20 ms start pulse and the ~5 ms
+// frame elapse across loop() passes.
+
+#define DHT_INTERVAL_MS 2000 // DHT11 needs >= 1 s between reads
+#define DHT_START_MS 20      // host start pulse (>= 18 ms)
+#define DHT_CAPTURE_MS 10    // response + 40 bits take ~5 ms
+#define DHT_MAX_EDGES 96     // 85 expected
+#define DHT_ONE_US 50        // high pulse longer than this is a 1
+
+struct DhtStats {
+  uint32_t reads;
+  uint32_t failed; // no response, short frame or bad checksum
+  uint8_t lastEdges;
+  uint16_t busyMicros; // CPU time loop() spent on the last read
+  uint16_t maxBusyMicros;
+};
+
+class DhtReader {
+public:
+  explicit DhtReader(uint8_t pin);
+
+  void begin();
+
+  // Advances the read cycle; true once per finished read (ok or not)
+  bool loop(unsigned long now);
+
+  bool ok() const { return _ok; }
+  int16_t tempTenths() const { return _temp; } // valid when ok()
+  int16_t humTenths() const { return _hum; }
+  float temperature() const { return _ok ? _temp * 0.1f : NAN; }
+  float humidity() const { return _ok ? _hum * 0.1f : NAN; }
+  const DhtStats &stats() const { return _stats; }
+  void print(Print &out) const;
+
+  // Decodes a captured edge list (stamp | level in bit 0, cycle counts)
+  static bool decode(const uint32_t *edges, uint8_t count,
+                     uint32_t cyclesPerUs, uint8_t data[5]);
+
+private:
+  static void IRAM_ATTR onEdge(void *arg);
+  bool finish();
+
+  enum State { DHT_IDLE, DHT_START, DHT_CAPTURE };
+
+  uint8_t _pin;
+  State _state;
+  unsigned long _stateStart;
+  volatile uint8_t _count;
+  uint32_t _edges[DHT_MAX_EDGES];
+  bool _ok;
+  int16_t _temp, _hum; // tenths of a degree / percent
+  DhtStats _stats;
+};
+
+#endif // DHT_READER_H
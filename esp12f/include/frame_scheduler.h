@@ -0,0 +1,54 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Coalescing render scheduler.
+//
+// Subsystems call request() when they change something visible; loop()
+// calls due() once per pass and renders a single frame if anything asked
+// for one and the FPS cap allows it. Requests made while a frame is being
+// held back by the cap are merged into the next frame.
+
+class FrameScheduler {
+public:
+  explicit FrameScheduler(uint8_t maxFps)
+      : _dirty(false), _lastFrame(0), _requested(0), _produced(0) {
+    setMaxFps(maxFps);
+  }
+
+  void setMaxFps(uint8_t fps) {
+    _maxFps = fps ? fps : 1;
+    _minInterval = 1000UL / _maxFps;
+  }
+  uint8_t maxFps() const { return _maxFps; }
+
+  void request() {
+    _dirty = true;
+    _requested++;
+  }
+
+  // True if a frame should be rendered now; marks it as produced.
+  bool due(unsigned long now) {
+    if (!_dirty || now - _lastFrame < _minInterval)
+      return false;
+    _dirty = false;
+    _lastFrame = now;
+    _produced++;
+    return true;
+  }
+
+  bool pending() const { return _dirty; }
+  uint32_t requested() const { return _requested; }
+  uint32_t produced() const { return _produced; }
+
+private:
+  bool _dirty;
+  uint8_t _maxFps;
+  unsigned long _minInterval;
+  unsigned long _lastFrame;
+  uint32_t _requested;
+  uint32_t _produced;
+};
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,98 @@
+#ifndef GPS_CONFIG_H
+#define GPS_CONFIG_H
+
+#include "gps_input.h"
+#include <Arduino.h>
+#include <TinyGPSPlus.h>
+
+// Boot-time GPS module setup, run from loop() without blocking it.
+//
+// probe   wait for a valid NMEA sentence at GPS_BAUD; if none arrives, try
+//         GPS_TARGET_BAUD (module kept its settings across an ESP reset)
+// filter  only RMC + GGA: UBX CFG-MSG for u-blox, else PMTK314 for MTK
+// baud    UBX CFG-PRT / PMTK251, then confirmed by a valid sentence at the
+//         new rate; reverted to GPS_BAUD if none arrives
+// rate    UBX CFG-RATE / PMTK220 to GPS_RATE_HZ
+//
+// Every command waits for its ACK (UBX ACK-ACK / $PMTK001,...,3) with one
+// retry. A module that answers neither protocol, or a step that is never
+// acknowledged, simply stops the sequence: the GPS keeps working with
+// whatever settings it has, at worst the 1 Hz / 9600 baud defaults.
+// Nothing is written to the module's flash; the setup is redone each boot.
+
+#ifndef GPS_CONFIG
+#define GPS_CONFIG 1
+#endif
+
+#if GPS_HW_UART
+#define GPS_TARGET_BAUD 115200
+#else
+#define GPS_TARGET_BAUD 38400 // SoftwareSerial is unreliable above this
+#endif
+#define GPS_RATE_HZ 5 // NEO-6M maximum
+
+#define GPS_PROBE_TIMEOUT 1500 // a 1 Hz module always talks within this
+#define GPS_ACK_TIMEOUT 500
+#define GPS_BAUD_SETTLE 100 // command on the wire + module switching
+
+enum GpsProto { GPS_PROTO_NONE, GPS_PROTO_UBX, GPS_PROTO_PMTK };
+
+class GpsConfig : public GpsTap {
+public:
+  GpsConfig(GpsInput &in, const TinyGPSPlus &gps);
+
+  void begin(unsigned long now);
+  void loop(unsigned long now);
+
+  bool done() const { return _state == GPSCFG_DONE; }
+  uint8_t rateHz() const { return _rateHz; }
+  void print(Print &out) const;
+
+  void onByte(uint8_t c) override;
+
+private:
+  enum State {
+    GPSCFG_IDLE,
+    GPSCFG_PROBE,
+    GPSCFG_PROBE_FAST,
+    GPSCFG_ACK,
+    GPSCFG_BAUD,
+    GPSCFG_VERIFY,
+    GPSCFG_DONE,
+  };
+  enum Step { STEP_FILTER, STEP_BAUD, STEP_RATE, STEP_END };
+  enum Ack { ACK_WAIT, ACK_OK, ACK_NAK };
+
+  void enter(State next, unsigned long now);
+  void sendStep(unsigned long now);
+  void nextStep(unsigned long now);
+  void finish(const char *result, unsigned long now);
+  void sendUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+  void sendPmtk(const char *body);
+  bool sentenceSeen() const { return _gps.passedChecksum() != _sentences; }
+
+  GpsInput &_in;
+  const TinyGPSPlus &_gps;
+  State _state;
+  unsigned long _stateStart;
+  unsigned long _began;
+  unsigned long _tookMs;
+  uint32_t _sentences; // passedChecksum() when the current state began
+  GpsProto _proto;
+  Step _step;
+  uint8_t _sub; // UBX: which CFG-MSG of the filter step
+  uint8_t _retries;
+  uint8_t _rateHz;
+  const char *_result;
+
+  // ACK matching
+  Ack _ack;
+  uint8_t _ackCls, _ackId; // UBX message being acknowledged
+  uint16_t _ackPmtk;       // PMTK command being acknowledged
+  uint8_t _ubx[10];
+  uint8_t _ubxPos;
+  char _line[20];
+  uint8_t _lineLen;
+};
+
+#endif // GPS_CONFIG_H
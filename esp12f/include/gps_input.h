@@ -0,0 +1,62 @@
+#ifndef GPS_INPUT_H
+#define GPS_INPUT_H
+
+#include "debug_log.h"
+#include <Arduino.h>
+#include <TinyGPSPlus.h>
+
+// NMEA byte source for TinyGPS++: SoftwareSerial or the swapped hardware
+// UART0 (see GPS_HW_UART in debug_log.h).
+//
+// The counters are there to prove nothing is lost: overruns count RX buffer
+// overflows (SoftwareSerial overflow() / UART hasOverrun()), rxErrors count
+// UART framing/parity errors, and maxBacklog is the deepest the buffer got
+// between two polls.
+
+#define GPS_BAUD 9600
+#define GPS_RX_BUFFER 1024 // UART ring buffer, ~1 s of NMEA at 9600 baud
+#define GPS_BURST_GAP_MS 20 // silence longer than this starts a new burst
+
+// Sees every received byte ahead of the parser (GpsConfig watches for ACKs)
+class GpsTap {
+public:
+  virtual void onByte(uint8_t c) = 0;
+};
+
+struct GpsLinkStats {
+  uint32_t bytes;
+  uint32_t overruns;
+  uint32_t rxErrors;
+  uint16_t maxBacklog;
+};
+
+class GpsInput {
+public:
+  GpsInput(uint8_t rxPin, uint8_t txPin);
+
+  void begin(unsigned long baud = GPS_BAUD);
+  void setBaud(unsigned long baud);
+  unsigned long baud() const { return _baud; }
+  void setTap(GpsTap *tap) { _tap = tap; }
+
+  // Feeds everything received so far into the parser
+  void poll(TinyGPSPlus &gps);
+
+  Stream &port();
+  uint16_t bufferSize() const;
+  const GpsLinkStats &stats() const { return _stats; }
+  void print(Print &out, const TinyGPSPlus &gps) const;
+
+  // The module sends one burst of sentences per fix; these time it (millis)
+  unsigned long burstStart() const { return _burstStart; }
+  unsigned long lastByteAt() const { return _lastByteAt; }
+
+private:
+  GpsLinkStats _stats;
+  unsigned long _burstStart;
+  unsigned long _lastByteAt;
+  unsigned long _baud;
+  GpsTap *_tap;
+};
+
+#endif // GPS_INPUT_H
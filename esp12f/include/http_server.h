@@ -0,0 +1,185 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+
+// Event-driven HTTP server for the dashboard and the setup portal.
+//
+// ESP8266WebServer serves one client at a time and holds loop() while it
+// reads the request and writes the response, so a slow phone stalls the
+// OLED and the GPS drain for as long as its request takes. Here each
+// connection sits in a slot and loop() moves every slot along by whatever
+// the socket allows, never waiting:
+//   accept -> read request -> route -> write response -> drain -> close
+//
+// At most HTTP_MAX_CONNS connections are served at once; more wait in the
+// lwIP accept backlog. Every slot has an HTTP_BUF_SIZE buffer from a fixed
+// pool: the request is read into it, then the response head (and a small
+// body) is built into it. Large bodies (web assets) are streamed straight
+// from flash. Responses are HTTP/1.1 with "Connection: close".
+//
+// Long generated bodies (/metrics, /frame.pbm) come from an HttpFill
+// callback instead: write() has it render the next piece into the slot
+// buffer whenever the last one is out, so the body goes out as fast as the
+// client acks it without loop() ever waiting on the socket. The callback's
+// state (a cursor, plus a few bytes copied at sendGenerated()) lives in
+// the slot. Handlers that keep the connection (SSE, track export) use
+// client() and then detach() (or done() once they wrote a response).
+
+#define HTTP_MAX_CONNS 4
+#define HTTP_BUF_SIZE 768         // request, or response head + small body
+#define HTTP_HEADER_BYTES 160     // sendHeader() lines per response
+#define HTTP_MAX_ROUTES 12
+#define HTTP_READ_TIMEOUT 3000    // whole request must arrive within this
+#define HTTP_WRITE_TIMEOUT 10000  // client stopped reading
+#define HTTP_DRAIN_TIMEOUT 2000   // waiting for the last bytes to be acked
+
+enum HttpMethod : uint8_t { METHOD_ANY, METHOD_GET, METHOD_POST };
+
+struct HttpStats {
+  uint32_t accepted;
+  uint32_t responses;
+  uint32_t handedOff; // detach(): kept by SSE / track export
+  uint32_t badRequests; // malformed, too large, unknown route
+  uint32_t timeouts;
+  uint8_t maxActive;
+};
+
+class HttpServer;
+
+// Renders the next piece of a generated body into buf (at most room bytes)
+// and returns its length, 0 once the body is complete. cursor starts at 0;
+// it and state (the bytes given to sendGenerated()) are kept in the slot
+// between calls.
+typedef size_t (*HttpFill)(char *buf, size_t room, void *state,
+                           uint32_t &cursor);
+
+// Print into an HttpFill buffer a part at a time: commit() keeps what was
+// printed since the last commit if all of it fit, else drops it so the
+// part goes out whole in the next piece. A part must fit in an empty one.
+class HttpChunk : public Print {
+public:
+  HttpChunk(char *buf, size_t room)
+      : _buf(buf), _room(room), _len(0), _committed(0), _full(false) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *p, size_t n) override;
+  using Print::write;
+
+  bool commit(); // false if the part did not fit: the piece is done
+  size_t length() const { return _committed; }
+
+private:
+  char *_buf;
+  size_t _room, _len, _committed;
+  bool _full;
+};
+
+class HttpRequest {
+public:
+  HttpMethod method() const { return _method; }
+  const char *path() const { return _path; }
+  bool hasArg(const char *name) const;
+  String arg(const char *name) const; // URL-decoded, "" if absent
+  const char *ifNoneMatch() const { return _ifNoneMatch; }
+  bool acceptsGzip() const { return _gzip; }
+
+  // Extra response headers, before send()
+  void sendHeader(const __FlashStringHelper *name, const char *value);
+  void sendHeader(const __FlashStringHelper *name,
+                  const __FlashStringHelper *value);
+
+  // body is copied into the slot buffer and has to fit in it
+  void send(int code, const char *type = nullptr, const char *body = nullptr,
+            size_t len = 0);
+  // body stays in flash and is streamed from there
+  void send_P(int code, const char *type, PGM_P body, size_t len);
+  // body rendered by fill() a buffer at a time as the socket drains.
+  // stateLen bytes of state are copied into the slot for fill() (the rest
+  // of the buffer is its room). len is the Content-Length if known; 0
+  // leaves it out and the close ends the body.
+  void sendGenerated(int code, const char *type, HttpFill fill,
+                     const void *state = nullptr, size_t stateLen = 0,
+                     size_t len = 0);
+
+  // The raw connection, for handlers that hand it over or write their own
+  // response (blocking on the socket: keep those small)
+  WiFiClient &client() { return _client; }
+  void detach(); // someone else keeps the connection open
+  void done();   // the handler wrote the whole response; close when sent
+
+private:
+  friend class HttpServer;
+  enum State : uint8_t { FREE, READ, WRITE, DRAIN };
+
+  bool findArg(const char *name, const char *&value, size_t &len) const;
+  void appendHeader(const char *line, size_t n);
+  size_t fillRoom() const { return HTTP_BUF_SIZE - _stateLen; }
+
+  WiFiClient _client;
+  State _state;
+  HttpMethod _method;
+  bool _gzip;
+  bool _responded;
+  char *_buf;
+  uint16_t _len; // bytes read, then bytes of response head + body
+  uint16_t _off; // bytes written
+  uint16_t _hdrLen;
+  char _hdr[HTTP_HEADER_BYTES];
+  const char *_path;
+  const char *_query;
+  const char *_body;
+  const char *_ifNoneMatch;
+  PGM_P _flash; // body streamed after _buf, if any
+  size_t _flashLen;
+  size_t _flashOff;
+  HttpFill _fill; // body generated after _buf, if any
+  size_t _fillLen;
+  uint32_t _cursor;
+  uint16_t _stateLen; // fill() state, at the end of _buf
+  int _sndBuf; // availableForWrite() on an idle socket
+  unsigned long _since;
+};
+
+typedef void (*HttpHandler)(HttpRequest &req);
+
+class HttpServer {
+public:
+  explicit HttpServer(uint16_t port);
+
+  void on(const char *path, HttpHandler handler);
+  void on(const char *path, HttpMethod method, HttpHandler handler);
+  void begin();
+
+  // Accepts, reads, routes and writes; call every loop() pass
+  void loop(unsigned long now);
+
+  uint8_t active() const;
+  const HttpStats &stats() const { return _stats; }
+  void print(Print &out) const;
+
+private:
+  struct Route {
+    const char *path;
+    HttpMethod method;
+    HttpHandler handler;
+  };
+
+  int parse(HttpRequest &r);
+  void route(HttpRequest &r);
+  void read(HttpRequest &r, unsigned long now);
+  void write(HttpRequest &r, unsigned long now);
+  void close(HttpRequest &r);
+
+  WiFiServer _server;
+  bool _started;
+  Route _routes[HTTP_MAX_ROUTES];
+  uint8_t _routeCount;
+  HttpRequest _conns[HTTP_MAX_CONNS];
+  alignas(4) char _pool[HTTP_MAX_CONNS][HTTP_BUF_SIZE];
+  HttpStats _stats;
+};
+
+#endif // HTTP_SERVER_H
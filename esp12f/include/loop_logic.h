@@ -0,0 +1,65 @@
+#ifndef LOOP_LOGIC_H
+#define LOOP_LOGIC_H
+
+#include "frame_scheduler.h"
+#include "ui_logic.h"
+#include "weather_cache.h"
+#include <Arduino.h>
+#include <TinyGPSPlus.h>
+
+// What one loop() pass decides, without the hardware: the UiLogic timers
+// and its once-a-second update, when to show cached weather and when to
+// ask the network for it, and whether a frame is due. pass() returns
+// PASS_* flags for what is left to the caller (status line, power
+// governor, starting the request, drawing); the caller hands a finished
+// request back through weatherResult().
+//
+// Weather is fetched per location cell (WeatherCache::cellFor): on the
+// first fix, when the cell changes, and when the data shown is older than
+// WEATHER_REFRESH_MS. A new cell with a fresh cache entry shows that entry
+// instead and is refetched once it goes stale.
+//
+// main.cpp's loop() and test/test_replay both run their passes through
+// it, so the replay's weather fetch attempts are the firmware's.
+
+#define WEATHER_REFRESH_MS 900000UL // 15 minutes
+
+#define PASS_UPDATE 0x01 // the once-a-second update ran (vcc() is fresh)
+#define PASS_FETCH 0x02  // start a weather request for weatherCell()
+#define PASS_CACHED 0x04 // a new cell's weather came from the cache
+#define PASS_FRAME 0x08  // render and flush one frame
+
+class LoopLogic {
+public:
+  LoopLogic(UiLogic &ui, FrameScheduler &frames, WeatherCache &cache,
+            TinyGPSPlus &gps);
+
+  // Shows what the cache kept from the last boot (after cache.begin())
+  void begin();
+
+  // One pass at `now`: the link state, and whether a request is running
+  uint8_t pass(unsigned long now, bool online, bool fetching);
+
+  // A finished request: shown, and cached for the cell it was made for
+  void weatherResult(int code, int isDay);
+
+  // UTC seconds from the GPS clock, 0 while it is unknown
+  uint32_t epoch() const;
+
+  uint16_t vcc() const { return _vcc; } // mV, read on PASS_UPDATE
+  uint32_t weatherCell() const { return _cell; }
+
+private:
+  uint8_t scheduleWeather(unsigned long now, bool online);
+
+  UiLogic &_ui;
+  FrameScheduler &_frames;
+  WeatherCache &_cache;
+  TinyGPSPlus &_gps;
+  uint16_t _vcc;
+  uint32_t _cell; // location cell of the data shown
+  // Last request, or when the cached data shown was fetched; 0 = never
+  unsigned long _fetchAt;
+};
+
+#endif // LOOP_LOGIC_H
@@ -0,0 +1,64 @@
+#ifndef LOOP_METRICS_H
+#define LOOP_METRICS_H
+
+#include <Arduino.h>
+
+// Where loop() time goes.
+//
+// Each instrumented section is timed with the CPU cycle counter (one
+// register read) and lands in a fixed-bucket latency histogram, plus a max
+// and a count of passes over METRICS_STALL_US. Everything is preallocated;
+// add() is a few compares and a division. "loop" is measured entry to
+// entry, so it also holds the time spent in the SDK between passes, but
+// not a deliberate light-sleep gap (PowerStats counts those).
+//
+// write() renders Prometheus text exposition (/metrics), print() a
+// one-line-per-section summary for the serial console. writePart() renders
+// the exposition a few lines at a time, for a body generated as the socket
+// drains; a section's +Inf bucket, sum and count share a part, so they
+// always agree.
+
+#define METRICS_STALL_US 20000 // a pass this long delays the UI visibly
+
+enum LoopSection {
+  LS_HTTP,    // server.loop() + mDNS
+  LS_GPS,     // UART drain into TinyGPSPlus
+  LS_SENSORS, // DHT read/decode, filters
+  LS_DRAW,    // render() into the frame buffer
+  LS_FLUSH,   // dirty pages over I2C
+  LS_WEATHER, // request start + one fetch step
+  LS_LOOP,    // whole pass
+  LS_SECTIONS
+};
+
+// Buckets from 50 us to 100 ms (see loop_metrics.cpp), plus +Inf
+#define METRICS_BUCKETS 10
+
+struct LatencyHistogram {
+  uint32_t buckets[METRICS_BUCKETS + 1]; // per bucket, not cumulative
+  uint32_t count;
+  uint64_t sumUs;
+  uint32_t maxUs;
+  uint32_t stalls; // passes over METRICS_STALL_US
+};
+
+class LoopMetrics {
+public:
+  LoopMetrics() { reset(); }
+
+  // cycles: ESP.getCycleCount() difference around the section
+  void add(LoopSection s, uint32_t cycles);
+  void reset();
+
+  const LatencyHistogram &section(LoopSection s) const { return _h[s]; }
+  static const char *name(uint8_t s);
+
+  void write(Print &out) const;
+  bool writePart(uint16_t part, Print &out) const; // false: past the end
+  void print(Print &out) const;
+
+private:
+  LatencyHistogram _h[LS_SECTIONS];
+};
+
+#endif // LOOP_METRICS_H
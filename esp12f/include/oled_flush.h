@@ -0,0 +1,54 @@
+#ifndef OLED_FLUSH_H
+#define OLED_FLUSH_H
+
+#include <Adafruit_SSD1306.h>
+#include <Arduino.h>
+#include <Wire.h>
+
+// Dirty-region flush for the SSD1306.
+//
+// Keeps a copy of the last frame sent to the panel and, on each flush(),
+// pushes only the 8-pixel pages that changed, and within each page only the
+// column span between the first and last changed byte. Replaces
+// display.display() in the render path.
+
+#define OLED_PAGES 8
+#define OLED_COLS 128
+#define OLED_FRAME_BYTES (OLED_PAGES * OLED_COLS)
+
+struct OledFlushStats {
+  uint32_t frames;      // flush() calls
+  uint32_t skipped;     // frames identical to the panel contents
+  uint32_t bytesSent;   // GDDRAM bytes written (total)
+  uint32_t bytesSaved;  // GDDRAM bytes not written vs. full frames (total)
+  uint16_t lastSent;    // GDDRAM bytes written by the last flush()
+  uint16_t lastSaved;   // GDDRAM bytes avoided by the last flush()
+  uint32_t lastMicros;  // I2C time of the last flush()
+};
+
+class OledFlush {
+public:
+  OledFlush(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address);
+
+  // Forget the panel contents so the next flush() sends the whole frame
+  // (after display.begin(), a contrast/invert change or a panel reset).
+  void invalidate();
+
+  // Send the changed regions of the display buffer. Returns bytes written.
+  uint16_t flush();
+
+  const OledFlushStats &stats() const { return _stats; }
+
+private:
+  void sendCommands(const uint8_t *cmds, uint8_t n);
+  void sendData(const uint8_t *data, uint16_t n);
+
+  Adafruit_SSD1306 &_display;
+  TwoWire &_wire;
+  uint8_t _address;
+  bool _valid;
+  uint8_t _shadow[OLED_FRAME_BYTES];
+  OledFlushStats _stats;
+};
+
+#endif // OLED_FLUSH_H
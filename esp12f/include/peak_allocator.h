@@ -0,0 +1,64 @@
+#ifndef PEAK_ALLOCATOR_H
+#define PEAK_ALLOCATOR_H
+
+#include <ArduinoJson.h>
+
+// ArduinoJson allocator that tracks how much a JsonDocument holds and the
+// most it held at once. The free heap before and after a parse only shows
+// what the document keeps; the peak is what the parse needed at its worst
+// (pools and string buffers it grew and shrank on the way), which is what
+// has to fit. Each block carries its size in a small header.
+
+class PeakAllocator : public ArduinoJson::Allocator {
+public:
+  void *allocate(size_t size) override {
+    Header *h = static_cast<Header *>(malloc(sizeof(Header) + size));
+    if (!h)
+      return nullptr;
+    h->size = size;
+    add(size);
+    return h + 1;
+  }
+
+  void deallocate(void *ptr) override {
+    if (!ptr)
+      return;
+    Header *h = static_cast<Header *>(ptr) - 1;
+    _current -= h->size;
+    free(h);
+  }
+
+  void *reallocate(void *ptr, size_t size) override {
+    if (!ptr)
+      return allocate(size);
+    Header *h = static_cast<Header *>(ptr) - 1;
+    size_t old = h->size;
+    h = static_cast<Header *>(realloc(h, sizeof(Header) + size));
+    if (!h)
+      return nullptr;
+    h->size = size;
+    _current -= old;
+    add(size);
+    return h + 1;
+  }
+
+  size_t current() const { return _current; }
+  size_t peak() const { return _peak; }
+
+private:
+  union Header {
+    size_t size;
+    max_align_t align;
+  };
+
+  void add(size_t size) {
+    _current += size;
+    if (_current > _peak)
+      _peak = _current;
+  }
+
+  size_t _current = 0;
+  size_t _peak = 0;
+};
+
+#endif // PEAK_ALLOCATOR_H
@@ -0,0 +1,111 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include "frame_scheduler.h"
+#include <Adafruit_SSD1306.h>
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// Battery power modes, picked from the supply voltage.
+//
+//          VCC         WiFi sleep         FPS (active/idle)  OLED       gaps
+//   FULL   > 3200 mV   modem, DTIM        UI_MAX_FPS / 10    normal     no
+//   ECO    > 3000 mV   modem, 3 beacons   10 / 4             dim idle   no
+//   LOW    below       light, 3 beacons   5 / 2              dim        yes
+//
+// Stepping down is immediate; stepping up needs POWER_HYSTERESIS_MV more,
+// so a sagging battery doesn't flap between modes. "Idle" means the face
+// is just blinking (normal/sleepy) and has been for POWER_IDLE_MS.
+// WiFi sleep modes only apply while connected as a station.
+//
+// Gaps: in LOW, loop() delay()s between GPS bursts so the SDK can light
+// sleep, waking POWER_WAKE_MARGIN_MS before the next burst is due. If
+// sentences start getting lost anyway (overruns, bad checksums), gaps are
+// switched off for POWER_GAP_BACKOFF_MS.
+//
+// Current draw is an estimate from typical datasheet figures per part, not
+// a measurement; integrated over time it gives the mAh used since boot.
+
+#ifndef POWER_GOVERNOR
+#define POWER_GOVERNOR 1
+#endif
+
+#define POWER_FULL_MV 3200
+#define POWER_ECO_MV 3000
+#define POWER_HYSTERESIS_MV 50
+#define POWER_IDLE_MS 10000
+#define POWER_LISTEN_INTERVAL 3 // beacons between wakes in ECO/LOW
+
+#define POWER_GAP_MAX_MS 500
+#define POWER_WAKE_MARGIN_MS 15
+#define POWER_GAP_BACKOFF_MS 300000UL
+
+// Estimate, mA (NEO-6M tracking, ESP8266 at 80 MHz, 0.96" OLED ~half lit)
+#define POWER_MA_GPS 40
+#define POWER_MA_CPU 16
+#define POWER_MA_CPU_SLEEP 1
+#define POWER_MA_WIFI_DTIM1 15
+#define POWER_MA_WIFI_DTIM3 6
+#define POWER_MA_WIFI_AWAKE 70 // AP mode, scanning, connecting
+#define POWER_MA_OLED 12
+#define POWER_MA_OLED_DIM 5
+
+enum PowerState { POWER_LOW, POWER_ECO, POWER_FULL, POWER_STATES };
+
+struct PowerStats {
+  uint32_t secondsIn[POWER_STATES];
+  uint32_t changes;
+  uint32_t gaps;
+  uint32_t gapMs;
+  uint32_t backoffs; // gaps switched off after losing GPS data
+  uint64_t mAms;     // estimated charge used since boot, mA x ms
+};
+
+class PowerGovernor {
+public:
+  PowerGovernor(FrameScheduler &frames, Adafruit_SSD1306 &display,
+                uint8_t maxFps);
+
+  // Once a second from loop(). idle: the face is only blinking.
+  // staConnected: WiFi up as a station (sleep modes need it).
+  // gpsLoss: running count of lost/garbled GPS data.
+  void update(unsigned long now, uint16_t vccMv, bool idle, bool staConnected,
+              uint32_t gpsLoss);
+
+  // How long loop() may sleep now, given the GPS burst timing (0 = don't)
+  uint16_t gap(unsigned long now, unsigned long burstStart,
+               unsigned long lastByte, uint16_t periodMs) const;
+  void slept(uint16_t ms);
+
+  PowerState state() const { return _state; }
+  bool idle() const { return _idle; }
+  uint16_t estimatedMa() const { return _ma; }
+  const PowerStats &stats() const { return _stats; }
+  static const char *name(uint8_t state);
+
+  void print(Print &out) const;
+  void write(Print &out) const; // Prometheus text, for /metrics
+  bool writePart(uint8_t part, Print &out) const; // false: past the end
+
+private:
+  void apply();
+
+  FrameScheduler &_frames;
+  Adafruit_SSD1306 &_display;
+  uint8_t _maxFps;
+  PowerState _state;
+  bool _idle;
+  bool _sta;
+  bool _dimmed;
+  int8_t _wifiApplied; // state whose sleep mode is set, -1 = none
+  unsigned long _busyAt; // last time the face did more than blink
+  unsigned long _lastUpdate;
+  unsigned long _backoffUntil;
+  uint32_t _gpsLoss;
+  uint32_t _windowGapMs; // slept since the last update
+  uint16_t _carryMs;      // time-in-state remainder below a second
+  uint16_t _ma;
+  PowerStats _stats;
+};
+
+#endif // POWER_GOVERNOR_H
@@ -0,0 +1,68 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <Arduino.h>
+
+// Fixed-point smoothing for slow sensors (DHT11 temperature / humidity).
+//
+// Samples are integer tenths. Each one goes through:
+//   outlier gate  a sample more than maxJump from the filtered value is
+//                 dropped, unless FILTER_REJECT_MAX arrive in a row on the
+//                 same side, which is taken as a real step and re-seeds
+//                 the filter (spikes alternating up and down stay noise)
+//   median        of the last FILTER_MEDIAN_N accepted samples
+//   EMA           alpha = 1 / 2^emaShift, Q8
+//   rate          change of the EMA over the last 50-60 s, tenths per
+//                 minute, from a ring of checkpoints one slot apart
+// The rate is taken over a window, not sample to sample: a DHT11 reads
+// whole degrees, and one 1 C step seen over 2 s would look like 30 C/min.
+// Over the window a single step is at most 10 tenths / 45 s = 13/min.
+// No floating point; the cost of each add() is kept in cycles.
+
+#define FILTER_MEDIAN_N 5
+#define FILTER_REJECT_MAX 3
+#define FILTER_RATE_WINDOW_MS 60000
+#define FILTER_RATE_SLOTS 6        // checkpoints, one per 10 s
+#define FILTER_RATE_MIN_MS 45000   // no rate over a shorter history
+
+struct SensorFilterStats {
+  uint32_t samples;
+  uint32_t rejected;
+  uint32_t lastCycles;
+  uint32_t maxCycles;
+};
+
+class SensorFilter {
+public:
+  SensorFilter(int16_t maxJump, uint8_t emaShift);
+
+  void add(int16_t tenths, unsigned long now);
+
+  bool valid() const { return _count > 0; }
+  int16_t value() const { return (_ema + 128) >> 8; } // tenths
+  int16_t whole() const;                              // rounded units
+  int16_t ratePerMin() const { return (_rate + 128) >> 8; } // tenths/min
+  const SensorFilterStats &stats() const { return _stats; }
+  void print(Print &out, const char *name) const;
+
+private:
+  void seed(int16_t x);
+  int16_t median() const;
+  void updateRate(unsigned long now);
+  uint8_t oldestMark() const;
+
+  int16_t _maxJump;
+  uint8_t _emaShift;
+  int16_t _window[FILTER_MEDIAN_N];
+  uint8_t _next, _count;
+  uint8_t _rejectRun;
+  int8_t _rejectSide; // of the run: 1 above the filtered value, -1 below
+  int32_t _ema;  // Q8 tenths
+  int32_t _rate; // Q8 tenths per minute
+  int32_t _mark[FILTER_RATE_SLOTS]; // _ema at _markTime
+  unsigned long _markTime[FILTER_RATE_SLOTS];
+  uint8_t _markHead, _marks; // next slot to write, slots in use
+  SensorFilterStats _stats;
+};
+
+#endif // SENSOR_FILTER_H
@@ -0,0 +1,66 @@
+#ifndef SSE_HUB_H
+#define SSE_HUB_H
+
+#include "telemetry.h"
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+// Server-Sent Events push channel for the dashboard (/events).
+//
+// Each subscriber has a pending set of TELEM_* fields and a small send
+// queue holding at most one serialized event. Changes published while an
+// event is still draining are merged into the pending set and go out in the
+// next event, so a slow client costs a bounded amount of RAM and never
+// blocks loop(). Clients that stop draining are dropped; the browser's
+// EventSource reconnects on its own and /data polling covers the gap.
+
+#define SSE_MAX_CLIENTS 3
+#define SSE_QUEUE_BYTES 192
+#define SSE_KEEPALIVE_MS 15000
+#define SSE_STALL_MS 10000
+
+struct SseStats {
+  uint32_t accepted;
+  uint32_t rejected; // all slots busy
+  uint32_t dropped;  // stalled or disconnected
+  uint32_t events;
+  uint32_t bytes;
+};
+
+class SseHub {
+public:
+  explicit SseHub(const Telemetry &tel);
+
+  // Takes over the connection of the current /events request. Returns false
+  // if every slot is busy (the caller should answer 503).
+  bool add(WiFiClient &client);
+
+  // Marks fields as changed for every subscriber
+  void publish(uint8_t fields);
+
+  // Serializes pending changes and drains the send queues. Call every pass.
+  void loop(unsigned long now);
+
+  uint8_t clients() const;
+  const SseStats &stats() const { return _stats; }
+
+private:
+  struct Slot {
+    WiFiClient client;
+    bool active;
+    uint8_t pending;
+    uint16_t head, len;
+    unsigned long lastProgress;
+    uint8_t queue[SSE_QUEUE_BYTES];
+  };
+
+  void drop(Slot &s);
+  void fill(Slot &s, unsigned long now);
+  void drain(Slot &s, unsigned long now);
+
+  const Telemetry &_tel;
+  Slot _slots[SSE_MAX_CLIENTS];
+  SseStats _stats;
+};
+
+#endif // SSE_HUB_H
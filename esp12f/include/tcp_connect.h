@@ -0,0 +1,55 @@
+#ifndef TCP_CONNECT_H
+#define TCP_CONNECT_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+
+// Non-blocking TCP connect.
+//
+// WiFiClient::connect() waits for the handshake inside the call, up to the
+// client timeout. begin() here only sends the SYN (lwIP raw tcp_connect);
+// lwIP's connected/error callbacks record the outcome and poll() reports it
+// from loop(), so a slow or unreachable server costs loop() nothing. Once
+// connected, take() hands the connection over as an ordinary WiFiClient.
+//
+// On the host (native env) the stand-in WiFiClient does the same with a
+// non-blocking socket.
+
+enum TcpConnectState {
+  TCP_CONNECT_IDLE,
+  TCP_CONNECT_PENDING,
+  TCP_CONNECT_DONE,
+  TCP_CONNECT_FAILED,
+};
+
+class TcpConnect {
+public:
+  TcpConnect();
+  ~TcpConnect();
+
+  // Starts connecting; false if no connection could be started at all
+  bool begin(const IPAddress &ip, uint16_t port);
+  TcpConnectState poll();
+
+  // Moves the connected socket into `client`. Back to idle.
+  bool take(WiFiClient &client);
+
+  // Abandons a pending or untaken connection
+  void cancel();
+
+#ifdef ARDUINO_ARCH_ESP8266
+  // Called from the lwIP callbacks
+  void connected(struct tcp_pcb *pcb);
+  void failed();
+#endif
+
+private:
+  TcpConnectState _state;
+  WiFiClient _client;
+#ifdef ARDUINO_ARCH_ESP8266
+  struct tcp_pcb *_pcb; // until connected; then owned by _client
+#endif
+};
+
+#endif // TCP_CONNECT_H
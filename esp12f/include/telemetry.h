@@ -0,0 +1,88 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Fixed-layout telemetry shared by the OLED renderer and the HTTP handlers.
+//
+// Values are kept both as numbers and as preformatted strings, so readers
+// never allocate. Setters only reformat when the value actually changed and
+// record which fields did in `changed`.
+
+// Change flags (Telemetry::changed)
+#define TELEM_TEMP (1 << 0)
+#define TELEM_HUM (1 << 1)
+#define TELEM_TIME (1 << 2)
+#define TELEM_DATE (1 << 3)
+#define TELEM_LAT (1 << 4)
+#define TELEM_LON (1 << 5)
+#define TELEM_GPS (1 << 6)
+#define TELEM_LED (1 << 7)
+
+struct Telemetry {
+  // Numeric values
+  int16_t tempC;
+  int16_t humPct;
+  uint8_t hour, minute, second;
+  uint8_t day, month, year; // year % 100
+  int32_t latE2, lonE2;     // degrees * 100, as shown
+  bool timeValid, dateValid, locValid;
+  bool gpsFix;
+  bool led;
+
+  // Display strings ("--" / "00:00:00" / "-0.00" when unknown)
+  char temp[7]; // "-32768"
+  char hum[7];
+  char time[9];
+  char date[9];
+  char lat[9];
+  char lon[9];
+
+  uint8_t changed;
+  uint32_t version; // bumped on every change; used as the /data ETag
+
+  void begin();
+
+  void setTemp(int16_t c);
+  void setHum(int16_t pct);
+  void setTime(uint8_t h, uint8_t m, uint8_t s);
+  void clearTime();
+  void setDate(uint8_t d, uint8_t m, uint8_t y);
+  void clearDate();
+  void setLocation(double latDeg, double lonDeg);
+  void clearLocation();
+  void setGpsFix(bool fix);
+  void setLed(bool on);
+
+  // Serializes the selected TELEM_* fields as JSON into buf. Returns the
+  // length written, or 0 if it does not fit.
+  size_t toJson(char *buf, size_t len, uint8_t fields = 0xFF) const;
+
+  void mark(uint8_t flags) {
+    changed |= flags;
+    version++;
+  }
+
+  // Returns the accumulated change flags and clears them
+  uint8_t takeChanges() {
+    uint8_t c = changed;
+    changed = 0;
+    return c;
+  }
+};
+
+// Heap health, sampled periodically to watch fragmentation on long runs
+struct HeapReport {
+  uint32_t freeBytes;
+  uint32_t maxBlock;
+  uint8_t fragPct;
+  uint32_t minFree;     // low-water mark since boot
+  uint32_t minMaxBlock; // smallest largest-free-block since boot
+  uint8_t maxFragPct;
+
+  void begin();
+  void sample();
+  void print(Print &out) const;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,18 @@
+#ifndef TEXT_BLIT_H
+#define TEXT_BLIT_H
+
+#include <Adafruit_SSD1306.h>
+#include <Arduino.h>
+
+// Org_01 at text size 2 straight from the pre-scaled atlas into the
+// SSD1306 buffer: one OR per page byte a glyph column touches, instead of
+// a fillRect per font pixel. Draws in colour 1 only (the UI never draws
+// big text inverted). Characters outside the atlas go through
+// Adafruit_GFX, so the caller sets the same font and size as before.
+//
+// (x, y) is the GFX cursor: left edge and baseline. At most n characters
+// are drawn; returns the cursor x after the last one.
+int16_t blitText(Adafruit_SSD1306 &display, int16_t x, int16_t y,
+                 const char *s, uint8_t n = 0xFF);
+
+#endif // TEXT_BLIT_H
@@ -0,0 +1,81 @@
+#ifndef TRACK_EXPORT_H
+#define TRACK_EXPORT_H
+
+#include "track_log.h"
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+// Streams the stored track as GPX or GeoJSON (/track.gpx, /track.geojson).
+//
+// Like SseHub, the handler hands over its client and loop() writes a chunk
+// whenever the socket has room, so an export of any length uses one read
+// buffer and one chunk buffer and never holds loop(). The body is sent with
+// chunked transfer encoding; GeoJSON makes two passes over the log (the
+// coordinates, then the matching "coordTimes"). After the last chunk it
+// waits, as HttpServer does, for the client to ack everything before
+// closing, so stop() never drops the tail of the file.
+
+#define TRACK_EXPORT_CHUNK 512
+#define TRACK_EXPORT_STALL_MS 10000
+#define TRACK_EXPORT_DRAIN_MS 2000 // waiting for the last bytes to be acked
+#define TRACK_EXPORT_SCAN 200 // records read per loop() pass at most
+
+enum TrackFormat { TRACK_GPX, TRACK_GEOJSON };
+
+struct TrackExportStats {
+  uint32_t started;
+  uint32_t rejected; // one export at a time
+  uint32_t aborted;  // stalled or disconnected
+  uint32_t points;   // last export
+  uint32_t bytes;
+  uint32_t millis;
+};
+
+class TrackExport {
+public:
+  explicit TrackExport(TrackLog &log);
+
+  // Takes over the client; `from`/`to` are UTC epoch bounds (0 = open)
+  bool start(WiFiClient &client, TrackFormat format, uint32_t from,
+             uint32_t to);
+  void loop(unsigned long now);
+
+  bool busy() const { return _phase != PHASE_IDLE; }
+  const TrackExportStats &stats() const { return _stats; }
+
+private:
+  enum Phase {
+    PHASE_IDLE,
+    PHASE_HEAD,
+    PHASE_POINTS,
+    PHASE_MIDDLE,
+    PHASE_TIMES,
+    PHASE_TAIL,
+    PHASE_LAST_CHUNK,
+    PHASE_DONE,
+    PHASE_DRAIN,
+  };
+
+  void fill();
+  void append(const char *s);
+  void appendP(PGM_P s);
+  void finish(bool ok, unsigned long now);
+
+  TrackLog &_log;
+  TrackReader _reader;
+  WiFiClient _client;
+  Phase _phase;
+  TrackFormat _format;
+  uint32_t _from, _to;
+  uint32_t _count; // points written in this pass
+  unsigned long _began, _lastProgress;
+  int _sndBuf; // availableForWrite() on an idle socket
+
+  // One framed chunk: 3 hex digits, CRLF, data, CRLF
+  char _chunk[TRACK_EXPORT_CHUNK + 8];
+  size_t _used; // data bytes
+  size_t _head, _len;
+  TrackExportStats _stats;
+};
+
+#endif // TRACK_EXPORT_H
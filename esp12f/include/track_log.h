@@ -0,0 +1,114 @@
+#ifndef TRACK_LOG_H
+#define TRACK_LOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// GPS track recorder on LittleFS.
+//
+// File format (/track.bin, decoded by tools/track_decode.py):
+//   "TRK1" then records, each starting with a varint header h
+//   h == 0  keyframe: uint32 epoch, int32 lat, int32 lon (little endian)
+//   h >  0  delta:    h = seconds since the previous fix, then the lat and
+//                     lon differences as zig-zag varints
+// Coordinates are microdegrees (~0.1 m), time is UTC epoch seconds.
+//
+// Records are built in a RAM buffer of TRACK_BLOCK bytes and appended to
+// flash a block at a time (or after TRACK_FLUSH_MS). Every block starts
+// with a keyframe, so a torn write costs at most that block. When the file
+// reaches TRACK_MAX_BYTES it is rotated to /track.old.
+
+#ifndef TRACK_LOG
+#define TRACK_LOG 1
+#endif
+
+#define TRACK_FILE "/track.bin"
+#define TRACK_OLD_FILE "/track.old"
+#define TRACK_MAGIC "TRK1"
+#define TRACK_BLOCK 256               // one flash page
+#define TRACK_KEYFRAME_EVERY 64       // records between keyframes
+#define TRACK_FLUSH_MS 300000UL       // flush a partial block this often
+#define TRACK_MAX_BYTES (256 * 1024UL)
+#define TRACK_RECORD_MAX 15           // varint header + 2 zig-zag varints
+
+struct TrackPoint {
+  uint32_t epoch;
+  int32_t lat; // microdegrees
+  int32_t lon;
+};
+
+struct TrackLogStats {
+  uint32_t fixes;
+  uint32_t keyframes;
+  uint32_t bytes;    // encoded bytes written, header excluded
+  uint32_t flushes;
+  uint32_t failed;   // blocks lost to a filesystem error
+  uint32_t lastFlushMicros;
+  uint32_t maxFlushMicros;
+};
+
+class TrackLog {
+public:
+  TrackLog();
+
+  // Mounts LittleFS (formatting it on first use)
+  bool begin();
+
+  // Queues a fix; lat/lon in microdegrees
+  void add(uint32_t epoch, int32_t lat, int32_t lon);
+
+  // Flushes a partial block once it is TRACK_FLUSH_MS old
+  void loop(unsigned long now);
+  void flush();
+
+  // Keeps the files in place while a TrackReader walks them
+  void holdRotation(bool hold) { _holdRotation = hold; }
+
+  bool ready() const { return _mounted; }
+  const TrackLogStats &stats() const { return _stats; }
+  void print(Print &out) const;
+
+private:
+  size_t encode(uint8_t *out, uint32_t epoch, int32_t lat, int32_t lon);
+
+  bool _mounted;
+  bool _holdRotation;
+  uint8_t _buf[TRACK_BLOCK];
+  size_t _len;
+  unsigned long _firstQueued; // millis() of the oldest unflushed record
+  uint32_t _lastEpoch;
+  int32_t _lastLat, _lastLon;
+  uint16_t _sinceKey;
+  TrackLogStats _stats;
+};
+
+// Decodes the flushed log (/track.old, then /track.bin) one fix at a time
+// through a small read buffer. Data appended after begin() is not seen,
+// not even after a rewind(): both passes read the lengths begin() found,
+// so they see the same fixes however many blocks are flushed in between.
+class TrackReader {
+public:
+  TrackReader();
+
+  bool begin();
+  bool next(TrackPoint &p);
+  bool rewind(); // back to the first fix, over the same lengths
+  void end();
+
+private:
+  bool open(uint8_t index);
+  bool readByte(uint8_t &c);
+  bool readVarint(uint32_t &v);
+  bool readLE32(uint32_t &v);
+
+  File _file;
+  uint8_t _index; // 0 old, 1 current, 2 done
+  uint32_t _size[2]; // file lengths at begin()
+  uint32_t _remaining;
+  uint8_t _buf[64];
+  uint8_t _pos, _len;
+  TrackPoint _last;
+  bool _haveKey;
+};
+
+#endif // TRACK_LOG_H
@@ -0,0 +1,52 @@
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include "track_log.h"
+#include <Arduino.h>
+
+// Streaming track simplifier (sliding-window Douglas-Peucker).
+//
+// Keeps the last emitted point (anchor) and the fixes since then. A new fix
+// extends the window while every buffered fix stays within the tolerance
+// of the straight segment anchor -> new fix; otherwise the previous fix is
+// emitted and becomes the anchor. The window is capped at TRACK_WINDOW
+// fixes, so memory is constant and a straight drive still gets a point at
+// least every TRACK_WINDOW fixes. test/test_track_simplify checks the kept
+// points against the tolerance and a full Douglas-Peucker on the host;
+// tools/track_decode.py --simplify does the same comparison on a real log.
+
+#ifndef TRACK_TOLERANCE_M
+#define TRACK_TOLERANCE_M 5.0f
+#endif
+#define TRACK_WINDOW 32
+
+class TrackSimplifier {
+public:
+  TrackSimplifier();
+
+  void setTolerance(float metres) { _tol2 = metres * metres; }
+
+  // Feeds a fix; returns true with `out` set when a point is kept
+  bool push(const TrackPoint &p, TrackPoint &out);
+
+  // Emits the pending end point (fix lost, shutdown); true if there was one
+  bool flush(TrackPoint &out);
+
+  uint32_t in() const { return _in; }
+  uint32_t out() const { return _out; }
+  void print(Print &out) const;
+
+private:
+  bool fits(const TrackPoint &end) const;
+  void setAnchor(const TrackPoint &p);
+
+  TrackPoint _anchor;
+  bool _hasAnchor;
+  TrackPoint _window[TRACK_WINDOW];
+  uint8_t _count;
+  float _tol2;
+  float _kx; // metres per microdegree of longitude at the anchor
+  uint32_t _in, _out;
+};
+
+#endif // TRACK_SIMPLIFY_H
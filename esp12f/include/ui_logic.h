@@ -0,0 +1,109 @@
+#ifndef UI_LOGIC_H
+#define UI_LOGIC_H
+
+#include "frame_scheduler.h"
+#include "sensor_filter.h"
+#include "telemetry.h"
+#include "ui_render.h"
+#include <Arduino.h>
+#include <TinyGPSPlus.h>
+
+// What the face and the clock do, as loop() drives them: blinks and the
+// look-around, the date/time toggle, battery and WiFi icon blinks, GPS
+// time, date and fix (each from its own TinyGPSPlus field age, so a
+// receiver still sending void RMCs loses the fix but keeps the clock),
+// the surprised face on a fast temperature swing and the day/night
+// fallback when no weather has been fetched.
+//
+// No hardware: every call takes the time, and the GPS ages come from
+// millis(). test/test_replay runs recorded traces through it on the host
+// with millis() on a virtual clock (see lib/host/src/Arduino.h), hours
+// of input in a fraction of a second.
+
+#define UI_UPDATE_MS 1000        // slow inputs: battery, GPS, face timeouts
+#define UI_GPS_TIME_MAX_AGE 2000 // older GPS time/date is not shown
+#define UI_GPS_FIX_MAX_AGE 5000  // older location = no fix
+#define UI_SLEEPY_AFTER_MS 30000 // without a fix, from FACE_NORMAL
+#define UI_HAPPY_MS 5000
+#define UI_SURPRISED_MS 3000
+#define UI_LOOK_STEP_MS 400
+#define UI_LOOK_CHANCE 15        // 1 in N updates starts a look-around
+#define UI_UTC_OFFSET -3         // Brasília, no DST
+
+// Tenths of a degree per minute over the filter's rate window: 3 C/min,
+// more than twice what one DHT11 step can show (13/min)
+#define FACE_SURPRISE_RATE 30
+
+class UiLogic {
+public:
+  UiLogic(Telemetry &tel, FrameScheduler &frames);
+
+  // Starts the no-fix timer
+  void begin(unsigned long now);
+
+  // A decoded DHT sample (tenths): filters, telemetry, surprise
+  void dhtSample(int16_t tempTenths, int16_t humTenths, unsigned long now);
+
+  // Every pass: animation timers. True once per UI_UPDATE_MS, when the
+  // caller should read the battery and call update().
+  bool loop(unsigned long now);
+
+  // Battery level, GPS time/date/fix, face timeouts, random look-around
+  void update(unsigned long now, uint16_t vccMv, TinyGPSPlus &gps);
+
+  // Weather from the API or a fresh cache entry (live), or the cache left
+  // by the last boot (kept only until GPS time is known)
+  void setWeather(int code, int isDay, bool live = true);
+  void setWifi(bool connected) { _wifi = connected; }
+
+  FaceState face() const { return _face; }
+  bool fix() const { return _fix; }
+  int batteryLevel() const { return _batteryLevel; } // 0 (low) .. 3 (full)
+  int gpsBars() const { return _gpsBars; }
+  int weatherCode() const { return _weatherCode; }
+  int isDay() const { return _isDay; }
+  bool weatherLive() const { return _weatherLive; }
+  const SensorFilter &temp() const { return _temp; }
+  const SensorFilter &hum() const { return _hum; }
+
+  // The frame state (led is the caller's)
+  void save(UiState &s) const;
+
+private:
+  void setFace(FaceState face, unsigned long now);
+
+  Telemetry &_tel;
+  FrameScheduler &_frames;
+  SensorFilter _temp, _hum;
+  bool _surpriseArmed;
+
+  FaceState _face;
+  unsigned long _faceStart;
+  bool _fix;
+  unsigned long _noFixSince;
+  int _batteryLevel;
+  int _gpsBars;
+  int _hour; // local, for the day/night fallback
+  int _weatherCode;
+  int _isDay;
+  bool _weatherLive;
+  bool _wifi;
+
+  bool _eye;
+  unsigned long _lastBlink;
+  unsigned long _blinkInterval;
+  int _lookPhase;
+  bool _lookActive;
+  unsigned long _lastLookStep;
+  bool _flash;
+  unsigned long _lastFlash;
+  bool _showDate;
+  unsigned long _lastDateToggle;
+  bool _battBlink;
+  unsigned long _lastBattBlink;
+  bool _iconBlink;
+  unsigned long _lastIconBlink;
+  unsigned long _lastUpdate;
+};
+
+#endif // UI_LOGIC_H
@@ -0,0 +1,99 @@
+#ifndef UI_RENDER_H
+#define UI_RENDER_H
+
+#include "counting_display.h"
+#include "telemetry.h"
+
+// The OLED UI, drawn into the display buffer (no I2C; OledFlush sends it).
+//
+// Everything a frame depends on is in UiState, so the same state always
+// gives the same frame: main.cpp renders its live state, /frame.pbm a
+// modified copy, and test/test_ui_render every face, sky and clock mode on
+// the host, against the goldens in test/test_ui_render/golden (the same
+// files tools/ui_capture.py --golden checks a device against). Each frame
+// is timed and its GFX pixel operations counted.
+
+// Static background layer: set to 0 to repaint everything each frame (for
+// comparing the draw time counters)
+#ifndef UI_STATIC_BACKGROUND
+#define UI_STATIC_BACKGROUND 1
+#endif
+
+// Size-2 text from the pre-scaled glyph atlas (0 = Adafruit_GFX, for
+// comparing the Text: timing in the status line); see setAtlas()
+#ifndef UI_GLYPH_ATLAS
+#define UI_GLYPH_ATLAS 1
+#endif
+
+#define UI_WIDTH 128
+#define UI_HEIGHT 64
+
+// A frame as a binary PBM (1 = lit pixel): the header, then 8 pages of
+// UI_PBM_PAGE bytes (8 rows each)
+#define UI_PBM_HEADER "P4\n128 64\n"
+#define UI_PBM_PAGE (8 * UI_WIDTH / 8)
+#define UI_PBM_SIZE (sizeof(UI_PBM_HEADER) - 1 + UI_WIDTH * UI_HEIGHT / 8)
+
+enum FaceState {
+  FACE_NORMAL,
+  FACE_HAPPY,
+  FACE_SLEEPY,
+  FACE_SURPRISED,
+  FACE_LOOK
+};
+#define FACE_COUNT 5
+
+// Everything render() reads
+struct UiState {
+  FaceState face;
+  int weatherCode, isDay, lookPhase;
+  bool showDate, eyeState, flashState, battBlink, iconBlink, led, gpsFix, wifi;
+  Telemetry tel;
+};
+
+struct UiRenderStats {
+  uint32_t micros, maxMicros;         // render() CPU time
+  uint32_t textMicros, maxTextMicros; // of it, the text
+  PixelOps ops;                       // GFX pixel operations, last frame
+};
+
+class UiRenderer {
+public:
+  explicit UiRenderer(CountingSSD1306 &display);
+
+  // Renders the UI into the display buffer
+  void render(const UiState &s);
+  // Same, for a snapshot that never reaches the panel (/frame.pbm): its
+  // timing and ops go to `stats`, stats() keeps the live frame's. The
+  // buffer is left holding the snapshot until the live frame is redrawn.
+  void snapshot(const UiState &s, UiRenderStats &stats);
+
+  // Call when the theme or layout changes so the background is recomposed
+  void invalidateBackground() { _backgroundValid = false; }
+  // Size-2 text from the atlas (true) or through Adafruit_GFX
+  void setAtlas(bool on) { _atlas = on; }
+  bool atlas() const { return _atlas; }
+
+  // Page `page` of the current frame as PBM rows
+  void pbmPage(uint8_t page, uint8_t rows[UI_PBM_PAGE]) const;
+
+  const UiRenderStats &stats() const { return _stats; }
+
+  // Fixed values and animation phases, so snapshots are reproducible
+  static void fixture(UiState &s);
+
+private:
+  void drawStatic();
+  void drawBackground();
+  void drawFace(const UiState &s);
+  void printPair(const char *s);
+  int16_t printBig(int16_t x, int16_t y, const char *s, uint8_t n = 0xFF);
+
+  CountingSSD1306 &_display;
+  uint8_t _background[UI_WIDTH * UI_HEIGHT / 8];
+  bool _backgroundValid;
+  bool _atlas;
+  UiRenderStats _stats;
+};
+
+#endif // UI_RENDER_H
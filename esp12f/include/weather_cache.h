@@ -0,0 +1,52 @@
+#ifndef WEATHER_CACHE_H
+#define WEATHER_CACHE_H
+
+#include <Arduino.h>
+
+// Last Open-Meteo results, keyed by a quantized lat/lon cell and kept in
+// EEPROM so the weather icon is right from the first frame after a reboot.
+//
+// Cells are WEATHER_CELL_DEG degrees on a side (0.1 deg ~ 11 km, about the
+// model resolution). Timestamps are UTC seconds taken from the GPS clock.
+
+#define WEATHER_CELL_DEG 0.1
+#define WEATHER_CACHE_ENTRIES 4
+#define WEATHER_CACHE_MAGIC 0x57584331UL // "WXC1"
+
+// Rewrite an unchanged entry at most this often (flash wear)
+#define WEATHER_CACHE_REFRESH_S 3600UL
+
+struct WeatherCacheEntry {
+  uint32_t cell;
+  uint32_t fetchedAt; // UTC epoch seconds, 0 = unknown
+  int16_t code;
+  uint8_t isDay;
+  uint8_t used;
+};
+
+class WeatherCache {
+public:
+  // Loads the table from EEPROM (EEPROM.begin() must have been called)
+  void begin(int addr);
+
+  const WeatherCacheEntry *lookup(uint32_t cell) const;
+  const WeatherCacheEntry *latest() const;
+
+  // Records a fresh result; commits to flash only when something changed
+  // or the stored entry is older than WEATHER_CACHE_REFRESH_S.
+  void store(uint32_t cell, int code, int isDay, uint32_t epoch);
+
+  static uint32_t cellFor(double lat, double lon);
+  static uint32_t epochFrom(uint16_t year, uint8_t month, uint8_t day,
+                            uint8_t hour, uint8_t minute, uint8_t second);
+
+  static const size_t STORAGE_SIZE =
+      sizeof(uint32_t) + WEATHER_CACHE_ENTRIES * sizeof(WeatherCacheEntry);
+
+private:
+  int _addr;
+  uint32_t _magic;
+  WeatherCacheEntry _entries[WEATHER_CACHE_ENTRIES];
+};
+
+#endif // WEATHER_CACHE_H
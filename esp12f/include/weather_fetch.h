@@ -0,0 +1,102 @@
+#ifndef WEATHER_FETCH_H
+#define WEATHER_FETCH_H
+
+#include "tcp_connect.h"
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+
+// Non-blocking Open-Meteo fetch.
+//
+// start() queues a request; loop() advances it one step per call:
+// resolve (async lwIP DNS) -> connect (TcpConnect, polled) -> send ->
+// headers -> body -> parse. Each phase has its own timeout and its duration
+// is recorded; none of them waits inside loop(). The body is parsed only
+// once all of it is in the socket buffer, so the parser never waits on a
+// read either; a body over WEATHER_BODY_MAX fails instead.
+//
+// WEATHER_HOST / WEATHER_PORT can be overridden from build_flags to point
+// the device at a local stand-in for the API.
+
+#ifndef WEATHER_HOST
+#define WEATHER_HOST "api.open-meteo.com"
+#endif
+#ifndef WEATHER_PORT
+#define WEATHER_PORT 80
+#endif
+
+#define WEATHER_RESOLVE_TIMEOUT 5000
+#define WEATHER_CONNECT_TIMEOUT 2000
+#define WEATHER_HEADERS_TIMEOUT 5000
+#define WEATHER_BODY_TIMEOUT 5000
+#define WEATHER_BODY_MAX 1024 // the current= response is ~350 B; < 1 window
+
+enum WeatherPhase {
+  WX_RESOLVE,
+  WX_CONNECT,
+  WX_SEND,
+  WX_HEADERS,
+  WX_BODY,
+  WX_PHASES, // count
+  WX_IDLE = WX_PHASES,
+};
+
+struct WeatherStats {
+  uint32_t started;
+  uint32_t ok;
+  uint32_t failed;
+  uint16_t lastMs[WX_PHASES]; // duration of each phase in the last fetch
+  uint16_t maxMs[WX_PHASES];
+  uint32_t parseMicros;  // last filtered parse
+  uint32_t parseHeap;    // most heap the document held during the parse
+  uint32_t maxParseHeap;
+};
+
+class WeatherFetch {
+public:
+  WeatherFetch();
+
+  // Starts a fetch for the given position. Ignored if one is running.
+  bool start(double lat, double lon);
+
+  // Advances the running fetch. Returns true once when a result is ready.
+  bool loop(unsigned long now);
+
+  bool busy() const { return _phase != WX_IDLE; }
+  int weatherCode() const { return _weatherCode; }
+  int isDay() const { return _isDay; }
+  const WeatherStats &stats() const { return _stats; }
+
+  static const char *phaseName(uint8_t phase);
+
+  // Called from the lwIP DNS callback
+  void dnsResult(bool ok, uint32_t addr);
+
+private:
+  void enter(WeatherPhase next, unsigned long now);
+  void fail(const char *why);
+  bool readHeaders(unsigned long now);
+  bool parseBody();
+
+  TcpConnect _connect;
+  WiFiClient _client;
+  WeatherPhase _phase;
+  unsigned long _phaseStart;
+  char _path[112];
+  IPAddress _ip;
+  volatile uint8_t _dnsState; // 0 pending, 1 resolved, 2 failed
+  volatile uint32_t _dnsAddr;
+
+  // Header parsing
+  char _line[48];
+  uint8_t _lineLen;
+  bool _statusSeen;
+  int _status;
+  long _contentLength;
+
+  int _weatherCode;
+  int _isDay;
+  WeatherStats _stats;
+};
+
+#endif // WEATHER_FETCH_H
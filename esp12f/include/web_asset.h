@@ -0,0 +1,18 @@
+#ifndef WEB_ASSET_H
+#define WEB_ASSET_H
+
+#include <Arduino.h>
+
+// A page embedded at build time by tools/embed_web.py (see web_assets.h).
+// Both bodies live in flash; gz is served to clients that accept gzip.
+struct WebAsset {
+  const char *type;
+  const char *plain;
+  size_t plainLen;
+  const uint8_t *gz;
+  size_t gzLen;
+  const char *etag;   // strong ETag of the plain body, quoted
+  const char *etagGz; // of the gzip body: the same with a "-gz" suffix
+};
+
+#endif // WEB_ASSET_H
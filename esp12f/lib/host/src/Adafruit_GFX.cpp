@@ -0,0 +1,309 @@
+#include "Adafruit_GFX.h"
+
+#define _swap_int16_t(a, b)                                                    \
+  {                                                                            \
+    int16_t t = a;                                                             \
+    a = b;                                                                     \
+    b = t;                                                                     \
+  }
+
+// glcdfont.c columns for the characters the firmware draws in the classic
+// font (the sleepy face's "z"); everything else is blank
+static const uint8_t CLASSIC_Z[5] = {0x44, 0x64, 0x54, 0x4C, 0x44};
+
+static const uint8_t *classicGlyph(unsigned char c) {
+  static const uint8_t blank[5] = {0, 0, 0, 0, 0};
+  return c == 'z' ? CLASSIC_Z : blank;
+}
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+    : WIDTH(w), HEIGHT(h), _width(w), _height(h), cursor_x(0), cursor_y(0),
+      textcolor(0xFFFF), textbgcolor(0xFFFF), textsize_x(1), textsize_y(1),
+      wrap(true), _cp437(false), gfxFont(NULL) {}
+
+// Bresenham's algorithm, as in the library
+void Adafruit_GFX::writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                             uint16_t color) {
+  int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    _swap_int16_t(x0, y0);
+    _swap_int16_t(x1, y1);
+  }
+  if (x0 > x1) {
+    _swap_int16_t(x0, x1);
+    _swap_int16_t(y0, y1);
+  }
+
+  int16_t dx = x1 - x0;
+  int16_t dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = y0 < y1 ? 1 : -1;
+
+  for (; x0 <= x1; x0++) {
+    if (steep)
+      drawPixel(y0, x0, color);
+    else
+      drawPixel(x0, y0, color);
+    err -= dy;
+    if (err < 0) {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  writeLine(x, y, x, y + h - 1, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  writeLine(x, y, x + w - 1, y, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  for (int16_t i = x; i < x + w; i++)
+    drawFastVLine(i, y, h, color);
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                            uint16_t color) {
+  if (x0 == x1) {
+    if (y0 > y1)
+      _swap_int16_t(y0, y1);
+    drawFastVLine(x0, y0, y1 - y0 + 1, color);
+  } else if (y0 == y1) {
+    if (x0 > x1)
+      _swap_int16_t(x0, x1);
+    drawFastHLine(x0, y0, x1 - x0 + 1, color);
+  } else {
+    writeLine(x0, y0, x1, y1, color);
+  }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r,
+                              uint16_t color) {
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  drawPixel(x0, y0 + r, color);
+  drawPixel(x0, y0 - r, color);
+  drawPixel(x0 + r, y0, color);
+  drawPixel(x0 - r, y0, color);
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    drawPixel(x0 + x, y0 + y, color);
+    drawPixel(x0 - x, y0 + y, color);
+    drawPixel(x0 + x, y0 - y, color);
+    drawPixel(x0 - x, y0 - y, color);
+    drawPixel(x0 + y, y0 + x, color);
+    drawPixel(x0 - y, y0 + x, color);
+    drawPixel(x0 + y, y0 - x, color);
+    drawPixel(x0 - y, y0 - x, color);
+  }
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r,
+                              uint16_t color) {
+  drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+  fillCircleHelper(x0, y0, r, 3, 0, color);
+}
+
+void Adafruit_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r,
+                                    uint8_t corners, int16_t delta,
+                                    uint16_t color) {
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+  int16_t px = x;
+  int16_t py = y;
+
+  delta++; // avoid some +1's in the loop
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    // The library skips lines it already drew (INVERSE would undo them)
+    if (x < (y + 1)) {
+      if (corners & 1)
+        drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+      if (corners & 2)
+        drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+    }
+    if (y != py) {
+      if (corners & 1)
+        drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+      if (corners & 2)
+        drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+      py = y;
+    }
+    px = x;
+  }
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                              int16_t w, int16_t h, uint16_t color) {
+  int16_t byteWidth = (w + 7) / 8; // bitmap rows are padded to whole bytes
+  uint8_t b = 0;
+
+  for (int16_t j = 0; j < h; j++, y++) {
+    for (int16_t i = 0; i < w; i++) {
+      if (i & 7)
+        b <<= 1;
+      else
+        b = pgm_read_byte(&bitmap[j * byteWidth + i / 8]);
+      if (b & 0x80)
+        drawPixel(x + i, y, color);
+    }
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
+                            uint16_t color, uint16_t bg, uint8_t size_x,
+                            uint8_t size_y) {
+  if (!gfxFont) { // classic 5x7, columns top to bottom
+    if (x >= _width || y >= _height || (x + 6 * size_x - 1) < 0 ||
+        (y + 8 * size_y - 1) < 0)
+      return;
+    if (!_cp437 && c >= 176)
+      c++;
+    const uint8_t *glyph = classicGlyph(c);
+    for (int8_t i = 0; i < 5; i++) {
+      uint8_t line = glyph[i];
+      for (int8_t j = 0; j < 8; j++, line >>= 1) {
+        if (line & 1) {
+          if (size_x == 1 && size_y == 1)
+            drawPixel(x + i, y + j, color);
+          else
+            fillRect(x + i * size_x, y + j * size_y, size_x, size_y, color);
+        } else if (bg != color) {
+          if (size_x == 1 && size_y == 1)
+            drawPixel(x + i, y + j, bg);
+          else
+            fillRect(x + i * size_x, y + j * size_y, size_x, size_y, bg);
+        }
+      }
+    }
+    if (bg != color) { // opaque: the gap column too
+      if (size_x == 1 && size_y == 1)
+        drawFastVLine(x + 5, y, 8, bg);
+      else
+        fillRect(x + 5 * size_x, y, size_x, 8 * size_y, bg);
+    }
+    return;
+  }
+
+  // Custom font: one pixel, or one size_x * size_y rect, per set bit
+  c -= (uint8_t)pgm_read_byte(&gfxFont->first);
+  GFXglyph *glyph = gfxFont->glyph + c;
+  uint8_t *bitmap = gfxFont->bitmap;
+  uint16_t bo = glyph->bitmapOffset;
+  uint8_t w = glyph->width, h = glyph->height;
+  int8_t xo = glyph->xOffset, yo = glyph->yOffset;
+  uint8_t xx, yy, bits = 0, bit = 0;
+  int16_t xo16 = 0, yo16 = 0;
+
+  if (size_x > 1 || size_y > 1) {
+    xo16 = xo;
+    yo16 = yo;
+  }
+
+  for (yy = 0; yy < h; yy++) {
+    for (xx = 0; xx < w; xx++) {
+      if (!(bit++ & 7))
+        bits = pgm_read_byte(&bitmap[bo++]);
+      if (bits & 0x80) {
+        if (size_x == 1 && size_y == 1)
+          drawPixel(x + xo + xx, y + yo + yy, color);
+        else
+          fillRect(x + (xo16 + xx) * size_x, y + (yo16 + yy) * size_y,
+                   size_x, size_y, color);
+      }
+      bits <<= 1;
+    }
+  }
+}
+
+void Adafruit_GFX::setFont(const GFXfont *f) {
+  if (f) {
+    if (!gfxFont) // the classic font's cursor is its top, a custom one's
+      cursor_y += 6; // the baseline
+  } else if (gfxFont) {
+    cursor_y -= 6;
+  }
+  gfxFont = (GFXfont *)f;
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (!gfxFont) {
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += textsize_y * 8;
+    } else if (c != '\r') {
+      if (wrap && (cursor_x + textsize_x * 6) > _width) {
+        cursor_x = 0;
+        cursor_y += textsize_y * 8;
+      }
+      drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x,
+               textsize_y);
+      cursor_x += textsize_x * 6;
+    }
+    return 1;
+  }
+
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+  } else if (c != '\r') {
+    uint8_t first = gfxFont->first;
+    if (c >= first && c <= (uint8_t)gfxFont->last) {
+      GFXglyph *glyph = gfxFont->glyph + (c - first);
+      uint8_t w = glyph->width, h = glyph->height;
+      if (w > 0 && h > 0) { // spaces have no bitmap
+        int16_t xo = glyph->xOffset;
+        if (wrap && (cursor_x + textsize_x * (xo + w)) > _width) {
+          cursor_x = 0;
+          cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        }
+        drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x,
+                 textsize_y);
+      }
+      cursor_x += glyph->xAdvance * (int16_t)textsize_x;
+    }
+  }
+  return 1;
+}
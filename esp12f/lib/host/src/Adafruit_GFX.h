@@ -0,0 +1,79 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+#include "gfxfont.h"
+#include <Arduino.h>
+
+// Adafruit_GFX with the calls the UI makes, drawing exactly as the library
+// (1.11) does: the same line, circle, bitmap and text algorithms, reduced
+// to the same drawPixel/drawFastHLine/drawFastVLine calls, so a frame
+// rendered on the host matches the device pixel for pixel and the
+// CountingSSD1306 op counts mean the same thing. Rotation is not
+// supported (the UI never rotates). The classic 5x7 font only carries the
+// glyphs the firmware prints with it; the rest draw blank.
+
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t w, int16_t h);
+  virtual ~Adafruit_GFX() {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                        uint16_t color);
+  virtual void fillScreen(uint16_t color);
+  virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                        uint16_t color);
+
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color);
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                uint16_t bg, uint8_t size_x, uint8_t size_y);
+
+  void setCursor(int16_t x, int16_t y) {
+    cursor_x = x;
+    cursor_y = y;
+  }
+  void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+  void setTextColor(uint16_t c, uint16_t bg) {
+    textcolor = c;
+    textbgcolor = bg;
+  }
+  void setTextSize(uint8_t s) { setTextSize(s, s); }
+  void setTextSize(uint8_t sx, uint8_t sy) {
+    textsize_x = sx > 0 ? sx : 1;
+    textsize_y = sy > 0 ? sy : 1;
+  }
+  void setTextWrap(bool w) { wrap = w; }
+  void cp437(bool x = true) { _cp437 = x; }
+  void setFont(const GFXfont *f = NULL);
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  uint8_t getRotation() const { return 0; }
+  int16_t getCursorX() const { return cursor_x; }
+  int16_t getCursorY() const { return cursor_y; }
+
+protected:
+  void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                 uint16_t color);
+  void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners,
+                        int16_t delta, uint16_t color);
+
+  const int16_t WIDTH, HEIGHT;
+  int16_t _width, _height;
+  int16_t cursor_x, cursor_y;
+  uint16_t textcolor, textbgcolor;
+  uint8_t textsize_x, textsize_y;
+  bool wrap, _cp437;
+  GFXfont *gfxFont;
+};
+
+#endif // HOST_ADAFRUIT_GFX_H
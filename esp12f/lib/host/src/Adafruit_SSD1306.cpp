@@ -0,0 +1,78 @@
+#include "Adafruit_SSD1306.h"
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi,
+                                   int8_t rst_pin)
+    : Adafruit_GFX(w, h), buffer(NULL) {
+  (void)twi;
+  (void)rst_pin;
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { free(buffer); }
+
+// The library allocates the buffer here, not in the constructor
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t i2caddr, bool reset,
+                             bool periphBegin) {
+  (void)switchvcc;
+  (void)i2caddr;
+  (void)reset;
+  (void)periphBegin;
+  if (!buffer && !(buffer = (uint8_t *)malloc(WIDTH * ((HEIGHT + 7) / 8))))
+    return false;
+  clearDisplay();
+  return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  memset(buffer, 0, WIDTH * ((HEIGHT + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= width() || y < 0 || y >= height())
+    return;
+  uint8_t *b = &buffer[x + (y / 8) * WIDTH], mask = 1 << (y & 7);
+  switch (color) {
+  case SSD1306_WHITE:
+    *b |= mask;
+    break;
+  case SSD1306_BLACK:
+    *b &= ~mask;
+    break;
+  case SSD1306_INVERSE:
+    *b ^= mask;
+    break;
+  }
+}
+
+void Adafruit_SSD1306::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                     uint16_t color) {
+  if (y < 0 || y >= HEIGHT)
+    return;
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (x + w > WIDTH)
+    w = WIDTH - x;
+  for (; w > 0; w--, x++)
+    Adafruit_SSD1306::drawPixel(x, y, color);
+}
+
+void Adafruit_SSD1306::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                     uint16_t color) {
+  if (x < 0 || x >= WIDTH)
+    return;
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  if (y + h > HEIGHT)
+    h = HEIGHT - y;
+  for (; h > 0; h--, y++)
+    Adafruit_SSD1306::drawPixel(x, y, color);
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) {
+  if (x < 0 || x >= width() || y < 0 || y >= height())
+    return false;
+  return buffer[x + (y / 8) * WIDTH] & (1 << (y & 7));
+}
@@ -0,0 +1,46 @@
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+// Adafruit_SSD1306's in-memory side: the page-major frame buffer (byte
+// x + (y / 8) * width holds column x of rows y & ~7 .. +7, bit 0 on top)
+// and its pixel and span writes, clipped as the library clips them. Nothing
+// is sent anywhere; tests read the frame back with getBuffer().
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+#define INVERSE SSD1306_INVERSE
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire,
+                   int8_t rst_pin = -1);
+  ~Adafruit_SSD1306();
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0,
+             bool reset = true, bool periphBegin = true);
+  void display() {}
+  void clearDisplay();
+  void invertDisplay(bool i) { (void)i; }
+  void dim(bool dim) { (void)dim; }
+  void ssd1306_command(uint8_t c) { (void)c; }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y);
+  uint8_t *getBuffer() { return buffer; }
+
+protected:
+  uint8_t *buffer;
+};
+
+#endif // HOST_ADAFRUIT_SSD1306_H
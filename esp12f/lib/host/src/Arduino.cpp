@@ -0,0 +1,241 @@
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+EspClass ESP;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+static uint64_t elapsedNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - bootTime)
+      .count();
+}
+
+static bool virtualClock = false;
+static uint64_t virtualMicros = 0;
+
+void hostClockSet(unsigned long ms) {
+  virtualClock = true;
+  virtualMicros = (uint64_t)ms * 1000;
+}
+
+void hostClockReal() { virtualClock = false; }
+
+unsigned long micros() {
+  return (unsigned long)(virtualClock ? virtualMicros : elapsedNanos() / 1000);
+}
+
+unsigned long millis() {
+  return (unsigned long)(virtualClock ? virtualMicros / 1000
+                                      : elapsedNanos() / 1000000);
+}
+
+void delay(unsigned long ms) {
+  if (virtualClock)
+    virtualMicros += (uint64_t)ms * 1000;
+  else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() { std::this_thread::yield(); }
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(elapsedNanos() * 80 / 1000);
+}
+
+// GPIO: outputs are remembered so a read gives back the last write
+static uint8_t pinLevel[17];
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < sizeof(pinLevel))
+    pinLevel[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < sizeof(pinLevel) ? pinLevel[pin] : LOW;
+}
+
+int analogRead(uint8_t pin) { return 0; }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg,
+                        int mode) {}
+
+void detachInterrupt(uint8_t pin) {}
+
+// xorshift32: the same sequence on every run and every host
+static uint32_t randomState = 2463534242u;
+
+static uint32_t nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+long random(long howbig) { return howbig > 0 ? nextRandom() % howbig : 0; }
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed)
+    randomState = (uint32_t)seed;
+}
+
+// String
+
+static std::string formatInteger(unsigned long long v, bool negative,
+                                 unsigned char base) {
+  if (base < 2 || base > 36)
+    base = 10;
+  char buf[72];
+  char *p = buf + sizeof(buf);
+  *--p = 0;
+  do {
+    unsigned d = v % base;
+    *--p = d < 10 ? '0' + d : 'a' + d - 10;
+    v /= base;
+  } while (v);
+  if (negative)
+    *--p = '-';
+  return p;
+}
+
+static std::string formatSigned(long long v, unsigned char base) {
+  // Like the core: only base 10 prints a sign
+  if (base == 10 && v < 0)
+    return formatInteger(-(unsigned long long)v, true, base);
+  return formatInteger((unsigned long)v, false, base);
+}
+
+static std::string formatFloat(double v, unsigned char decimals) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+  return buf;
+}
+
+String::String(int v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned v, unsigned char base)
+    : _s(formatInteger(v, false, base)) {}
+String::String(long v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned long v, unsigned char base)
+    : _s(formatInteger(v, false, base)) {}
+String::String(float v, unsigned char decimals)
+    : _s(formatFloat(v, decimals)) {}
+String::String(double v, unsigned char decimals)
+    : _s(formatFloat(v, decimals)) {}
+
+void String::trim() {
+  size_t a = 0, b = _s.size();
+  while (a < b && isspace((unsigned char)_s[a]))
+    a++;
+  while (b > a && isspace((unsigned char)_s[b - 1]))
+    b--;
+  _s = _s.substr(a, b - a);
+}
+
+// Print
+
+static size_t vprintTo(Print &out, const char *format, va_list args) {
+  char small[128];
+  va_list copy;
+  va_copy(copy, args);
+  int n = vsnprintf(small, sizeof(small), format, copy);
+  va_end(copy);
+  if (n < 0)
+    return 0;
+  if ((size_t)n < sizeof(small))
+    return out.write((const uint8_t *)small, n);
+  std::string big(n + 1, '\0');
+  vsnprintf(&big[0], n + 1, format, args);
+  return out.write((const uint8_t *)big.data(), n);
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintTo(*this, format, args);
+  va_end(args);
+  return n;
+}
+
+size_t Print::printf_P(PGM_P format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintTo(*this, format, args);
+  va_end(args);
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+  return write(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(long v, int base) {
+  std::string s = formatSigned(v, base);
+  return write(s.c_str(), s.size());
+}
+
+size_t Print::print(unsigned long v, int base) {
+  std::string s = formatInteger(v, false, base);
+  return write(s.c_str(), s.size());
+}
+
+size_t Print::print(long long v, int base) {
+  std::string s = formatSigned(v, base);
+  return write(s.c_str(), s.size());
+}
+
+size_t Print::print(unsigned long long v, int base) {
+  std::string s = formatInteger(v, false, base);
+  return write(s.c_str(), s.size());
+}
+
+size_t Print::print(double v, int digits) {
+  std::string s = formatFloat(v, digits);
+  return write(s.c_str(), s.size());
+}
+
+// Stream
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0)
+      return c;
+    yield();
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buf, size_t n) {
+  size_t count = 0;
+  while (count < n) {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    buf[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator)
+    s += (char)c;
+  return s;
+}
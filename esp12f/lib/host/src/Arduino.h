@@ -0,0 +1,328 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the ESP8266 Arduino core the firmware
+// modules use, so they build and run unmodified in the native test env
+// (pio test -e native). Only built for that env; see lib/host/library.json.
+//
+// PROGMEM is plain memory, Serial writes to stdout, millis()/micros() follow
+// the host's monotonic clock (or a virtual one, see hostClockSet()) and
+// ESP.getCycleCount() counts at 80 MHz, so the modules' own cycle
+// statistics come out in the same units as on the device (the numbers
+// themselves are the host's, not the ESP8266's).
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <strings.h>
+
+// Flash access
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strncpy_P strncpy
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define sprintf_P sprintf
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define ADC_MODE(mode)
+
+// GPIO
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+#define CHANGE 3
+#define FALLING 2
+#define RISING 1
+#define LED_BUILTIN 2
+#define digitalPinToInterrupt(p) (p)
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L lo, H hi) {
+  return x < (T)lo ? (T)lo : (x > (T)hi ? (T)hi : x);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String(const char *s = "") : _s(s ? s : "") {}
+  String(const __FlashStringHelper *s)
+      : _s(s ? reinterpret_cast<const char *>(s) : "") {}
+  String(const std::string &s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+  explicit String(float v, unsigned char decimals = 2);
+  explicit String(double v, unsigned char decimals = 2);
+
+  String &operator=(const char *s) {
+    _s = s ? s : "";
+    return *this;
+  }
+
+  unsigned int length() const { return _s.size(); }
+  const char *c_str() const { return _s.c_str(); }
+  bool reserve(unsigned int n) {
+    _s.reserve(n);
+    return true;
+  }
+  bool concat(const char *s) {
+    _s += s ? s : "";
+    return true;
+  }
+  bool concat(const char *s, unsigned int n) {
+    _s.append(s, n);
+    return true;
+  }
+  bool concat(const String &s) {
+    _s += s._s;
+    return true;
+  }
+  bool concat(char c) {
+    _s += c;
+    return true;
+  }
+
+  String &operator+=(const String &s) {
+    _s += s._s;
+    return *this;
+  }
+  String &operator+=(const char *s) {
+    concat(s);
+    return *this;
+  }
+  String &operator+=(char c) {
+    _s += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) {
+    return String(a._s + b._s);
+  }
+  friend String operator+(const String &a, const char *b) {
+    return String(a._s + (b ? b : ""));
+  }
+  friend String operator+(const char *a, const String &b) {
+    return String((a ? a : "") + b._s);
+  }
+
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+  bool operator==(const String &o) const { return _s == o._s; }
+  bool operator==(const char *o) const { return _s == (o ? o : ""); }
+  bool operator!=(const String &o) const { return _s != o._s; }
+  bool operator!=(const char *o) const { return !(*this == o); }
+  bool equals(const String &o) const { return _s == o._s; }
+  bool startsWith(const String &p) const { return _s.rfind(p._s, 0) == 0; }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t i = _s.find(c, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  int indexOf(const String &s, unsigned int from = 0) const {
+    size_t i = _s.find(s._s, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned int from) const {
+    return from < _s.size() ? String(_s.substr(from)) : String();
+  }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to)
+      std::swap(from, to);
+    return from < _s.size() ? String(_s.substr(from, to - from)) : String();
+  }
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return atof(_s.c_str()); }
+  void trim();
+
+private:
+  std::string _s;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t done = 0;
+    while (n-- && write(*buf++))
+      done++;
+    return done;
+  }
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char *buf, size_t n) { return write((const uint8_t *)buf, n); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  size_t printf_P(PGM_P format, ...) __attribute__((format(printf, 2, 3)));
+
+  size_t print(const __FlashStringHelper *s);
+  size_t print(const String &s) { return write(s.c_str(), s.length()); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(long long v, int base = DEC);
+  size_t print(unsigned long long v, int base = DEC);
+  size_t print(double v, int digits = 2);
+
+  template <typename T> size_t println(const T &v) { return print(v) + println(); }
+  template <typename T> size_t println(const T &v, int arg) {
+    return print(v, arg) + println();
+  }
+  size_t println() { return write("\r\n"); }
+};
+
+class Stream : public Print {
+public:
+  Stream() : _timeout(1000) {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  // Waits up to the timeout for each byte, like the core
+  size_t readBytes(char *buf, size_t n);
+  size_t readBytes(uint8_t *buf, size_t n) { return readBytes((char *)buf, n); }
+  String readStringUntil(char terminator);
+
+protected:
+  int timedRead();
+  unsigned long _timeout;
+};
+
+// Serial and Serial1 write to stdout; nothing is ever received
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) {}
+  void begin(unsigned long baud, int config) {}
+  void begin(unsigned long baud, int config, int mode) {}
+  void end() {}
+  void swap() {}
+  size_t setRxBufferSize(size_t n) { return n; }
+  bool hasOverrun() { return false; }
+  void setDebugOutput(bool on) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t *buf, size_t n) override {
+    return fwrite(buf, 1, n, stdout);
+  }
+  using Print::write;
+  int availableForWrite() override { return 128; }
+  void flush() override { fflush(stdout); }
+  operator bool() const { return true; }
+};
+
+#define SERIAL_8N1 0x1c
+#define SERIAL_FULL 0
+#define SERIAL_TX_ONLY 2
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint8_t getCpuFreqMHz() { return 80; }
+  uint32_t getFreeHeap() { return 40000; }
+  uint32_t getMaxFreeBlockSize() { return 30000; }
+  uint8_t getHeapFragmentation() { return 0; }
+  uint32_t getChipId() { return 0x12F5E8; }
+  uint16_t getVcc() { return _vcc; }
+  void setVcc(uint16_t mv) { _vcc = mv; } // host only, for the tests
+  void restart() { exit(0); }
+
+private:
+  uint16_t _vcc = 3300;
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Host only, for simulations: pins millis()/micros() to a virtual time the
+// caller moves forward, so hours of recorded input replay in seconds;
+// delay() then advances it instead of sleeping. ESP.getCycleCount() stays
+// on the real clock, so the modules' timings are still real. Waits on the
+// real clock (Stream timeouts) never expire unless the caller moves it.
+void hostClockSet(unsigned long ms);
+void hostClockReal(); // back to the monotonic clock
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg,
+                        int mode);
+void detachInterrupt(uint8_t pin);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// Deterministic, so renders and replays repeat exactly
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+#endif // HOST_ARDUINO_H
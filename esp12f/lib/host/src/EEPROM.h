@@ -0,0 +1,46 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+// The emulated EEPROM as plain memory: begin() sizes it (zeroed, as a
+// fresh flash sector reads after the core's erase), commit() keeps
+// nothing beyond the process. clear() is host only, for the tests.
+
+#define HOST_EEPROM_MAX 4096
+
+class EEPROMClass {
+public:
+  void begin(size_t size) {
+    _size = size < HOST_EEPROM_MAX ? size : HOST_EEPROM_MAX;
+  }
+  uint8_t read(int addr) const { return inside(addr, 1) ? _data[addr] : 0; }
+  void write(int addr, uint8_t value) {
+    if (inside(addr, 1))
+      _data[addr] = value;
+  }
+  template <typename T> T &get(int addr, T &t) const {
+    if (inside(addr, sizeof(T)))
+      memcpy(&t, _data + addr, sizeof(T));
+    return t;
+  }
+  template <typename T> const T &put(int addr, const T &t) {
+    if (inside(addr, sizeof(T)))
+      memcpy(_data + addr, &t, sizeof(T));
+    return t;
+  }
+  bool commit() { return _size > 0; }
+  void clear() { memset(_data, 0, sizeof(_data)); }
+
+private:
+  bool inside(int addr, size_t n) const {
+    return addr >= 0 && (size_t)addr + n <= _size;
+  }
+
+  size_t _size = 0;
+  uint8_t _data[HOST_EEPROM_MAX] = {};
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,24 @@
+#include "IPAddress.h"
+
+bool IPAddress::fromString(const char *s) {
+  uint32_t addr = 0;
+  for (int i = 0; i < 4; i++) {
+    if (!isdigit((unsigned char)*s))
+      return false;
+    unsigned long part = strtoul(s, (char **)&s, 10);
+    if (part > 255 || (i < 3 && *s++ != '.'))
+      return false;
+    addr |= part << (8 * i);
+  }
+  if (*s)
+    return false;
+  _addr = addr;
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1],
+           (*this)[2], (*this)[3]);
+  return String(buf);
+}
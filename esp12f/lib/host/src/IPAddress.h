@@ -0,0 +1,31 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include "lwip/ip_addr.h"
+#include <Arduino.h>
+
+// IPv4 only. The uint32_t form is in network byte order, as on the
+// ESP8266, so it can be handed to sockets unchanged.
+class IPAddress {
+public:
+  IPAddress() : _addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : _addr(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  IPAddress(const ip_addr_t *addr) : _addr(addr ? addr->addr : 0) {}
+
+  operator uint32_t() const { return _addr; }
+  uint8_t operator[](int i) const { return _addr >> (8 * i); }
+  bool operator==(const IPAddress &o) const { return _addr == o._addr; }
+  bool operator!=(const IPAddress &o) const { return _addr != o._addr; }
+  bool isSet() const { return _addr != 0; }
+
+  bool fromString(const char *s);
+  bool fromString(const String &s) { return fromString(s.c_str()); }
+  String toString() const;
+
+private:
+  uint32_t _addr;
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,96 @@
+#include "LittleFS.h"
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+
+HostFS LittleFS;
+
+static std::string hostPath(const char *path) {
+  return std::string(HOST_FS_ROOT) + (path[0] == '/' ? "" : "/") + path;
+}
+
+File::File(FILE *f, const String &name) : _f(f, fclose), _name(name) {}
+
+size_t File::write(const uint8_t *buf, size_t n) {
+  return _f ? fwrite(buf, 1, n, _f.get()) : 0;
+}
+
+int File::available() {
+  return _f ? (int)(size() - position()) : 0;
+}
+
+int File::read() { return _f ? fgetc(_f.get()) : -1; }
+
+int File::peek() {
+  if (!_f)
+    return -1;
+  int c = fgetc(_f.get());
+  if (c >= 0)
+    ungetc(c, _f.get());
+  return c;
+}
+
+size_t File::read(uint8_t *buf, size_t n) {
+  return _f ? fread(buf, 1, n, _f.get()) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+  return _f && fseek(_f.get(), pos, whence[mode]) == 0;
+}
+
+size_t File::position() const { return _f ? ftell(_f.get()) : 0; }
+
+size_t File::size() const {
+  if (!_f)
+    return 0;
+  long at = ftell(_f.get());
+  fseek(_f.get(), 0, SEEK_END);
+  long end = ftell(_f.get());
+  fseek(_f.get(), at, SEEK_SET);
+  return end;
+}
+
+void File::flush() {
+  if (_f)
+    fflush(_f.get());
+}
+
+bool HostFS::begin() {
+  std::string root(HOST_FS_ROOT);
+  for (size_t i = 1; i <= root.size(); i++)
+    if (i == root.size() || root[i] == '/')
+      mkdir(root.substr(0, i).c_str(), 0755);
+  struct stat st;
+  return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// The firmware keeps its files at the top level
+bool HostFS::format() {
+  DIR *dir = opendir(HOST_FS_ROOT);
+  if (!dir)
+    return false;
+  while (struct dirent *e = readdir(dir))
+    if (e->d_name[0] != '.')
+      ::remove(hostPath(e->d_name).c_str());
+  closedir(dir);
+  return true;
+}
+
+File HostFS::open(const char *path, const char *mode) {
+  FILE *f = fopen(hostPath(path).c_str(), mode);
+  return f ? File(f, path) : File();
+}
+
+bool HostFS::exists(const char *path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool HostFS::remove(const char *path) {
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool HostFS::rename(const char *from, const char *to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
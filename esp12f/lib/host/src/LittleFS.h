@@ -0,0 +1,56 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+
+// LittleFS on a host directory (HOST_FS_ROOT, relative to the working
+// directory), with the File and FS calls the firmware makes. Paths are the
+// device's ("/track.bin"); files are plain stdio files underneath.
+
+#ifndef HOST_FS_ROOT
+#define HOST_FS_ROOT ".pio/littlefs"
+#endif
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+  File() {}
+  File(FILE *f, const String &name);
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buf, size_t n);
+  using Stream::read;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void flush() override;
+  void close() { _f.reset(); }
+  const char *name() const { return _name.c_str(); }
+  operator bool() const { return (bool)_f; }
+
+private:
+  std::shared_ptr<FILE> _f; // copies share the handle, as on the device
+  String _name;
+};
+
+class HostFS {
+public:
+  bool begin();
+  void end() {}
+  bool format();
+  File open(const char *path, const char *mode);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+};
+
+extern HostFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
@@ -0,0 +1,222 @@
+#include "WiFiClient.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct WiFiClient::Socket {
+  explicit Socket(int fd) : fd(fd), connecting(false), peerClosed(false) {}
+  ~Socket() { close(); }
+  void close() {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+
+  int fd;
+  bool connecting;
+  bool peerClosed;
+};
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(int fd) : _sock(std::make_shared<Socket>(fd)) {
+  setNonBlocking(fd);
+}
+
+int WiFiClient::fd() const { return _sock ? _sock->fd : -1; }
+
+bool WiFiClient::beginConnect(IPAddress ip, uint16_t port) {
+  stop();
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0)
+    return false;
+  setNonBlocking(s);
+  _sock = std::make_shared<Socket>(s);
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)ip;
+  if (::connect(s, (sockaddr *)&addr, sizeof(addr)) == 0)
+    return true;
+  if (errno != EINPROGRESS) {
+    stop();
+    return false;
+  }
+  _sock->connecting = true;
+  return true;
+}
+
+int WiFiClient::pollConnect() {
+  if (fd() < 0)
+    return -1;
+  if (!_sock->connecting)
+    return 1;
+  pollfd p = {fd(), POLLOUT, 0};
+  if (::poll(&p, 1, 0) <= 0)
+    return 0;
+  int err = 0;
+  socklen_t len = sizeof(err);
+  getsockopt(fd(), SOL_SOCKET, SO_ERROR, &err, &len);
+  if (err) {
+    stop();
+    return -1;
+  }
+  _sock->connecting = false;
+  return 1;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  if (!beginConnect(ip, port))
+    return 0;
+  unsigned long start = millis();
+  int state;
+  while ((state = pollConnect()) == 0 && millis() - start < _timeout)
+    delay(1);
+  if (state != 1)
+    stop();
+  return state == 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+  IPAddress ip;
+  if (!ip.fromString(host)) {
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res)
+      return 0;
+    ip = IPAddress(((sockaddr_in *)res->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(res);
+  }
+  return connect(ip, port);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t n) {
+  if (fd() < 0 || _sock->connecting)
+    return 0;
+  size_t done = 0;
+  unsigned long start = millis();
+  while (done < n) {
+    // No more than lwIP would take: the rest waits for acks, as it does in
+    // the core's write()
+    size_t room = availableForWrite();
+    if (room) {
+      ssize_t r = ::send(fd(), buf + done, std::min(n - done, room),
+                         MSG_NOSIGNAL);
+      if (r > 0) {
+        done += r;
+        continue;
+      }
+      if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        break;
+    }
+    if (millis() - start >= _timeout)
+      break;
+    ::poll(nullptr, 0, 1);
+  }
+  return done;
+}
+
+int WiFiClient::availableForWrite() {
+  if (fd() < 0 || _sock->connecting)
+    return 0;
+  int queued = 0;
+  ioctl(fd(), SIOCOUTQ, &queued);
+  return queued < WIFICLIENT_SND_BUF ? WIFICLIENT_SND_BUF - queued : 0;
+}
+
+// Updates peerClosed (a FIN counts even with data still unread, as the
+// lwIP state does); true if there is something to read
+bool WiFiClient::readable() {
+  if (fd() < 0 || _sock->connecting)
+    return false;
+  pollfd p = {fd(), POLLIN | POLLRDHUP, 0};
+  if (::poll(&p, 1, 0) > 0 && (p.revents & (POLLRDHUP | POLLHUP | POLLERR)))
+    _sock->peerClosed = true;
+  int n = 0;
+  ioctl(fd(), FIONREAD, &n);
+  return n > 0;
+}
+
+int WiFiClient::available() {
+  if (!readable())
+    return 0;
+  int n = 0;
+  ioctl(fd(), FIONREAD, &n);
+  return n;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t n) {
+  if (!readable())
+    return 0;
+  ssize_t r = ::recv(fd(), buf, n, MSG_DONTWAIT);
+  return r > 0 ? (int)r : 0;
+}
+
+int WiFiClient::peek() {
+  if (!readable())
+    return -1;
+  uint8_t c;
+  return ::recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+uint8_t WiFiClient::status() {
+  if (fd() < 0)
+    return HOST_TCP_CLOSED;
+  if (_sock->connecting)
+    return HOST_TCP_SYN_SENT;
+  readable();
+  return _sock->peerClosed ? HOST_TCP_CLOSE_WAIT : HOST_TCP_ESTABLISHED;
+}
+
+// As in the core: established, or closed with data still to read
+uint8_t WiFiClient::connected() {
+  if (fd() < 0 || _sock->connecting)
+    return 0;
+  return status() == HOST_TCP_ESTABLISHED || available() > 0;
+}
+
+void WiFiClient::stop() {
+  if (_sock)
+    _sock->close();
+  _sock.reset();
+}
+
+bool WiFiClient::setNoDelay(bool on) {
+  int v = on;
+  return fd() >= 0 &&
+         setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v)) == 0;
+}
+
+IPAddress WiFiClient::remoteIP() {
+  sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  if (fd() < 0 || getpeername(fd(), (sockaddr *)&addr, &len) != 0)
+    return IPAddress();
+  return IPAddress(addr.sin_addr.s_addr);
+}
+
+uint16_t WiFiClient::remotePort() {
+  sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  if (fd() < 0 || getpeername(fd(), (sockaddr *)&addr, &len) != 0)
+    return 0;
+  return ntohs(addr.sin_port);
+}
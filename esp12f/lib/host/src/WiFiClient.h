@@ -0,0 +1,64 @@
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include "IPAddress.h"
+#include <Arduino.h>
+#include <memory>
+
+// WiFiClient on a non-blocking POSIX socket, with the core's semantics
+// where the firmware depends on them: copies share one connection, write()
+// waits (up to the stream timeout) until everything is queued, and
+// availableForWrite() reports the free space of a send buffer the size of
+// the core's default lwIP build, so flow control behaves as on the device.
+
+#define WIFICLIENT_SND_BUF 1072 // TCP_SND_BUF: 2 x 536 B MSS (lwIP2 low mem)
+
+// lwIP tcp_state values returned by status()
+#define HOST_TCP_CLOSED 0
+#define HOST_TCP_SYN_SENT 2
+#define HOST_TCP_ESTABLISHED 4
+#define HOST_TCP_CLOSE_WAIT 7
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient();
+  explicit WiFiClient(int fd); // host only: adopts a connected socket
+
+  int connect(IPAddress ip, uint16_t port); // blocks up to the timeout
+  int connect(const char *host, uint16_t port);
+
+  // Host only, for TcpConnect: start a connect and poll it to completion.
+  // pollConnect() returns 1 once connected, 0 while pending, -1 on failure.
+  bool beginConnect(IPAddress ip, uint16_t port);
+  int pollConnect();
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  size_t write_P(PGM_P buf, size_t n) { return write((const uint8_t *)buf, n); }
+  using Print::write;
+  int availableForWrite() override;
+
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t n);
+  int peek() override;
+  using Stream::read;
+
+  uint8_t connected();
+  uint8_t status();
+  void stop();
+  void flush() override {}
+  bool setNoDelay(bool on);
+  IPAddress remoteIP();
+  uint16_t remotePort();
+  operator bool() { return connected(); }
+
+private:
+  struct Socket;
+  int fd() const;
+  bool readable();
+
+  std::shared_ptr<Socket> _sock;
+};
+
+#endif // HOST_WIFICLIENT_H
@@ -0,0 +1,51 @@
+#include "WiFiServer.h"
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void WiFiServer::begin() {
+  stop();
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0)
+    return;
+  int on = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(s, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0) {
+    ::close(s);
+    return;
+  }
+  _fd = s;
+}
+
+bool WiFiServer::hasClient() {
+  if (_fd < 0)
+    return false;
+  pollfd p = {_fd, POLLIN, 0};
+  return ::poll(&p, 1, 0) > 0;
+}
+
+WiFiClient WiFiServer::accept() {
+  if (_fd < 0)
+    return WiFiClient();
+  int c = ::accept(_fd, nullptr, nullptr);
+  if (c < 0)
+    return WiFiClient();
+  WiFiClient client(c);
+  if (_noDelay)
+    client.setNoDelay(true);
+  return client;
+}
+
+void WiFiServer::stop() {
+  if (_fd >= 0)
+    ::close(_fd);
+  _fd = -1;
+}
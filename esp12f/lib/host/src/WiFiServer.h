@@ -0,0 +1,31 @@
+#ifndef HOST_WIFISERVER_H
+#define HOST_WIFISERVER_H
+
+#include "WiFiClient.h"
+#include <Arduino.h>
+
+// WiFiServer on a non-blocking listening socket bound to 127.0.0.1, with
+// the calls HttpServer makes: accept() hands over a waiting connection (or
+// an unconnected client) without blocking, as on the device.
+
+class WiFiServer {
+public:
+  explicit WiFiServer(uint16_t port) : _port(port), _fd(-1), _noDelay(false) {}
+  ~WiFiServer() { stop(); }
+
+  void begin();
+  void setNoDelay(bool on) { _noDelay = on; }
+  bool hasClient();
+  WiFiClient accept();
+  WiFiClient available() { return accept(); }
+  void stop();
+  void close() { stop(); }
+  uint8_t status() { return _fd >= 0 ? 1 : 0; } // LISTEN / CLOSED
+
+private:
+  uint16_t _port;
+  int _fd;
+  bool _noDelay;
+};
+
+#endif // HOST_WIFISERVER_H
@@ -0,0 +1,20 @@
+#include "lwip/dns.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+
+extern "C" err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                                   dns_found_callback found,
+                                   void *callback_arg) {
+  struct addrinfo hints, *res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(hostname, nullptr, &hints, &res) != 0 || !res) {
+    if (found)
+      found(hostname, nullptr, callback_arg);
+    return ERR_INPROGRESS;
+  }
+  addr->addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(res);
+  return ERR_OK;
+}
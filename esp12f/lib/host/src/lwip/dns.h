@@ -0,0 +1,25 @@
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+#include "lwip/ip_addr.h"
+
+// dns_gethostbyname() on the host resolver. Host names resolve
+// synchronously (ERR_OK, callback not called), as a cached name does in
+// lwIP; a name that does not resolve is reported through the callback
+// with a null address, like an lwIP lookup that failed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_DNS_H
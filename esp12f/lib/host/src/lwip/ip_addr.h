@@ -0,0 +1,20 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+// lwIP address and error types, as far as the firmware uses them.
+// Addresses are IPv4 in network byte order, as in lwIP.
+
+typedef struct {
+  uint32_t addr;
+} ip_addr_t;
+
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+#endif // HOST_LWIP_IP_ADDR_H
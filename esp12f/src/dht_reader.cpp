@@ -0,0 +1,116 @@
+#include "dht_reader.h"
+
+DhtReader::DhtReader(uint8_t pin)
+    : _pin(pin), _state(DHT_IDLE), _stateStart(0), _count(0), _ok(false),
+      _temp(0), _hum(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void DhtReader::begin() {
+  pinMode(_pin, INPUT_PULLUP);
+  _stateStart = millis() - DHT_INTERVAL_MS + 1000; // sensor settles ~1 s
+}
+
+void IRAM_ATTR DhtReader::onEdge(void *arg) {
+  DhtReader *d = static_cast<DhtReader *>(arg);
+  uint8_t n = d->_count;
+  if (n < DHT_MAX_EDGES) {
+    d->_edges[n] = (ESP.getCycleCount() & ~1UL) | digitalRead(d->_pin);
+    d->_count = n + 1;
+  }
+}
+
+bool DhtReader::decode(const uint32_t *edges, uint8_t count,
+                       uint32_t cyclesPerUs, uint8_t data[5]) {
+  // The data bits are the last 40 complete high pulses; anything before
+  // (host release, 80 us response) is skipped by counting from the end.
+  uint8_t highs = 0;
+  for (uint8_t i = 0; i + 1 < count; i++)
+    highs += (edges[i] & 1) && !(edges[i + 1] & 1);
+  if (highs < 40)
+    return false;
+
+  // In cycles: the level bit can take one off a stamp, and dividing down
+  // to microseconds would then read a 51 us pulse as 50
+  uint32_t one = DHT_ONE_US * cyclesPerUs;
+  memset(data, 0, 5);
+  uint8_t skip = highs - 40, bit = 0;
+  for (uint8_t i = 0; i + 1 < count; i++) {
+    if (!(edges[i] & 1) || (edges[i + 1] & 1))
+      continue;
+    if (skip) {
+      skip--;
+      continue;
+    }
+    uint32_t width = edges[i + 1] - edges[i];
+    data[bit / 8] = (data[bit / 8] << 1) | (width > one);
+    bit++;
+  }
+  return (uint8_t)(data[0] + data[1] + data[2] + data[3]) == data[4];
+}
+
+bool DhtReader::finish() {
+  uint8_t data[5];
+  _stats.reads++;
+  _stats.lastEdges = _count;
+  _ok = decode(_edges, _count, ESP.getCpuFreqMHz(), data);
+  if (!_ok) {
+    _stats.failed++;
+    return false;
+  }
+  _hum = data[0] * 10 + data[1];
+  _temp = data[2] * 10 + (data[3] & 0x0F);
+  if (data[3] & 0x80)
+    _temp = -_temp;
+  return true;
+}
+
+bool DhtReader::loop(unsigned long now) {
+  unsigned long elapsed = now - _stateStart;
+  unsigned long t0;
+
+  switch (_state) {
+  case DHT_IDLE:
+    if (elapsed < DHT_INTERVAL_MS)
+      return false;
+    t0 = micros();
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+    _state = DHT_START;
+    _stateStart = now;
+    _stats.busyMicros = micros() - t0;
+    return false;
+
+  case DHT_START:
+    if (elapsed < DHT_START_MS)
+      return false;
+    t0 = micros();
+    _count = 0;
+    attachInterruptArg(digitalPinToInterrupt(_pin), onEdge, this, CHANGE);
+    pinMode(_pin, INPUT_PULLUP); // release: the sensor answers in 20-40 us
+    _state = DHT_CAPTURE;
+    _stateStart = now;
+    _stats.busyMicros += micros() - t0;
+    return false;
+
+  case DHT_CAPTURE:
+    if (elapsed < DHT_CAPTURE_MS)
+      return false;
+    t0 = micros();
+    detachInterrupt(digitalPinToInterrupt(_pin));
+    finish();
+    _state = DHT_IDLE;
+    _stateStart = now;
+    _stats.busyMicros += micros() - t0;
+    if (_stats.busyMicros > _stats.maxBusyMicros)
+      _stats.maxBusyMicros = _stats.busyMicros;
+    return true;
+  }
+  return false;
+}
+
+void DhtReader::print(Print &out) const {
+  out.printf("DHT: %lu reads, %lu failed, %u edges, busy %uus max %uus\n",
+             (unsigned long)_stats.reads, (unsigned long)_stats.failed,
+             _stats.lastEdges, _stats.busyMicros, _stats.maxBusyMicros);
+}
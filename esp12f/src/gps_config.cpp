@@ -0,0 +1,258 @@
+#include "gps_config.h"
+#include "debug_log.h"
+
+// NMEA sentences switched off on u-blox (class 0xF0): GLL, GSA, GSV, VTG
+static const uint8_t UBX_NMEA_OFF[] = {0x01, 0x02, 0x03, 0x05};
+
+static const char *const STEP_NAMES[] = {"filter", "baud", "rate"};
+
+GpsConfig::GpsConfig(GpsInput &in, const TinyGPSPlus &gps)
+    : _in(in), _gps(gps), _state(GPSCFG_IDLE), _stateStart(0), _began(0),
+      _tookMs(0), _sentences(0), _proto(GPS_PROTO_NONE), _step(STEP_FILTER),
+      _sub(0), _retries(0), _rateHz(1), _result("not run"), _ack(ACK_WAIT),
+      _ackCls(0), _ackId(0), _ackPmtk(0), _ubxPos(0), _lineLen(0) {}
+
+void GpsConfig::begin(unsigned long now) {
+  _began = now;
+  _in.setTap(this);
+  enter(GPSCFG_PROBE, now);
+}
+
+void GpsConfig::enter(State next, unsigned long now) {
+  _state = next;
+  _stateStart = now;
+  _sentences = _gps.passedChecksum();
+}
+
+void GpsConfig::finish(const char *result, unsigned long now) {
+  _in.setTap(nullptr);
+  _result = result;
+  _tookMs = now - _began;
+  enter(GPSCFG_DONE, now);
+  print(LOG);
+}
+
+void GpsConfig::print(Print &out) const {
+  static const char *const protos[] = {"unknown", "u-blox", "MTK"};
+  out.printf("GPS config: %s, %s, %lu baud, ", _result, protos[_proto],
+             _in.baud());
+  if (_rateHz)
+    out.printf("%u Hz", _rateHz);
+  else
+    out.print("? Hz");
+  out.printf(" (%lums)\n", _tookMs);
+}
+
+void GpsConfig::sendUbx(uint8_t cls, uint8_t id, const uint8_t *payload,
+                        uint16_t len) {
+  uint8_t head[6] = {0xB5, 0x62, cls, id, (uint8_t)len, (uint8_t)(len >> 8)};
+  uint8_t ckA = 0, ckB = 0;
+  for (uint8_t i = 2; i < 6; i++) {
+    ckA += head[i];
+    ckB += ckA;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    ckA += payload[i];
+    ckB += ckA;
+  }
+  uint8_t tail[2] = {ckA, ckB};
+
+  Stream &port = _in.port();
+  port.write(head, sizeof(head));
+  port.write(payload, len);
+  port.write(tail, sizeof(tail));
+  _ackCls = cls;
+  _ackId = id;
+}
+
+void GpsConfig::sendPmtk(const char *body) {
+  uint8_t ck = 0;
+  for (const char *p = body; *p; p++)
+    ck ^= *p;
+  char line[48];
+  int n = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, ck);
+  _in.port().write((const uint8_t *)line, n);
+  _ackPmtk = atoi(body + 4); // "PMTKnnn,..."
+}
+
+void GpsConfig::sendStep(unsigned long now) {
+  _ack = ACK_WAIT;
+  if (_proto == GPS_PROTO_UBX) {
+    switch (_step) {
+    case STEP_FILTER: {
+      uint8_t msg[3] = {0xF0, UBX_NMEA_OFF[_sub], 0}; // CFG-MSG, rate 0
+      sendUbx(0x06, 0x01, msg, sizeof(msg));
+      break;
+    }
+    case STEP_BAUD: {
+      uint32_t baud = GPS_TARGET_BAUD;
+      // UART1, 8N1, in UBX+NMEA+RTCM, out UBX+NMEA
+      uint8_t prt[20] = {1,    0,    0,    0,    0xD0,
+                         0x08, 0x00, 0x00, (uint8_t)baud,
+                         (uint8_t)(baud >> 8), (uint8_t)(baud >> 16),
+                         (uint8_t)(baud >> 24), 0x07, 0x00, 0x03, 0x00};
+      sendUbx(0x06, 0x00, prt, sizeof(prt));
+      break;
+    }
+    case STEP_RATE: {
+      uint16_t ms = 1000 / GPS_RATE_HZ;
+      uint8_t rate[6] = {(uint8_t)ms, (uint8_t)(ms >> 8), 1, 0, 1, 0}; // GPS time
+      sendUbx(0x06, 0x08, rate, sizeof(rate));
+      break;
+    }
+    default:
+      break;
+    }
+  } else {
+    char body[40];
+    switch (_step) {
+    case STEP_FILTER: // GLL,RMC,VTG,GGA,GSA,GSV,... intervals
+      sendPmtk("PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+      break;
+    case STEP_BAUD:
+      snprintf(body, sizeof(body), "PMTK251,%lu", (unsigned long)GPS_TARGET_BAUD);
+      sendPmtk(body);
+      break;
+    case STEP_RATE:
+      snprintf(body, sizeof(body), "PMTK220,%u", 1000 / GPS_RATE_HZ);
+      sendPmtk(body);
+      break;
+    default:
+      break;
+    }
+  }
+  // The baud command is confirmed by traffic at the new rate, not an ACK
+  enter(_step == STEP_BAUD ? GPSCFG_BAUD : GPSCFG_ACK, now);
+}
+
+void GpsConfig::nextStep(unsigned long now) {
+  _retries = 0;
+  if (_proto == GPS_PROTO_UBX && _step == STEP_FILTER &&
+      ++_sub < sizeof(UBX_NMEA_OFF)) {
+    sendStep(now);
+    return;
+  }
+  _step = (Step)(_step + 1);
+  if (_step == STEP_END) {
+    finish("RMC+GGA only", now);
+    return;
+  }
+  sendStep(now);
+}
+
+void GpsConfig::loop(unsigned long now) {
+  unsigned long elapsed = now - _stateStart;
+
+  switch (_state) {
+  case GPSCFG_IDLE:
+  case GPSCFG_DONE:
+    return;
+
+  case GPSCFG_PROBE:
+    if (sentenceSeen()) {
+      _proto = GPS_PROTO_UBX; // try u-blox first, MTK ignores UBX frames
+      _step = STEP_FILTER;
+      _sub = 0;
+      sendStep(now);
+    } else if (elapsed > GPS_PROBE_TIMEOUT) {
+      _in.setBaud(GPS_TARGET_BAUD);
+      enter(GPSCFG_PROBE_FAST, now);
+    }
+    return;
+
+  case GPSCFG_PROBE_FAST:
+    if (sentenceSeen()) {
+      _rateHz = 0; // whatever the previous boot set
+      finish("kept from a previous boot", now);
+    } else if (elapsed > GPS_PROBE_TIMEOUT) {
+      _in.setBaud(GPS_BAUD);
+      finish("no NMEA, skipped", now);
+    }
+    return;
+
+  case GPSCFG_ACK:
+    if (_ack == ACK_OK) {
+      if (_step == STEP_RATE)
+        _rateHz = GPS_RATE_HZ;
+      nextStep(now);
+    } else if (_ack == ACK_NAK || elapsed > GPS_ACK_TIMEOUT) {
+      if (_retries++ == 0) {
+        sendStep(now);
+      } else if (_proto == GPS_PROTO_UBX && _step == STEP_FILTER &&
+                 _sub == 0) {
+        _proto = GPS_PROTO_PMTK; // first UBX command unanswered: not u-blox
+        _retries = 0;
+        sendStep(now);
+      } else if (_proto == GPS_PROTO_PMTK && _step == STEP_FILTER) {
+        _proto = GPS_PROTO_NONE;
+        finish("no UBX/PMTK ACK, module defaults", now);
+      } else {
+        LOG.printf("GPS config: no ACK for %s\n", STEP_NAMES[_step]);
+        finish("partial", now);
+      }
+    }
+    return;
+
+  case GPSCFG_BAUD:
+    if (elapsed > GPS_BAUD_SETTLE) {
+      _in.setBaud(GPS_TARGET_BAUD);
+      enter(GPSCFG_VERIFY, now);
+    }
+    return;
+
+  case GPSCFG_VERIFY:
+    if (sentenceSeen()) {
+      nextStep(now);
+    } else if (elapsed > GPS_PROBE_TIMEOUT) {
+      // Stay slow: 1 Hz RMC+GGA still fits 9600 baud
+      _in.setBaud(GPS_BAUD);
+      finish("baud switch not confirmed, RMC+GGA only", now);
+    }
+    return;
+  }
+}
+
+// Watches the raw stream for UBX ACK-ACK/ACK-NAK and $PMTK001 replies
+void GpsConfig::onByte(uint8_t c) {
+  if (_state != GPSCFG_ACK)
+    return;
+
+  // UBX: B5 62 05 01|00 02 00 cls id ckA ckB
+  if (_ubxPos == 0) {
+    if (c == 0xB5)
+      _ubx[_ubxPos++] = c;
+  } else if (_ubxPos == 1) {
+    _ubxPos = c == 0x62 ? 2 : (c == 0xB5 ? 1 : 0);
+    _ubx[1] = c;
+  } else {
+    _ubx[_ubxPos++] = c;
+    if (_ubxPos == sizeof(_ubx)) {
+      _ubxPos = 0;
+      uint8_t ckA = 0, ckB = 0;
+      for (uint8_t i = 2; i < 8; i++) {
+        ckA += _ubx[i];
+        ckB += ckA;
+      }
+      if (_ubx[2] == 0x05 && _ubx[4] == 2 && _ubx[5] == 0 && ckA == _ubx[8] &&
+          ckB == _ubx[9] && _ubx[6] == _ackCls && _ubx[7] == _ackId &&
+          _proto == GPS_PROTO_UBX)
+        _ack = _ubx[3] == 0x01 ? ACK_OK : ACK_NAK;
+    }
+  }
+
+  // PMTK: "$PMTK001,<cmd>,<flag>*CS", flag 3 = success
+  if (c == '$') {
+    _lineLen = 0;
+  } else if (c == '\r' || c == '\n') {
+    _line[_lineLen] = 0;
+    if (_proto == GPS_PROTO_PMTK && strncmp(_line, "PMTK001,", 8) == 0 &&
+        atoi(_line + 8) == _ackPmtk) {
+      const char *flag = strchr(_line + 8, ',');
+      if (flag)
+        _ack = atoi(flag + 1) == 3 ? ACK_OK : ACK_NAK;
+    }
+    _lineLen = 0;
+  } else if (_lineLen < sizeof(_line) - 1) {
+    _line[_lineLen++] = c;
+  }
+}
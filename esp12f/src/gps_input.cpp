@@ -0,0 +1,91 @@
+#include "gps_input.h"
+
+#if GPS_HW_UART
+#define GPS_PORT Serial
+#else
+#include <SoftwareSerial.h>
+static SoftwareSerial *gpsSoft;
+#define GPS_PORT (*gpsSoft)
+#endif
+
+GpsInput::GpsInput(uint8_t rxPin, uint8_t txPin)
+    : _burstStart(0), _lastByteAt(0), _baud(GPS_BAUD), _tap(nullptr) {
+  memset(&_stats, 0, sizeof(_stats));
+#if GPS_HW_UART
+  (void)rxPin; // fixed by the pin swap
+  (void)txPin;
+#else
+  static SoftwareSerial soft(rxPin, txPin);
+  gpsSoft = &soft;
+#endif
+}
+
+void GpsInput::begin(unsigned long baud) {
+  _baud = baud;
+#if GPS_HW_UART
+  Serial.setRxBufferSize(GPS_RX_BUFFER); // before begin() allocates it
+  Serial.begin(baud);
+  Serial.swap(); // RX GPIO13, TX GPIO15
+#else
+  gpsSoft->begin(baud);
+#endif
+}
+
+void GpsInput::setBaud(unsigned long baud) {
+  _baud = baud;
+#if GPS_HW_UART
+  Serial.updateBaudRate(baud);
+#else
+  gpsSoft->begin(baud);
+#endif
+}
+
+Stream &GpsInput::port() { return GPS_PORT; }
+
+uint16_t GpsInput::bufferSize() const {
+#if GPS_HW_UART
+  return GPS_RX_BUFFER;
+#else
+  return 64; // SoftwareSerial default
+#endif
+}
+
+void GpsInput::poll(TinyGPSPlus &gps) {
+#if GPS_HW_UART
+  if (Serial.hasOverrun())
+    _stats.overruns++;
+  if (Serial.hasRxError())
+    _stats.rxErrors++;
+#else
+  if (gpsSoft->overflow())
+    _stats.overruns++;
+#endif
+
+  int backlog = GPS_PORT.available();
+  if (backlog > _stats.maxBacklog)
+    _stats.maxBacklog = backlog;
+  if (backlog > 0) {
+    unsigned long now = millis();
+    if (now - _lastByteAt > GPS_BURST_GAP_MS)
+      _burstStart = now;
+    _lastByteAt = now;
+  }
+
+  while (GPS_PORT.available() > 0) {
+    uint8_t c = GPS_PORT.read();
+    if (_tap)
+      _tap->onByte(c);
+    gps.encode(c);
+    _stats.bytes++;
+  }
+}
+
+void GpsInput::print(Print &out, const TinyGPSPlus &gps) const {
+  out.printf("GPS %s: %lu B, backlog max %u/%u, overruns %lu, rx errors %lu, "
+             "sentences ok %lu bad %lu\n",
+             GPS_HW_UART ? "UART0" : "soft", (unsigned long)_stats.bytes,
+             _stats.maxBacklog, bufferSize(), (unsigned long)_stats.overruns,
+             (unsigned long)_stats.rxErrors,
+             (unsigned long)gps.passedChecksum(),
+             (unsigned long)gps.failedChecksum());
+}
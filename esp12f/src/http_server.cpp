@@ -0,0 +1,467 @@
+#include "http_server.h"
+#include "debug_log.h"
+
+static const char *reasonPhrase(int code) {
+  switch (code) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 413:
+    return "Payload Too Large";
+  case 500:
+    return "Internal Server Error";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Error";
+  }
+}
+
+// Value of a header line "Name: value" if the name matches, else nullptr
+static char *headerValue(char *line, const char *name) {
+  size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':')
+    return nullptr;
+  char *v = line + n + 1;
+  while (*v == ' ')
+    v++;
+  return v;
+}
+
+// --- HttpChunk ---
+
+size_t HttpChunk::write(const uint8_t *p, size_t n) {
+  if (_full || _len + n > _room) {
+    _full = true;
+    return 0;
+  }
+  memcpy(_buf + _len, p, n);
+  _len += n;
+  return n;
+}
+
+bool HttpChunk::commit() {
+  if (_full) {
+    _len = _committed;
+    return false;
+  }
+  _committed = _len;
+  return true;
+}
+
+// --- HttpRequest ---
+
+// name=value in the query string, then in a form-encoded body
+bool HttpRequest::findArg(const char *name, const char *&value,
+                          size_t &len) const {
+  size_t nameLen = strlen(name);
+  const char *sources[] = {_query, _body};
+  for (const char *p : sources) {
+    while (p && *p) {
+      const char *end = strchr(p, '&');
+      if (!end)
+        end = p + strlen(p);
+      const char *eq = (const char *)memchr(p, '=', end - p);
+      const char *keyEnd = eq ? eq : end;
+      if ((size_t)(keyEnd - p) == nameLen && strncmp(p, name, nameLen) == 0) {
+        value = eq ? eq + 1 : end;
+        len = end - value;
+        return true;
+      }
+      p = *end ? end + 1 : end;
+    }
+  }
+  return false;
+}
+
+bool HttpRequest::hasArg(const char *name) const {
+  const char *v;
+  size_t n;
+  return findArg(name, v, n);
+}
+
+String HttpRequest::arg(const char *name) const {
+  String out;
+  const char *v;
+  size_t n;
+  if (!findArg(name, v, n))
+    return out;
+  out.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    char c = v[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%' && i + 2 < n && isxdigit(v[i + 1]) &&
+               isxdigit(v[i + 2])) {
+      char hex[3] = {v[i + 1], v[i + 2], 0};
+      c = (char)strtol(hex, nullptr, 16);
+      i += 2;
+    }
+    out += c;
+  }
+  return out;
+}
+
+void HttpRequest::appendHeader(const char *line, size_t n) {
+  if (_hdrLen + n > sizeof(_hdr)) {
+    LOG.println(F("HTTP: response headers dropped (HTTP_HEADER_BYTES)"));
+    return;
+  }
+  memcpy(_hdr + _hdrLen, line, n);
+  _hdrLen += n;
+}
+
+void HttpRequest::sendHeader(const __FlashStringHelper *name,
+                             const char *value) {
+  char key[32];
+  strncpy_P(key, (PGM_P)name, sizeof(key) - 1);
+  key[sizeof(key) - 1] = 0;
+  char line[HTTP_HEADER_BYTES];
+  int n = snprintf(line, sizeof(line), "%s: %s\r\n", key, value);
+  if (n > 0 && n < (int)sizeof(line))
+    appendHeader(line, n);
+}
+
+void HttpRequest::sendHeader(const __FlashStringHelper *name,
+                             const __FlashStringHelper *value) {
+  char v[64];
+  strncpy_P(v, (PGM_P)value, sizeof(v) - 1);
+  v[sizeof(v) - 1] = 0;
+  sendHeader(name, v);
+}
+
+// Builds the response head (+ body if given) over the request in _buf
+// (and in front of a generator's state)
+void HttpRequest::send(int code, const char *type, const char *body,
+                       size_t len) {
+  if (body && !len)
+    len = strlen(body);
+  size_t room = _fill ? fillRoom() : HTTP_BUF_SIZE;
+
+  int n = snprintf(_buf, room, "HTTP/1.1 %d %s\r\n", code,
+                   reasonPhrase(code));
+  if (type)
+    n += snprintf(_buf + n, room - n, "Content-Type: %s\r\n", type);
+  if (_fill && !_fillLen)
+    n += snprintf(_buf + n, room - n, "Connection: close\r\n");
+  else
+    n += snprintf(_buf + n, room - n,
+                  "Content-Length: %u\r\nConnection: close\r\n",
+                  (unsigned)(_flash ? _flashLen : _fill ? _fillLen : len));
+  if (n + _hdrLen + 2 + (_flash || _fill ? 0 : len) > room) {
+    LOG.printf("HTTP: %s response too large for HTTP_BUF_SIZE\n", _path);
+    _hdrLen = 0;
+    _flash = nullptr;
+    _fill = nullptr;
+    _stateLen = 0;
+    send(500);
+    return;
+  }
+  memcpy(_buf + n, _hdr, _hdrLen);
+  n += _hdrLen;
+  _buf[n++] = '\r';
+  _buf[n++] = '\n';
+  if (body && !_flash && !_fill) {
+    memcpy(_buf + n, body, len);
+    n += len;
+  }
+
+  _len = n;
+  _off = 0;
+  _state = WRITE;
+  _responded = true;
+}
+
+void HttpRequest::send_P(int code, const char *type, PGM_P body, size_t len) {
+  _flash = body;
+  _flashLen = len;
+  _flashOff = 0;
+  send(code, type);
+}
+
+void HttpRequest::sendGenerated(int code, const char *type, HttpFill fill,
+                                 const void *state, size_t stateLen,
+                                 size_t len) {
+  _fill = fill;
+  _fillLen = len;
+  _cursor = 0;
+  _stateLen = (stateLen + 3) & ~3; // keeps the state 4-byte aligned
+  if (_stateLen > HTTP_BUF_SIZE / 2) {
+    LOG.printf("HTTP: %s generator state too large\n", _path);
+    _fill = nullptr;
+    _stateLen = 0;
+    send(500);
+    return;
+  }
+  if (stateLen)
+    memcpy(_buf + fillRoom(), state, stateLen);
+  send(code, type);
+}
+
+void HttpRequest::detach() {
+  _client = WiFiClient(); // the other holder keeps the socket open
+  _state = FREE;
+  _responded = true;
+}
+
+void HttpRequest::done() {
+  _state = DRAIN;
+  _responded = true;
+}
+
+// --- HttpServer ---
+
+HttpServer::HttpServer(uint16_t port)
+    : _server(port), _started(false), _routeCount(0) {
+  for (uint8_t i = 0; i < HTTP_MAX_CONNS; i++) {
+    _conns[i]._state = HttpRequest::FREE;
+    _conns[i]._buf = _pool[i];
+  }
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void HttpServer::on(const char *path, HttpHandler handler) {
+  on(path, METHOD_ANY, handler);
+}
+
+void HttpServer::on(const char *path, HttpMethod method, HttpHandler handler) {
+  if (_routeCount == HTTP_MAX_ROUTES) {
+    LOG.printf("HTTP: no room for %s (HTTP_MAX_ROUTES)\n", path);
+    return;
+  }
+  _routes[_routeCount++] = {path, method, handler};
+}
+
+void HttpServer::begin() {
+  if (_started)
+    return;
+  _server.begin();
+  _server.setNoDelay(true);
+  _started = true;
+}
+
+uint8_t HttpServer::active() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < HTTP_MAX_CONNS; i++)
+    n += _conns[i]._state != HttpRequest::FREE;
+  return n;
+}
+
+void HttpServer::close(HttpRequest &r) {
+  r._client.stop();
+  r._client = WiFiClient();
+  r._state = HttpRequest::FREE;
+}
+
+// 1 = complete request parsed, 0 = need more bytes, -1 = malformed
+int HttpServer::parse(HttpRequest &r) {
+  char *end = strstr(r._buf, "\r\n\r\n");
+  if (!end)
+    return 0;
+  char *body = end + 4;
+  char *line = strstr(r._buf, "\r\n") + 2;
+
+  // Content-Length first, without touching the buffer: the body may still
+  // be on its way
+  long contentLength = 0;
+  for (char *p = line; p < end;) {
+    char *next = strstr(p, "\r\n");
+    if (strncasecmp(p, "Content-Length:", 15) == 0)
+      contentLength = atol(p + 15);
+    p = next + 2;
+  }
+  if (contentLength < 0 || body + contentLength > r._buf + HTTP_BUF_SIZE - 1)
+    return -1;
+  if (body + contentLength > r._buf + r._len)
+    return 0;
+  body[contentLength] = 0;
+
+  // Request line: METHOD /path[?query] HTTP/1.x
+  if (strncmp(r._buf, "GET ", 4) == 0)
+    r._method = METHOD_GET;
+  else if (strncmp(r._buf, "POST ", 5) == 0)
+    r._method = METHOD_POST;
+  else
+    return -1;
+  char *path = strchr(r._buf, ' ') + 1;
+  char *sp = strchr(path, ' ');
+  if (*path != '/' || !sp || sp > line)
+    return -1;
+  *sp = 0;
+  char *q = strchr(path, '?');
+  if (q)
+    *q++ = 0;
+  r._path = path;
+  r._query = q;
+  r._body = r._method == METHOD_POST ? body : nullptr;
+
+  // The headers the routes care about
+  r._ifNoneMatch = nullptr;
+  r._gzip = false;
+  while (line < end) {
+    char *next = strstr(line, "\r\n");
+    *next = 0;
+    char *v;
+    if ((v = headerValue(line, "If-None-Match")))
+      r._ifNoneMatch = v;
+    else if ((v = headerValue(line, "Accept-Encoding")))
+      r._gzip = strstr(v, "gzip") != nullptr;
+    line = next + 2;
+  }
+  return 1;
+}
+
+void HttpServer::route(HttpRequest &r) {
+  for (uint8_t i = 0; i < _routeCount; i++) {
+    const Route &rt = _routes[i];
+    if (strcmp(rt.path, r._path) != 0 ||
+        (rt.method != METHOD_ANY && rt.method != r._method))
+      continue;
+    rt.handler(r);
+    if (!r._responded)
+      r.send(500);
+    if (r._state == HttpRequest::FREE)
+      _stats.handedOff++;
+    else if (r._state == HttpRequest::DRAIN)
+      _stats.responses++; // written by the handler itself
+    return;
+  }
+  _stats.badRequests++;
+  r.send(404, "text/plain", "not found");
+}
+
+void HttpServer::read(HttpRequest &r, unsigned long now) {
+  int avail = r._client.available();
+  if (avail <= 0) {
+    if (!r._client.connected()) {
+      close(r);
+    } else if (now - r._since > HTTP_READ_TIMEOUT) {
+      _stats.timeouts++;
+      close(r);
+    }
+    return;
+  }
+
+  size_t room = HTTP_BUF_SIZE - 1 - r._len;
+  r._len += r._client.read((uint8_t *)r._buf + r._len,
+                           (size_t)avail < room ? (size_t)avail : room);
+  r._buf[r._len] = 0;
+
+  int parsed = parse(r);
+  if (parsed == 0 && r._len < HTTP_BUF_SIZE - 1)
+    return; // wait for the rest
+  r._since = now;
+  if (parsed <= 0) {
+    _stats.badRequests++;
+    r._path = "?";
+    r.send(parsed < 0 ? 400 : 413);
+    return;
+  }
+  route(r);
+}
+
+void HttpServer::write(HttpRequest &r, unsigned long now) {
+  if (r._state == HttpRequest::DRAIN) {
+    // Close once the client has acked everything, so stop() never waits
+    if (r._client.availableForWrite() >= r._sndBuf || !r._client.connected() ||
+        now - r._since > HTTP_DRAIN_TIMEOUT)
+      close(r);
+    return;
+  }
+
+  if (!r._client.connected()) {
+    close(r);
+    return;
+  }
+  // As much as the socket takes (at most its send buffer), rendering the
+  // pieces of a generated body as the previous ones go out
+  size_t room = r._client.availableForWrite();
+  size_t sent = 0;
+  while (sent < room) {
+    if (r._off >= r._len && r._fill) {
+      r._len = r._fill(r._buf, r.fillRoom(), r._buf + r.fillRoom(), r._cursor);
+      r._off = 0;
+      if (!r._len)
+        r._fill = nullptr;
+    }
+    size_t free = room - sent, n = 0;
+    if (r._off < r._len) {
+      n = (size_t)(r._len - r._off) < free ? r._len - r._off : free;
+      n = r._client.write((const uint8_t *)r._buf + r._off, n);
+      r._off += n;
+    } else if (r._flash && r._flashOff < r._flashLen) {
+      n = r._flashLen - r._flashOff < free ? r._flashLen - r._flashOff : free;
+      n = r._client.write_P(r._flash + r._flashOff, n);
+      r._flashOff += n;
+    }
+    if (!n)
+      break;
+    sent += n;
+  }
+
+  if (r._off >= r._len && !r._fill &&
+      (!r._flash || r._flashOff >= r._flashLen)) {
+    r._state = HttpRequest::DRAIN;
+    r._since = now;
+    _stats.responses++;
+  } else if (sent) {
+    r._since = now;
+  } else if (now - r._since > HTTP_WRITE_TIMEOUT) {
+    _stats.timeouts++;
+    close(r);
+  }
+}
+
+void HttpServer::loop(unsigned long now) {
+  if (!_started)
+    return;
+
+  // Accept into free slots only; the rest wait in the backlog
+  for (uint8_t i = 0; i < HTTP_MAX_CONNS; i++) {
+    HttpRequest &r = _conns[i];
+    if (r._state != HttpRequest::FREE)
+      continue;
+    WiFiClient c = _server.accept();
+    if (!c)
+      break;
+    r._client = c;
+    r._client.setNoDelay(true);
+    r._sndBuf = r._client.availableForWrite();
+    r._state = HttpRequest::READ;
+    r._len = r._off = r._hdrLen = 0;
+    r._buf[0] = 0;
+    r._flash = nullptr;
+    r._flashLen = r._flashOff = 0;
+    r._fill = nullptr;
+    r._fillLen = r._cursor = r._stateLen = 0;
+    r._responded = false;
+    r._path = r._query = r._body = r._ifNoneMatch = nullptr;
+    r._since = now;
+    _stats.accepted++;
+    uint8_t n = active();
+    if (n > _stats.maxActive)
+      _stats.maxActive = n;
+  }
+
+  for (uint8_t i = 0; i < HTTP_MAX_CONNS; i++) {
+    HttpRequest &r = _conns[i];
+    if (r._state == HttpRequest::READ)
+      read(r, now);
+    else if (r._state != HttpRequest::FREE)
+      write(r, now);
+  }
+}
+
+void HttpServer::print(Print &out) const {
+  out.printf("HTTP: %lu conns (max %u at once), %lu responses, %lu handed "
+             "off, %lu bad, %lu timeouts\n",
+             (unsigned long)_stats.accepted, _stats.maxActive,
+             (unsigned long)_stats.responses, (unsigned long)_stats.handedOff,
+             (unsigned long)_stats.badRequests,
+             (unsigned long)_stats.timeouts);
+}
@@ -0,0 +1,74 @@
+#include "loop_logic.h"
+#include "debug_log.h"
+
+LoopLogic::LoopLogic(UiLogic &ui, FrameScheduler &frames, WeatherCache &cache,
+                     TinyGPSPlus &gps)
+    : _ui(ui), _frames(frames), _cache(cache), _gps(gps), _vcc(0), _cell(0),
+      _fetchAt(0) {}
+
+void LoopLogic::begin() {
+  // Last known weather drives the icon until GPS/WiFi catch up
+  if (const WeatherCacheEntry *e = _cache.latest())
+    _ui.setWeather(e->code, e->isDay, false);
+}
+
+uint32_t LoopLogic::epoch() const {
+  if (!_gps.date.isValid() || !_gps.time.isValid() || _gps.date.year() < 2020)
+    return 0;
+  return WeatherCache::epochFrom(_gps.date.year(), _gps.date.month(),
+                                 _gps.date.day(), _gps.time.hour(),
+                                 _gps.time.minute(), _gps.time.second()) +
+         _gps.time.age() / 1000;
+}
+
+uint8_t LoopLogic::pass(unsigned long now, bool online, bool fetching) {
+  uint8_t flags = 0;
+
+  // Blinks and animations; battery, GPS and face once a second
+  _ui.setWifi(online);
+  if (_ui.loop(now)) {
+    _vcc = ESP.getVcc();
+    _ui.update(now, _vcc, _gps);
+    flags |= PASS_UPDATE;
+  }
+
+  if (_ui.fix() && !fetching)
+    flags |= scheduleWeather(now, online);
+
+  // At most one frame per pass, whatever asked for it
+  if (_frames.due(now))
+    flags |= PASS_FRAME;
+  return flags;
+}
+
+// Cache first, network only when the location cell changes or the data is
+// older than WEATHER_REFRESH_MS
+uint8_t LoopLogic::scheduleWeather(unsigned long now, bool online) {
+  uint32_t cell = WeatherCache::cellFor(_gps.location.lat(),
+                                        _gps.location.lng());
+  if (cell == _cell && now - _fetchAt <= WEATHER_REFRESH_MS && _fetchAt)
+    return 0;
+
+  const WeatherCacheEntry *e = _cache.lookup(cell);
+  uint32_t epoch = this->epoch();
+  uint32_t age = (e && epoch && epoch >= e->fetchedAt) ? epoch - e->fetchedAt
+                                                       : UINT32_MAX;
+  if (cell != _cell && age < WEATHER_REFRESH_MS / 1000) {
+    _ui.setWeather(e->code, e->isDay);
+    _cell = cell;
+    _fetchAt = now - age * 1000; // refetch when it goes stale
+    LOG.printf("Weather: cached Code=%d isDay=%d (%lus old)\n", e->code,
+               e->isDay, (unsigned long)age);
+    return PASS_CACHED;
+  }
+  if (!online)
+    return 0;
+  _cell = cell;
+  _fetchAt = now;
+  return PASS_FETCH;
+}
+
+void LoopLogic::weatherResult(int code, int isDay) {
+  _ui.setWeather(code, isDay);
+  _cache.store(_cell, code, isDay, epoch());
+}
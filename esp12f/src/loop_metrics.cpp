@@ -0,0 +1,115 @@
+#include "loop_metrics.h"
+
+// Upper bucket bounds in microseconds
+static const uint32_t BOUNDS_US[METRICS_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000};
+
+const char *LoopMetrics::name(uint8_t s) {
+  static const char *const names[] = {"http", "gps",     "sensors", "draw",
+                                      "flush", "weather", "loop"};
+  return s < LS_SECTIONS ? names[s] : "?";
+}
+
+void LoopMetrics::reset() { memset(_h, 0, sizeof(_h)); }
+
+void LoopMetrics::add(LoopSection s, uint32_t cycles) {
+  LatencyHistogram &h = _h[s];
+  uint32_t us = cycles / ESP.getCpuFreqMHz();
+  uint8_t b = 0;
+  while (b < METRICS_BUCKETS && us > BOUNDS_US[b])
+    b++;
+  h.buckets[b]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs)
+    h.maxUs = us;
+  if (us > METRICS_STALL_US)
+    h.stalls++;
+}
+
+// Microseconds as seconds with 6 decimals, without floating point
+static void printSeconds(Print &out, uint64_t us) {
+  out.printf("%lu.%06lu", (unsigned long)(us / 1000000),
+             (unsigned long)(us % 1000000));
+}
+
+void LoopMetrics::write(Print &out) const {
+  for (uint16_t i = 0; writePart(i, out); i++)
+    ;
+}
+
+// Parts: the histogram help, per section a part per bucket plus one for
+// +Inf, sum and count; the max help and a part per section; the same for
+// the stalls
+bool LoopMetrics::writePart(uint16_t part, Print &out) const {
+  const uint16_t perSection = METRICS_BUCKETS + 1;
+  if (part == 0) {
+    out.print(F("# HELP esp12f_loop_section_seconds Time per loop() section\n"
+                "# TYPE esp12f_loop_section_seconds histogram\n"));
+    return true;
+  }
+  part--;
+  if (part < LS_SECTIONS * perSection) {
+    uint8_t s = part / perSection, b = part % perSection;
+    const LatencyHistogram &h = _h[s];
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i <= b; i++)
+      cumulative += h.buckets[i];
+    out.printf("esp12f_loop_section_seconds_bucket{section=\"%s\",le=\"",
+               name(s));
+    if (b < METRICS_BUCKETS) {
+      printSeconds(out, BOUNDS_US[b]);
+      out.printf("\"} %lu\n", (unsigned long)cumulative);
+      return true;
+    }
+    out.printf("+Inf\"} %lu\n", (unsigned long)cumulative);
+    out.printf("esp12f_loop_section_seconds_sum{section=\"%s\"} ", name(s));
+    printSeconds(out, h.sumUs);
+    out.printf("\nesp12f_loop_section_seconds_count{section=\"%s\"} %lu\n",
+               name(s), (unsigned long)h.count);
+    return true;
+  }
+  part -= LS_SECTIONS * perSection;
+
+  if (part == 0) {
+    out.print(F("# HELP esp12f_loop_section_max_seconds Longest pass per "
+                "section\n# TYPE esp12f_loop_section_max_seconds gauge\n"));
+    return true;
+  }
+  if (part <= LS_SECTIONS) {
+    uint8_t s = part - 1;
+    out.printf("esp12f_loop_section_max_seconds{section=\"%s\"} ", name(s));
+    printSeconds(out, _h[s].maxUs);
+    out.print('\n');
+    return true;
+  }
+  part -= LS_SECTIONS + 1;
+
+  if (part == 0) {
+    out.printf("# HELP esp12f_loop_section_stalls_total Passes over %u us\n"
+               "# TYPE esp12f_loop_section_stalls_total counter\n",
+               METRICS_STALL_US);
+    return true;
+  }
+  if (part <= LS_SECTIONS) {
+    uint8_t s = part - 1;
+    out.printf("esp12f_loop_section_stalls_total{section=\"%s\"} %lu\n",
+               name(s), (unsigned long)_h[s].stalls);
+    return true;
+  }
+  return false;
+}
+
+void LoopMetrics::print(Print &out) const {
+  out.println(F("Loop:     count    avg us    max us  stalls  "
+                "<=50us..<=100ms,+Inf"));
+  for (uint8_t s = 0; s < LS_SECTIONS; s++) {
+    const LatencyHistogram &h = _h[s];
+    out.printf("  %-7s %7lu %9lu %9lu %7lu ", name(s), (unsigned long)h.count,
+               h.count ? (unsigned long)(h.sumUs / h.count) : 0UL,
+               (unsigned long)h.maxUs, (unsigned long)h.stalls);
+    for (uint8_t b = 0; b <= METRICS_BUCKETS; b++)
+      out.printf(b ? ",%lu" : " %lu", (unsigned long)h.buckets[b]);
+    out.print('\n');
+  }
+}
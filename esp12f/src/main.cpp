@@ -1,15 +1,30 @@
-#include "Org_01.h"
+#include "counting_display.h"
+#include "dht_reader.h"
+#include "frame_scheduler.h"
+#include "gps_config.h"
+#include "gps_input.h"
+#include "http_server.h"
+#include "loop_logic.h"
+#include "loop_metrics.h"
+#include "oled_flush.h"
+#include "power_governor.h"
+#include "sensor_filter.h"
+#include "sse_hub.h"
+#include "telemetry.h"
+#include "track_export.h"
+#include "track_log.h"
+#include "track_simplify.h"
+#include "ui_logic.h"
+#include "ui_render.h"
+#include "weather_cache.h"
+#include "weather_fetch.h"
+#include "web_assets.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Arduino.h>
-#include <ArduinoJson.h>
-#include <DHT.h>
 #include <EEPROM.h>
-#include <ESP8266HTTPClient.h>
-#include <ESP8266WebServer.h>
 #include <ESP8266WiFi.h>
 #include <ESP8266mDNS.h>
-#include <SoftwareSerial.h>
 #include <TinyGPSPlus.h>
 #include <WiFiClient.h>
 #include <Wire.h>
@@ -23,61 +38,73 @@ ADC_MODE(ADC_VCC);
 #define OLED_SDA 2
 #define OLED_SCL 14
 
-#define GPS_RX 12
+#define GPS_RX 12 // SoftwareSerial pins (GPS_HW_UART 0)
 #define GPS_TX 13
+#if GPS_HW_UART && LOG_UART1 && OLED_SDA == 2
+#error "UART1 TX is GPIO2 (OLED SDA): move the OLED before enabling LOG_UART1"
+#endif
 #define DHTPIN 5
-#define DHTTYPE DHT11
 
 #define LED_BOARD 4 // NodeMCU board LED (GPIO4 = D2)
 
-#define EEPROM_SIZE 96
+#define UI_MAX_FPS 20 // upper bound on frames rendered + flushed per second
+
+#define EEPROM_SIZE 192
 #define SSID_ADDR 0
 #define PASS_ADDR 32
 #define SSID_MAX 32
 #define PASS_MAX 64
-
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-SoftwareSerial gpsSerial(GPS_RX, GPS_TX);
+#define NET_CACHE_ADDR 96 // last BSSID/channel/lease (struct NetCache)
+#define WX_CACHE_ADDR 128 // weather results per location cell (WeatherCache)
+
+// Reuse the cached DHCP lease as a static config on the fast path (skips
+// DHCP). Off by default: a static config is never renewed, so once the
+// lease expires the router may hand the address to another host. Only turn
+// it on where the address is reserved for this device.
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE 0
+#endif
+
+CountingSSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+UiRenderer ui(display);
+OledFlush oled(display, Wire, SCREEN_ADDRESS);
+FrameScheduler frames(UI_MAX_FPS);
+PowerGovernor power(frames, display, UI_MAX_FPS);
+GpsInput gpsIn(GPS_RX, GPS_TX);
 TinyGPSPlus gps;
-DHT dht(DHTPIN, DHTTYPE);
-ESP8266WebServer server(80);
-
-// Face States
-enum FaceState {
-  FACE_NORMAL,
-  FACE_HAPPY,
-  FACE_SLEEPY,
-  FACE_SURPRISED,
-  FACE_LOOK
-};
-FaceState currentFace = FACE_NORMAL;
-unsigned long faceStateStart = 0;
-
-// UI Variables
-String ui_time = "00:00:00";
-String ui_date = "00/00/00";
-
-String ui_temp = "--";
-String ui_hum = "--";
-String ui_lat = "-0.00";
-String ui_lon = "-0.00";
-bool hasGPSFix = false;
-int batteryLevel = 3;
-int gpsBars = 0;
-float lastTemp = 0;
-unsigned long lastTempChange = 0;
-unsigned long noFixSince = 0;
-int lookPhase = 0;
+GpsConfig gpsCfg(gpsIn, gps);
+TrackLog track;
+TrackSimplifier trackFilter;
+TrackExport trackExport(track);
+
+// Runs a fix through the simplifier; only kept points reach the log
+void trackFix(const TrackPoint &fix) {
+  TrackPoint kept;
+  if (fix.epoch && trackFilter.push(fix, kept))
+    track.add(kept.epoch, kept.lat, kept.lon);
+}
+
+// Closes the current segment (fix lost, restart)
+void trackEnd() {
+  TrackPoint kept;
+  if (trackFilter.flush(kept))
+    track.add(kept.epoch, kept.lat, kept.lon);
+}
+DhtReader dht(DHTPIN);
+HttpServer server(80);
+
+// UI Variables (telemetry values shared by the OLED and the web API)
+Telemetry tel;
+UiLogic logic(tel, frames); // face, blinks, GPS fix/clock
+HeapReport heap;
+LoopMetrics metrics;
+SseHub events(tel);
+unsigned long lastHeapReport = 0;
+const unsigned long heapReportInterval = 60000;
 
 // WiFi & Icon State
 bool wifiConnected = false;
 bool apMode = false;
-bool battBlinkState = true;
-bool iconBlinkState = true;
-unsigned long lastBattBlink = 0;
-unsigned long lastIconBlink = 0;
-bool showDate = false;
-unsigned long lastDateToggle = 0;
 bool ledState = false; // LED on/off
 
 // EEPROM Helpers
@@ -98,433 +125,417 @@ void writeEEPROM(int addr, String data, int maxLen) {
   }
   EEPROM.commit();
 }
-// Captive Portal HTML (Turbinado)
-const char PORTAL_HTML[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="pt-BR">
-<head>
-  <meta charset='UTF-8'>
-  <meta name='viewport' content='width=device-width,initial-scale=1'>
-  <title>ESP12F Setup</title>
-  <style>
-    :root { --primary: #00f3ff; --accent: #bc13fe; --bg-dark: #0f172a; --card-bg: #1e293b; }
-    body { font-family: 'Segoe UI', sans-serif; background: var(--bg-dark); color: #e2e8f0; display: flex; justify-content: center; align-items: center; min-height: 100vh; margin: 0; overflow: hidden; }
-    .card { background: var(--card-bg); padding: 40px; border-radius: 20px; width: 320px; box-shadow: 0 0 30px rgba(0, 243, 255, 0.1); position: relative; border: 1px solid rgba(255,255,255,0.05); }
-    h2 { margin: 0 0 25px; text-align: center; font-weight: 300; letter-spacing: 2px; text-transform: uppercase; background: linear-gradient(to right, var(--primary), var(--accent)); -webkit-background-clip: text; -webkit-text-fill-color: transparent; }
-    input { width: 100%; padding: 14px; margin: 10px 0; border: 2px solid #334155; border-radius: 8px; background: #0f172a; color: #fff; box-sizing: border-box; transition: 0.3s; }
-    input:focus { border-color: var(--primary); outline: none; box-shadow: 0 0 10px rgba(0, 243, 255, 0.3); }
-    .checkbox-container { display: flex; align-items: center; font-size: 0.85rem; color: #94a3b8; margin: 5px 0 15px; cursor: pointer; }
-    .checkbox-container input { width: auto; margin-right: 8px; cursor: pointer; }
-    button { width: 100%; padding: 14px; border: none; border-radius: 8px; background: linear-gradient(135deg, var(--primary), var(--accent)); color: #fff; font-size: 16px; font-weight: bold; cursor: pointer; transition: transform 0.2s, box-shadow 0.2s; text-transform: uppercase; letter-spacing: 1px; }
-    button:hover { transform: translateY(-2px); box-shadow: 0 5px 20px rgba(0, 243, 255, 0.4); }
-    button:active { transform: scale(0.98); }
-    .footer { text-align: center; margin-top: 20px; font-size: 0.75rem; opacity: 0.5; }
-  </style>
-</head>
-<body>
-  <div class='card'>
-    <h2>WiFi Config</h2>
-    <form action='/save' method='POST'>
-      <input name='ssid' placeholder='Nome da Rede (SSID)' required>
-      <input name='pass' id='passInput' type='password' placeholder='Senha' required>
-      <label class='checkbox-container'>
-        <input type='checkbox' onchange="document.getElementById('passInput').type = this.checked ? 'text' : 'password'"> Mostrar Senha
-      </label>
-      <button type='submit'>Conectar</button>
-    </form>
-    <div class='footer'>ESP12F Smart System</div>
-  </div>
-</body>
-</html>)rawliteral";
-
-// Dashboard HTML (Moderno com AJAX)
-const char DASHBOARD_HTML[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="pt-BR">
-<head>
-  <meta charset="UTF-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1.0">
-  <title>ESP12F Dashboard</title>
-  <style>
-    :root { --primary: #00f3ff; --accent: #bc13fe; --bg-dark: #0f172a; --card-bg: #1e293b; --text-main: #e2e8f0; --text-muted: #94a3b8; }
-    body { font-family: 'Segoe UI', sans-serif; background: var(--bg-dark); color: var(--text-main); margin: 0; padding: 20px; display: flex; justify-content: center; min-height: 100vh; }
-    .container { width: 100%; max-width: 400px; }
-    .header { text-align: center; margin-bottom: 30px; }
-    .header h1 { margin: 0; font-size: 1.5rem; letter-spacing: 3px; text-transform: uppercase; background: linear-gradient(to right, var(--primary), var(--accent)); -webkit-background-clip: text; -webkit-text-fill-color: transparent; }
-    
-    .grid { display: grid; grid-template-columns: 1fr 1fr; gap: 15px; }
-    .card { background: var(--card-bg); padding: 15px; border-radius: 15px; border: 1px solid rgba(255,255,255,0.05); box-shadow: 0 4px 15px rgba(0,0,0,0.2); display: flex; flex-direction: column; justify-content: space-between; transition: transform 0.2s; }
-    .card:hover { transform: translateY(-2px); }
-    
-    .icon { width: 24px; height: 24px; fill: var(--primary); margin-bottom: 10px; }
-    .label { font-size: 0.75rem; color: var(--text-muted); text-transform: uppercase; letter-spacing: 1px; margin-bottom: 5px; }
-    .value { font-size: 1.4rem; font-weight: bold; color: var(--text-main); }
-    .value.highlight { color: var(--primary); text-shadow: 0 0 10px rgba(0, 243, 255, 0.4); }
-
-    .card-full { grid-column: span 2; }
-    .btn-led { width: 100%; padding: 16px; border: none; border-radius: 12px; background: linear-gradient(135deg, #334155, #1e293b); color: var(--text-muted); font-size: 1rem; font-weight: bold; cursor: pointer; transition: all 0.3s; display: flex; align-items: center; justify-content: center; gap: 10px; border: 1px solid rgba(255,255,255,0.05); margin-top: 15px; }
-    .btn-led.active { background: linear-gradient(135deg, var(--primary), var(--accent)); color: #fff; box-shadow: 0 0 20px rgba(0, 243, 255, 0.4); }
-    
-    .status-dot { width: 10px; height: 10px; border-radius: 50%; background: #ef4444; transition: background 0.3s; }
-    .status-dot.fixed { background: #22c55e; box-shadow: 0 0 10px #22c55e; }
-  </style>
-</head>
-<body>
-  <div class="container">
-    <div class="header">
-      <h1>ESP12F Monitor</h1>
-    </div>
-    
-    <div class="grid">
-      <!-- Temperatura -->
-      <div class="card">
-        <div>
-          <svg class="icon" viewBox="0 0 24 24"><path d="M15 13V5a3 3 0 0 0-6 0v8a5 5 0 1 0 6 0m-3-9a1 1 0 0 1 1 1v3h-2V5a1 1 0 0 1 1-1z"/></svg>
-          <div class="label">Temperatura</div>
-        </div>
-        <div class="value highlight" id="temp">--°C</div>
-      </div>
-
-      <!-- Umidade -->
-      <div class="card">
-        <div>
-          <svg class="icon" viewBox="0 0 24 24"><path d="M12 2.69l5.66 5.66a8 8 0 1 1-11.31 0zm0 2.83L8.49 9.17a5 5 0 1 0 7.02 0z"/></svg>
-          <div class="label">Umidade</div>
-        </div>
-        <div class="value" id="hum">--%</div>
-      </div>
-
-      <!-- Data/Hora -->
-      <div class="card card-full" style="flex-direction: row; justify-content: space-between; align-items: center;">
-        <div>
-          <div class="label">Data</div>
-          <div class="value" id="date" style="font-size: 1.1rem">--</div>
-        </div>
-        <div style="text-align: right">
-          <div class="label">Hora</div>
-          <div class="value highlight" id="time" style="font-size: 1.1rem">--:--</div>
-        </div>
-      </div>
-
-      <!-- GPS -->
-      <div class="card card-full">
-        <div style="display: flex; justify-content: space-between; align-items: center;">
-          <div>
-            <div class="label">Localização</div>
-            <div class="value" id="coords" style="font-size: 0.9rem">Lat: --, Lon: --</div>
-          </div>
-          <div style="display: flex; align-items: center; gap: 8px;">
-            <span class="label" id="gpsLabel">No Fix</span>
-            <div class="status-dot" id="gpsDot"></div>
-          </div>
-        </div>
-      </div>
-
-      <!-- LED Control -->
-      <div class="card card-full" style="background: transparent; border: none; box-shadow: none; padding: 0;">
-        <button class="btn-led" id="btnLed" onclick="toggleLed()">
-          <svg style="width:20px; height:20px; fill:currentColor;" viewBox="0 0 24 24"><path d="M9 21c0 .5.4 1 1 1h4c.6 0 1-.5 1-1v-1H9v1zm3-19C8.1 2 5 5.1 5 9c0 2.4 1.2 4.5 3 5.7V17c0 .5.4 1 1 1h6c.6 0 1-.5 1-1v-2.3c1.8-1.3 3-3.4 3-5.7 0-3.9-3.1-7-7-7z"/></svg>
-          <span id="btnText">Ligar LED</span>
-        </button>
-      </div>
-    </div>
-  </div>
-
-<script>
-  function updateData() {
-    fetch('/data')
-      .then(response => response.json())
-      .then(data => {
-        document.getElementById('temp').innerText = data.temp + '°C';
-        document.getElementById('hum').innerText = data.hum + '%';
-        document.getElementById('time').innerText = data.time;
-        document.getElementById('date').innerText = data.date;
-        document.getElementById('coords').innerText = 'Lat: ' + data.lat + ', Lon: ' + data.lon;
-        
-        const dot = document.getElementById('gpsDot');
-        const label = document.getElementById('gpsLabel');
-        if(data.gps == 1) {
-          dot.classList.add('fixed');
-          label.innerText = 'Fix OK';
-        } else {
-          dot.classList.remove('fixed');
-          label.innerText = 'Searching...';
-        }
-        
-        updateButton(data.led);
-      })
-      .catch(err => console.log('Erro ao atualizar', err));
+
+// Web pages (web/*.html, gzipped at build time by tools/embed_web.py)
+#define ASSET_CACHE_CONTROL "public, max-age=86400"
+
+void sendAsset(HttpRequest &req, const WebAsset &asset) {
+  bool gz = req.acceptsGzip();
+  const char *etag = gz ? asset.etagGz : asset.etag;
+  req.sendHeader(F("ETag"), etag);
+  req.sendHeader(F("Cache-Control"), F(ASSET_CACHE_CONTROL));
+  req.sendHeader(F("Vary"), F("Accept-Encoding"));
+
+  if (req.ifNoneMatch() && strcmp(req.ifNoneMatch(), etag) == 0) {
+    req.send(304);
+    return;
+  }
+  if (gz) {
+    req.sendHeader(F("Content-Encoding"), F("gzip"));
+    req.send_P(200, asset.type, (const char *)asset.gz, asset.gzLen);
+    return;
   }
+  req.send_P(200, asset.type, asset.plain, asset.plainLen);
+}
 
-  function updateButton(state) {
-    const btn = document.getElementById('btnLed');
-    const txt = document.getElementById('btnText');
-    if(state == 1) {
-      btn.classList.add('active');
-      txt.innerText = 'LED Ligado';
-    } else {
-      btn.classList.remove('active');
-      txt.innerText = 'LED Desligado';
+// /data JSON, reserialized only when the telemetry version changes
+static char dataJson[160];
+static size_t dataJsonLen = 0;
+static uint32_t dataJsonVersion = 0;
+static char dataETag[24];
+static uint32_t bootTag = 0; // keeps ETags from matching across reboots
+uint32_t dataServed = 0, dataNotModified = 0;
+
+// /events: hands the connection to the SSE hub, which keeps it open
+void handleEvents(HttpRequest &req) {
+  if (!events.add(req.client())) {
+    req.send(503, "text/plain", "busy");
+    return;
+  }
+  req.client().print(
+      F("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n"));
+  req.detach();
+}
+
+// The server's own counters, heap and uptime, after the other metrics
+static void writeServerMetrics(Print &out) {
+  const HttpStats &hs = server.stats();
+  out.printf("# TYPE esp12f_http_connections_total counter\n"
+             "esp12f_http_connections_total %lu\n"
+             "# TYPE esp12f_http_timeouts_total counter\n"
+             "esp12f_http_timeouts_total %lu\n"
+             "# TYPE esp12f_http_active_connections gauge\n"
+             "esp12f_http_active_connections %u\n"
+             "# TYPE esp12f_heap_free_bytes gauge\n"
+             "esp12f_heap_free_bytes %lu\n"
+             "# TYPE esp12f_uptime_seconds counter\n"
+             "esp12f_uptime_seconds %lu\n",
+             (unsigned long)hs.accepted, (unsigned long)hs.timeouts,
+             server.active(), (unsigned long)ESP.getFreeHeap(),
+             millis() / 1000);
+}
+
+// /metrics body, a slot buffer at a time: cursor is source << 16 | part
+// (loop sections, power, server). state is the reset flag, acted on once
+// the last part is out.
+static size_t metricsFill(char *buf, size_t room, void *state,
+                          uint32_t &cursor) {
+  HttpChunk out(buf, room);
+  for (;;) {
+    uint16_t part = cursor & 0xFFFF;
+    bool more;
+    switch (cursor >> 16) {
+    case 0:
+      more = metrics.writePart(part, out);
+      break;
+    case 1:
+      more = power.writePart(part, out);
+      break;
+    case 2:
+      more = part == 0;
+      if (more)
+        writeServerMetrics(out);
+      break;
+    default:
+      if (*(bool *)state) {
+        metrics.reset();
+        *(bool *)state = false;
+      }
+      return out.length();
     }
+    if (!more)
+      cursor = ((cursor >> 16) + 1) << 16;
+    else if (out.commit())
+      cursor++;
+    else
+      return out.length(); // the part goes first in the next piece
+  }
+}
+
+// /metrics[?reset=1]: loop section latencies in Prometheus text format.
+// About 8 KB, generated as the client acks it, so a slow scraper costs the
+// loop at most a send buffer's worth of printf per pass instead of a wait
+// on the socket. Parts are rendered when they go out, not snapshotted: a
+// section's buckets may come from a few passes apart, never inconsistent.
+void handleMetrics(HttpRequest &req) {
+  bool reset = req.arg("reset") == "1";
+  req.sendHeader(F("Cache-Control"), F("no-store"));
+  req.sendGenerated(200, "text/plain; version=0.0.4", metricsFill, &reset,
+                    sizeof(reset));
+}
+
+// /track.gpx, /track.geojson [?from=<epoch>&to=<epoch>], streamed from loop()
+void handleTrack(HttpRequest &req, TrackFormat format) {
+  long from = req.arg("from").toInt();
+  long to = req.arg("to").toInt();
+  if (!track.ready() ||
+      !trackExport.start(req.client(), format, from > 0 ? from : 0,
+                         to > 0 ? to : 0)) {
+    req.send(503, "text/plain", "busy");
+    return;
+  }
+  req.detach();
+}
+
+void handleData(HttpRequest &req) {
+  if (dataJsonVersion != tel.version) {
+    dataJsonVersion = tel.version;
+    dataJsonLen = tel.toJson(dataJson, sizeof(dataJson));
+    snprintf(dataETag, sizeof(dataETag), "\"%lx-%lx\"", (unsigned long)bootTag,
+             (unsigned long)dataJsonVersion);
   }
 
-  function toggleLed() {
-    fetch('/led')
-      .then(response => response.json())
-      .then(data => updateButton(data.led));
+  req.sendHeader(F("ETag"), dataETag);
+  req.sendHeader(F("Cache-Control"), F("no-cache"));
+
+  if (req.ifNoneMatch() && strcmp(req.ifNoneMatch(), dataETag) == 0) {
+    dataNotModified++;
+    req.send(304);
+    return;
   }
+  dataServed++;
+  req.send(200, "application/json", dataJson, dataJsonLen);
+}
+
+// Boot timeline (ms since power-up, 0 = not reached yet)
+struct BootTimeline {
+  unsigned long firstFrame;
+  unsigned long firstGpsSentence;
+  unsigned long wifiStart;
+  unsigned long wifiUp;
+};
+BootTimeline boot = {0, 0, 0, 0};
+
+void bootMark(unsigned long &slot, const char *what) {
+  if (slot)
+    return;
+  slot = millis();
+  LOG.printf("Boot: %s at %lums\n", what, slot);
+}
+
+// Last successful association, stored next to the credentials
+#define NET_CACHE_MAGIC 0x4E455431UL // "NET1"
+struct NetCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip, gateway, mask, dns;
+};
+NetCache netCache;
+static_assert(NET_CACHE_ADDR + sizeof(NetCache) <= WX_CACHE_ADDR,
+              "NetCache overlaps the weather cache");
+static_assert(WX_CACHE_ADDR + WeatherCache::STORAGE_SIZE <= EEPROM_SIZE,
+              "EEPROM_SIZE too small for the weather cache");
+
+bool netCacheValid() {
+  return netCache.magic == NET_CACHE_MAGIC && netCache.channel >= 1 &&
+         netCache.channel <= 14;
+}
+
+void saveNetCache() {
+  NetCache c;
+  memset(&c, 0, sizeof(c));
+  c.magic = NET_CACHE_MAGIC;
+  memcpy(c.bssid, WiFi.BSSID(), sizeof(c.bssid));
+  c.channel = WiFi.channel();
+  c.ip = (uint32_t)WiFi.localIP();
+  c.gateway = (uint32_t)WiFi.gatewayIP();
+  c.mask = (uint32_t)WiFi.subnetMask();
+  c.dns = (uint32_t)WiFi.dnsIP();
+  if (memcmp(&c, &netCache, sizeof(c)) == 0)
+    return; // unchanged, spare the flash
+  netCache = c;
+  EEPROM.put(NET_CACHE_ADDR, netCache);
+  EEPROM.commit();
+}
+
+void clearNetCache() {
+  memset(&netCache, 0, sizeof(netCache));
+  EEPROM.put(NET_CACHE_ADDR, netCache);
+  EEPROM.commit();
+}
 
-  // Atualiza a cada 3 segundos
-  setInterval(updateData, 3000);
-  updateData(); // Chamada inicial
-</script>
-</body>
-</html>)rawliteral";
+// WiFi connection state machine, advanced from loop() by wifiLoop()
+enum NetState { NET_CONNECTING, NET_UP, NET_DOWN, NET_AP };
+NetState netState = NET_CONNECTING;
+unsigned long netStateStart = 0;
+const unsigned long wifiConnectTimeout = 10000;
+const unsigned long wifiFastTimeout = 3000; // direct-channel attempt
+bool netFastPath = false;
+bool staRoutesReady = false;
+unsigned long restartAt = 0; // set by /save, 0 = none
+char netSsid[SSID_MAX + 1];
+char netPass[PASS_MAX + 1];
+
+void startAP();
+void handleFrame(HttpRequest &req);
+
+// Full scan-and-associate (DHCP)
+void wifiBeginScan() {
+  netFastPath = false;
+  WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0),
+              IPAddress(0, 0, 0, 0)); // back to DHCP
+  WiFi.begin(netSsid, netPass);
+}
 
-// WiFi Setup (Atualizado)
+// Direct connect to the cached BSSID/channel, skipping the scan
+void wifiBeginFast() {
+  netFastPath = true;
+#if WIFI_REUSE_LEASE
+  if (netCache.ip) {
+    WiFi.config(IPAddress(netCache.ip), IPAddress(netCache.gateway),
+                IPAddress(netCache.mask), IPAddress(netCache.dns));
+  }
+#endif
+  WiFi.begin(netSsid, netPass, netCache.channel, netCache.bssid);
+}
+
+// WiFi Setup (non-blocking: starts association or the AP and returns)
 void setupWiFi() {
   EEPROM.begin(EEPROM_SIZE);
   String ssid = readEEPROM(SSID_ADDR, SSID_MAX);
   String pass = readEEPROM(PASS_ADDR, PASS_MAX);
+  EEPROM.get(NET_CACHE_ADDR, netCache);
 
   if (ssid.length() > 0) {
-    Serial.printf("WiFi: Connecting to '%s'...\n", ssid.c_str());
+    strlcpy(netSsid, ssid.c_str(), sizeof(netSsid));
+    strlcpy(netPass, pass.c_str(), sizeof(netPass));
+    WiFi.persistent(false); // we keep our own copy in EEPROM
     WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid.c_str(), pass.c_str());
-
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-      delay(500);
-      Serial.print(".");
-      attempts++;
+    if (netCacheValid()) {
+      LOG.printf("WiFi: Connecting to '%s' (cached ch %u)...\n", netSsid,
+                 netCache.channel);
+      wifiBeginFast();
+    } else {
+      LOG.printf("WiFi: Connecting to '%s'...\n", netSsid);
+      wifiBeginScan();
     }
+    netState = NET_CONNECTING;
+    netStateStart = millis();
+    boot.wifiStart = netStateStart;
+    return;
+  }
+  startAP();
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-      wifiConnected = true;
-      apMode = false;
-      Serial.printf("\nWiFi OK! IP: %s\n", WiFi.localIP().toString().c_str());
+// First successful association: mDNS + dashboard routes
+void onWiFiUp() {
+  wifiConnected = true;
+  apMode = false;
+  netState = NET_UP;
+  bootMark(boot.wifiUp, "WiFi up");
+  LOG.printf("WiFi OK! IP: %s (associated in %lums, %s)\n",
+             WiFi.localIP().toString().c_str(),
+             boot.wifiUp - boot.wifiStart,
+             netFastPath ? "cached BSSID" : "full scan");
+  saveNetCache();
+
+  if (staRoutesReady)
+    return;
+  staRoutesReady = true;
+
+  if (MDNS.begin("12f")) {
+    LOG.println(F("mDNS: http://12f.local"));
+  }
 
-      if (MDNS.begin("12f")) {
-        Serial.println(F("mDNS: http://12f.local"));
-      }
+  // --- ROTA: Dashboard Principal ---
+  server.on("/", [](HttpRequest &req) {
+    sendAsset(req, DASHBOARD_ASSET);
+  });
 
-      // --- ROTA: Dashboard Principal ---
-      server.on("/", []() {
-        server.send_P(200, "text/html", DASHBOARD_HTML);
-      });
-
-      // --- ROTA: API de Dados (JSON) ---
-      server.on("/data", []() {
-        String json = "{";
-        json += "\"temp\":\"" + ui_temp + "\",";
-        json += "\"hum\":\"" + ui_hum + "\",";
-        json += "\"time\":\"" + ui_time + "\",";
-        json += "\"date\":\"" + ui_date + "\",";
-        json += "\"lat\":\"" + ui_lat + "\",";
-        json += "\"lon\":\"" + ui_lon + "\",";
-        json += "\"gps\":\"" + String(hasGPSFix ? "1" : "0") + "\",";
-        json += "\"led\":" + String(ledState ? "1" : "0");
-        json += "}";
-        server.send(200, "application/json", json);
-      });
-
-      // --- ROTA: Toggle LED (API) ---
-      server.on("/led", []() {
-        ledState = !ledState;
-        digitalWrite(LED_BOARD, ledState ? LOW : HIGH);
-        
-        // Retorna JSON ao invés de redirect para o JS processar
-        String json = "{\"led\":" + String(ledState ? "1" : "0") + "}";
-        server.send(200, "application/json", json);
-      });
-
-      server.begin();
-      return;
-    }
-    Serial.println("\nWiFi: Connection failed.");
-  }
+  // --- ROTA: API de Dados (JSON) ---
+  server.on("/data", handleData);
+  server.on("/events", handleEvents);
+
+  // --- ROTA: Trilha GPS (GPX / GeoJSON) ---
+  server.on("/track.gpx",
+            [](HttpRequest &req) { handleTrack(req, TRACK_GPX); });
+  server.on("/track.geojson",
+            [](HttpRequest &req) { handleTrack(req, TRACK_GEOJSON); });
+
+  // --- ROTA: Captura do frame (PBM) ---
+  server.on("/frame.pbm", handleFrame);
+
+  // --- ROTA: Latência do loop (Prometheus) ---
+  server.on("/metrics", handleMetrics);
 
-  // --- MODO AP (Captive Portal) ---
+  // --- ROTA: Toggle LED (API) ---
+  server.on("/led", [](HttpRequest &req) {
+    ledState = !ledState;
+    digitalWrite(LED_BOARD, ledState ? LOW : HIGH);
+    frames.request(); // LED star on the OLED
+    tel.setLed(ledState);
+
+    // Retorna JSON ao invés de redirect para o JS processar
+    req.send(200, "application/json",
+             ledState ? "{\"led\":1}" : "{\"led\":0}");
+  });
+
+  server.begin();
+}
+
+// --- MODO AP (Captive Portal) ---
+void startAP() {
+  netState = NET_AP;
   apMode = true;
   wifiConnected = false;
   WiFi.mode(WIFI_AP);
   WiFi.softAP("ESP12F-Setup", "");
-  Serial.printf("AP Mode: Connect to 'ESP12F-Setup' -> 192.168.4.1\n");
+  LOG.printf("AP Mode: Connect to 'ESP12F-Setup' -> 192.168.4.1\n");
 
-  server.on("/", []() { server.send_P(200, "text/html", PORTAL_HTML); });
+  server.on("/", [](HttpRequest &req) { sendAsset(req, PORTAL_ASSET); });
 
-  server.on("/save", HTTP_POST, []() {
-    String ssid = server.arg("ssid");
-    String pass = server.arg("pass");
+  server.on("/save", METHOD_POST, [](HttpRequest &req) {
+    String ssid = req.arg("ssid");
+    String pass = req.arg("pass");
     writeEEPROM(SSID_ADDR, ssid, SSID_MAX);
     writeEEPROM(PASS_ADDR, pass, PASS_MAX);
+    clearNetCache(); // new network: no stale BSSID/lease
+    trackEnd();
+    track.flush();
     
     // Página de sucesso simples
     String html = F("<!DOCTYPE html><html><head><style>body{background:#0f172a;color:#fff;font-family:sans-serif;display:flex;justify-content:center;align-items:center;height:100vh;text-align:center}h2{color:#00f3ff}</style></head><body><div><h2>Salvo!</h2><p>Reiniciando...</p></div></body></html>");
-    server.send(200, "text/html", html);
-    
-    delay(1500);
-    ESP.restart();
+    req.send(200, "text/html", html.c_str(), html.length());
+
+    // Restart from loop() once the page is out
+    restartAt = millis() + 1500;
   });
 
   // Mantém controle de LED no modo AP se precisar
-  server.on("/led", []() {
+  server.on("/led", [](HttpRequest &req) {
     ledState = !ledState;
     digitalWrite(LED_BOARD, ledState ? LOW : HIGH);
-    server.send(200, "text/html", ledState ? "<h1>ON</h1>" : "<h1>OFF</h1>");
+    frames.request(); // LED star on the OLED
+    tel.setLed(ledState);
+    req.send(200, "text/html", ledState ? "<h1>ON</h1>" : "<h1>OFF</h1>");
   });
 
   server.begin();
 }
 
-// UI Bitmaps
-
-static const unsigned char PROGMEM image_Pin_star_bits[] = {
-    0x92, 0x54, 0x38, 0xfe, 0x38, 0x54, 0x92};
-static const unsigned char PROGMEM image_weather_humidity_bits[] = {
-    0x04, 0x00, 0x04, 0x00, 0x0c, 0x00, 0x0e, 0x00, 0x1e, 0x00, 0x1f,
-    0x00, 0x3f, 0x80, 0x3f, 0x80, 0x7e, 0xc0, 0x7f, 0x40, 0xff, 0x60,
-    0xff, 0xe0, 0x7f, 0xc0, 0x7f, 0xc0, 0x3f, 0x80, 0x0f, 0x00};
-static const unsigned char PROGMEM image_weather_temperature_bits[] = {
-    0x1c, 0x00, 0x22, 0x02, 0x2b, 0x05, 0x2a, 0x02, 0x2b, 0x38, 0x2a,
-    0x60, 0x2b, 0x40, 0x2a, 0x40, 0x2a, 0x60, 0x49, 0x38, 0x9c, 0x80,
-    0xae, 0x80, 0xbe, 0x80, 0x9c, 0x80, 0x41, 0x00, 0x3e, 0x00};
-static const unsigned char PROGMEM image_passport_left_bits[] = {
-    0x3c, 0x40, 0x98, 0xa4, 0xa4, 0x98, 0x80, 0x80, 0xa0, 0x90, 0x88, 0xa4,
-    0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4,
-    0x90, 0x88, 0x84, 0x80, 0x40, 0x60, 0x70, 0x78, 0x7c, 0x5c, 0x4c, 0x4c,
-    0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c};
-static const unsigned char PROGMEM image_passport_left__copy__bits[] = {
-    0xf0, 0x08, 0x64, 0x94, 0x94, 0x64, 0x04, 0x04, 0x14, 0x24, 0x44, 0x94,
-    0x24, 0x44, 0x94, 0x24, 0x44, 0x94, 0x24, 0x44, 0x94, 0x24, 0x44, 0x94,
-    0x24, 0x44, 0x84, 0x04, 0x08, 0x18, 0x38, 0x78, 0xf8, 0xe8, 0xc8, 0xc8,
-    0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8};
-static const unsigned char PROGMEM image_clock_alarm_bits[] = {
-    0x79, 0x3c, 0xb3, 0x9a, 0xed, 0x6e, 0xd0, 0x16, 0xa0, 0x0a, 0x41,
-    0x04, 0x41, 0x04, 0x81, 0x02, 0xc1, 0x06, 0x82, 0x02, 0x44, 0x04,
-    0x48, 0x04, 0x20, 0x08, 0x10, 0x10, 0x2d, 0x68, 0x43, 0x84};
-static const unsigned char PROGMEM image_calendar_bits[] = {
-    0x09, 0x20, 0x76, 0xdc, 0xff, 0xfe, 0xff, 0xfe, 0x80, 0x02, 0x86,
-    0xda, 0x86, 0xda, 0x80, 0x02, 0xb6, 0xda, 0xb6, 0xda, 0x80, 0x02,
-    0xb6, 0xc2, 0xb6, 0xc2, 0x80, 0x02, 0x7f, 0xfc, 0x00, 0x00};
-static const unsigned char PROGMEM image_earth_bits[] = {
-    0x07, 0xc0, 0x1e, 0x70, 0x27, 0xf8, 0x61, 0xe4, 0x43, 0xe4, 0x87,
-    0xca, 0x9f, 0xf6, 0xdf, 0x82, 0xdf, 0x82, 0xe3, 0xc2, 0x61, 0xf4,
-    0x70, 0xf4, 0x31, 0xf8, 0x1b, 0xf0, 0x07, 0xc0, 0x00, 0x00};
-static const unsigned char PROGMEM image_passport_left__copy___copy__bits[] = {
-    0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c,
-    0x5c, 0x7c, 0x78, 0x70, 0x60, 0x40, 0x80, 0x84, 0x88, 0x90, 0xa4, 0x88,
-    0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88,
-    0x90, 0xa0, 0x80, 0x80, 0x98, 0xa4, 0xa4, 0x98, 0x40, 0x3c};
-static const unsigned char PROGMEM image_weather_sun_bits[] = {
-    0x01, 0x00, 0x21, 0x08, 0x10, 0x10, 0x03, 0x80, 0x8c, 0x62, 0x48,
-    0x24, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x48, 0x24, 0x8c, 0x62,
-    0x03, 0x80, 0x10, 0x10, 0x21, 0x08, 0x01, 0x00, 0x00, 0x00};
-static const unsigned char PROGMEM image_weather_cloud_rain_bits[] = {
-    0x00, 0x00, 0x00, 0x07, 0xc0, 0x00, 0x08, 0x20, 0x00, 0x10, 0x10, 0x00,
-    0x30, 0x08, 0x00, 0x40, 0x0e, 0x00, 0x80, 0x01, 0x00, 0x80, 0x00, 0x80,
-    0x40, 0x00, 0x80, 0x3f, 0xff, 0x00, 0x01, 0x10, 0x00, 0x22, 0x22, 0x00,
-    0x44, 0x84, 0x00, 0x91, 0x28, 0x00, 0x22, 0x40, 0x00, 0x00, 0x80, 0x00};
-static const unsigned char PROGMEM image_weather_cloud_lightning_bolt_bits[] = {
-    0x00, 0x00, 0x00, 0x07, 0xc0, 0x00, 0x08, 0x20, 0x00, 0x10, 0x10, 0x00,
-    0x30, 0x08, 0x00, 0x40, 0x0e, 0x00, 0x80, 0x81, 0x00, 0x81, 0x00, 0x80,
-    0x43, 0x00, 0x80, 0x26, 0x3f, 0x00, 0x0f, 0x80, 0x00, 0x01, 0x80, 0x00,
-    0x03, 0x00, 0x00, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00};
-static const unsigned char PROGMEM image_satellite_dish_bits[] = {
-    0x00, 0x00, 0x00, 0x78, 0x30, 0x04, 0x2c, 0x32, 0x63, 0x0a, 0xa8,
-    0xea, 0x92, 0xa2, 0x90, 0xe0, 0x89, 0x10, 0x8a, 0x48, 0x44, 0x08,
-    0x43, 0x24, 0x20, 0xc4, 0x30, 0x3c, 0x0c, 0x10, 0x03, 0xe0};
-static const unsigned char PROGMEM image_weather_cloud_sunny_bits[] = {
-    0x00, 0x20, 0x00, 0x02, 0x02, 0x00, 0x00, 0x70, 0x00, 0x01, 0x8c, 0x00,
-    0x09, 0x04, 0x80, 0x02, 0x02, 0x00, 0x02, 0x02, 0x00, 0x07, 0x82, 0x00,
-    0x08, 0x44, 0x80, 0x10, 0x2c, 0x00, 0x30, 0x30, 0x00, 0x60, 0x1e, 0x00,
-    0x80, 0x03, 0x00, 0x80, 0x01, 0x00, 0x80, 0x01, 0x00, 0x7f, 0xfe, 0x00};
-static const unsigned char PROGMEM image_weather_wind_bits[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x03, 0x88, 0x04, 0x44, 0x04,
-    0x44, 0x00, 0x44, 0x00, 0x88, 0xff, 0x32, 0x00, 0x00, 0xad, 0x82,
-    0x00, 0x60, 0x00, 0x10, 0x00, 0x10, 0x01, 0x20, 0x00, 0xc0};
-static const unsigned char PROGMEM image_Bluetooth_Idle_bits[] = {
-    0x20, 0xb0, 0x68, 0x30, 0x30, 0x68, 0xb0, 0x20};
-static const unsigned char PROGMEM image_BLE_beacon_bits[] = {
-    0x44, 0x92, 0xaa, 0x92, 0x54, 0x10, 0x10, 0x7c};
-static const unsigned char PROGMEM
-    image_passport_left__copy___copy___copy__bits[] = {
-        0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8,
-        0xe8, 0xf8, 0x78, 0x38, 0x18, 0x08, 0x04, 0x84, 0x44, 0x24, 0x94, 0x44,
-        0x24, 0x94, 0x44, 0x24, 0x94, 0x44, 0x24, 0x94, 0x44, 0x24, 0x94, 0x44,
-        0x24, 0x14, 0x04, 0x04, 0x64, 0x94, 0x94, 0x64, 0x08, 0xf0};
-static const unsigned char PROGMEM image_mouth_bits[] = {0x82, 0x82, 0x82, 0x44,
-                                                         0x38};
-static const unsigned char PROGMEM image_Battery_bits[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f,
-    0xf0, 0x10, 0x08, 0x32, 0xa8, 0x32, 0xa8, 0x10, 0x08, 0x0f, 0xf0,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-static const unsigned char PROGMEM image_device_sleep_mode_black_bits[] = {
-    0x04, 0x00, 0x1c, 0x0e, 0x38, 0x02, 0x78, 0x04, 0x71, 0xee, 0xf0,
-    0x40, 0xf0, 0x80, 0xf1, 0xe0, 0xf8, 0x00, 0xf8, 0x06, 0x7e, 0x1c,
-    0x7f, 0xfc, 0x3f, 0xf8, 0x1f, 0xf0, 0x07, 0xc0, 0x00, 0x00};
-
-bool flashState = false;
-bool eyeState = true;
-unsigned long lastBlink = 0;
-unsigned long blinkInterval = 3000;
-
-// Weather Globals
-int weatherCode = -1;
-int isDay = 1;        // Default to day
-int currentHour = 12; // Default to noon (safe fallback)
-unsigned long lastWeatherUpdate = 0;
-const unsigned long weatherInterval = 900000; // 15 minutes
-
-void updateWeather() {
-  if (WiFi.status() == WL_CONNECTED &&
-      gps.location.isValid()) { // Use GPS location
-    WiFiClient client;
-    HTTPClient http;
-
-    // Open-Meteo Forecast API (using GPS coords)
-    String url = "http://api.open-meteo.com/v1/forecast?latitude=" +
-                 String(gps.location.lat(), 4) +
-                 "&longitude=" + String(gps.location.lng(), 4) +
-                 "&current=is_day,weather_code&timezone=auto";
-
-    // Uncomment for debugging
-    // Serial.println("Weather URL: " + url);
-
-    if (http.begin(client, url)) {
-      int httpCode = http.GET();
-      if (httpCode > 0) {
-        if (httpCode == HTTP_CODE_OK) {
-          String payload = http.getString();
-          // Use ArduinoJson to parse
-          JsonDocument doc; // Dynamic size handling in v7
-          DeserializationError error = deserializeJson(doc, payload);
-
-          if (!error) {
-            isDay = doc["current"]["is_day"];
-            weatherCode = doc["current"]["weather_code"];
-            Serial.printf("Weather Update: Code=%d isDay=%d\n", weatherCode,
-                          isDay);
-          } else {
-            Serial.print("JSON Error: ");
-            Serial.println(error.c_str());
-          }
-        }
-      } else {
-        Serial.printf("HTTP Error: %s\n", http.errorToString(httpCode).c_str());
-      }
-      http.end();
+void wifiLoop(unsigned long now) {
+  wl_status_t st = WiFi.status();
+  switch (netState) {
+  case NET_CONNECTING:
+    if (st == WL_CONNECTED) {
+      onWiFiUp();
+    } else if (netFastPath && now - netStateStart > wifiFastTimeout) {
+      // AP moved or the lease is gone: fall back to a normal scan
+      LOG.println(F("WiFi: Cached BSSID failed, scanning..."));
+      WiFi.disconnect();
+      wifiBeginScan();
+      netStateStart = now;
+    } else if (now - netStateStart > wifiConnectTimeout) {
+      LOG.println(F("WiFi: Connection failed."));
+      startAP();
+    }
+    break;
+  case NET_UP:
+    if (st != WL_CONNECTED) {
+      // The SDK reconnects on its own; just track the link
+      netState = NET_DOWN;
+      netStateStart = now;
+      wifiConnected = false;
+      LOG.println(F("WiFi: Link lost, reconnecting..."));
+    }
+    break;
+  case NET_DOWN:
+    if (st == WL_CONNECTED) {
+      netState = NET_UP;
+      wifiConnected = true;
+      LOG.printf("WiFi: Reconnected after %lums\n", now - netStateStart);
     }
+    break;
+  case NET_AP:
+    break;
   }
 }
 
+// Weather Globals (the code and isDay shown are in UiLogic, the fetch
+// schedule in LoopLogic)
+WeatherFetch weather;
+WeatherCache wxCache;
+LoopLogic loopLogic(logic, frames, wxCache, gps); // per-pass decisions
+
 // Helper: Draw GPS signal bars at position
 void drawGPSBars(int x, int y) {
   for (int i = 0; i < 4; i++) {
     int barH = 2 + (i * 2);
     int barY = y + (8 - barH);
-    if (i < gpsBars) {
+    if (i < logic.gpsBars()) {
       display.fillRect(x + (i * 4), barY, 3, barH, 1);
     } else {
       display.drawRect(x + (i * 4), barY, 3, barH, 1);
@@ -532,449 +543,280 @@ void drawGPSBars(int x, int y) {
   }
 }
 
-// Helper: Draw animated face
-void drawFace() {
-  int eyeLX = 54, eyeRX = 76, eyeY = 6;
-
-  // Adjust eye position for LOOK animation
-  if (currentFace == FACE_LOOK) {
-    int offset = 0;
-    if (lookPhase == 1)
-      offset = -3; // look left
-    else if (lookPhase == 3)
-      offset = 3; // look right
-    eyeLX += offset;
-    eyeRX += offset;
-  }
-
-  switch (currentFace) {
-  case FACE_HAPPY:
-    // ^  ^ eyes (arc shapes)
-    display.drawLine(eyeLX - 3, eyeY + 1, eyeLX, eyeY - 2, 1);
-    display.drawLine(eyeLX, eyeY - 2, eyeLX + 3, eyeY + 1, 1);
-    display.drawLine(eyeRX - 3, eyeY + 1, eyeRX, eyeY - 2, 1);
-    display.drawLine(eyeRX, eyeY - 2, eyeRX + 3, eyeY + 1, 1);
-    // Big smile
-    display.drawLine(60, 12, 63, 15, 1);
-    display.drawLine(63, 15, 67, 15, 1);
-    display.drawLine(67, 15, 70, 12, 1);
-    break;
-
-  case FACE_SLEEPY:
-    // Half-closed eyes (lines lower)
-    display.drawLine(eyeLX - 3, eyeY + 2, eyeLX + 3, eyeY + 2, 1);
-    display.drawLine(eyeLX - 2, eyeY + 1, eyeLX + 2, eyeY + 1, 1);
-    display.drawLine(eyeRX - 3, eyeY + 2, eyeRX + 3, eyeY + 2, 1);
-    display.drawLine(eyeRX - 2, eyeY + 1, eyeRX + 2, eyeY + 1, 1);
-    // Small flat mouth
-    display.drawLine(62, 13, 68, 13, 1);
-    // "z z z" bubble
-    display.setFont(NULL);
-    display.setTextSize(1);
-    display.setCursor(80, 0);
-    display.print("z");
-    if (flashState) {
-      display.setCursor(85, 0);
-      display.print("z");
-    }
-    break;
-
-  case FACE_SURPRISED:
-    // Big round eyes
-    display.drawCircle(eyeLX, eyeY, 4, 1);
-    display.fillCircle(eyeLX, eyeY, 2, 1);
-    display.drawCircle(eyeRX, eyeY, 4, 1);
-    display.fillCircle(eyeRX, eyeY, 2, 1);
-    // Small "O" mouth
-    display.drawCircle(65, 13, 2, 1);
-    break;
-
-  case FACE_LOOK:
-  case FACE_NORMAL:
-  default:
-    // Normal eyes with blink
-    if (eyeState) {
-      display.fillCircle(eyeLX, eyeY, 3, 1);
-      display.fillCircle(eyeRX, eyeY, 3, 1);
-    } else {
-      display.drawLine(eyeLX - 3, eyeY, eyeLX + 3, eyeY, 1);
-      display.drawLine(eyeRX - 3, eyeY, eyeRX + 3, eyeY, 1);
-    }
-    // Normal mouth
-    display.drawBitmap(62, 10, image_mouth_bits, 7, 5, 1);
-    break;
-  }
+// The frame as loop() has it
+void uiSave(UiState &s) {
+  logic.save(s);
+  s.led = ledState;
 }
 
-void draw(void) {
-  display.clearDisplay();
-
-  // weather_humidity
-  display.drawBitmap(9, 45, image_weather_humidity_bits, 11, 16, 1);
-
-  // weather_temperature
-  display.drawBitmap(9, 24, image_weather_temperature_bits, 16, 16, 1);
-
-  // passport_borders
-  display.drawBitmap(0, 18, image_passport_left_bits, 6, 46, 1);
-  display.drawBitmap(122, 18, image_passport_left__copy__bits, 6, 46, 1);
-  display.drawBitmap(0, -29, image_passport_left__copy___copy__bits, 6, 46, 1);
-  display.drawBitmap(122, -29, image_passport_left__copy___copy___copy__bits, 6,
-                     46, 1);
-
-  // Separator line
-  display.drawLine(5, 18, 122, 18, 1);
-
-  // Clock / Calendar (alternates)
-  if (showDate) {
-    display.drawBitmap(65, 24, image_calendar_bits, 15, 16, 1);
-  } else {
-    display.drawBitmap(65, 24, image_clock_alarm_bits, 15, 16, 1);
-  }
-
-  if (hasGPSFix) {
-    display.drawBitmap(65, 45, image_earth_bits, 15, 16, 1);
-  } else {
-    if (flashState) {
-      display.drawBitmap(67, 44, image_satellite_dish_bits, 15, 16, 1);
-    }
-  }
-
-  // Bluetooth Icon (blinks when WiFi not connected)
-  // if (wifiConnected || iconBlinkState) {
-  //  display.drawBitmap(115, 0, image_Bluetooth_Idle_bits, 5, 8, 1);
-  //}
-  // Pin_star (LED indicator - only visible when LED is on)
-  if (ledState) {
-    display.drawBitmap(104, 0, image_Pin_star_bits, 7, 7, 1);
-  }
-  // BLE Beacon (blinks when WiFi not connected)
-  if (wifiConnected || iconBlinkState) {
-    display.drawBitmap(113, 0, image_BLE_beacon_bits, 7, 8, 1);
-  }
+// Renders the UI into the display buffer (no I2C)
+void render() {
+  UiState s;
+  uiSave(s);
+  ui.render(s);
+}
 
-  // Battery (blink speed depends on level)
-  if (battBlinkState) {
-    display.drawBitmap(106, 5, image_Battery_bits, 16, 16, 1);
-  }
+// Puts the live frame back into the display buffer after a snapshot, and
+// has the whole of it resent on the next flush
+static void restoreLive() {
+  UiState s;
+  uiSave(s);
+  UiRenderStats unused;
+  ui.snapshot(s, unused); // not a frame of its own: stats stay as they were
+  oled.invalidate();
+  frames.request();
+}
 
-  // Dynamic Weather Icon
-  // Dynamic Weather Icon & Night Mode
-  if (isDay == 0) {
-    // Night Mode (Sleep Icon)
-    display.drawBitmap(8, 0, image_device_sleep_mode_black_bits, 16, 16, 1);
-  } else {
-    // Day Mode - Weather Condition
-    if (weatherCode >= 95) { // Thunderstorm
-      display.drawBitmap(8, 0, image_weather_cloud_lightning_bolt_bits, 17, 16,
-                         1);
-    } else if (weatherCode >= 51) { // Rain / Drizzle
-      display.drawBitmap(8, 0, image_weather_cloud_rain_bits, 17, 16, 1);
-    } else if (weatherCode >= 1 && weatherCode <= 3) { // Cloud/Partly Cloudy
-      display.drawBitmap(8, 0, image_weather_cloud_sunny_bits, 17, 16, 1);
-    } else if (weatherCode == 0) { // Clear Sky
-      display.drawBitmap(8, 0, image_weather_sun_bits, 15, 16, 1);
-    } else {
-      // Default or unknown (e.g. Fog 45/48) -> Sunny Cloud as fallback
-      display.drawBitmap(8, 0, image_weather_cloud_sunny_bits, 17, 16, 1);
-    }
+// /frame.pbm body from the UiState kept in the slot: the header, then as
+// many whole pages as fit per piece (cursor = next page). The display
+// buffer holds the live frame again between pieces, so each one renders
+// the snapshot anew.
+static size_t frameFill(char *buf, size_t room, void *state,
+                        uint32_t &cursor) {
+  if (cursor >= UI_HEIGHT / 8)
+    return 0;
+  size_t n = 0;
+  if (cursor == 0) {
+    n = sizeof(UI_PBM_HEADER) - 1;
+    memcpy(buf, UI_PBM_HEADER, n);
   }
-
-  // Animated Face
-  drawFace();
-
-  // Text Values
-  display.setFont(&Org_01);
-  display.setTextColor(1);
-  display.setTextSize(2);
-  display.setTextWrap(false);
-
-  // Humidity Value
-  display.setCursor(27, 56);
-  display.print(ui_hum + "%");
-
-  // Temperature Value
-  display.setCursor(27, 35);
-  display.print(ui_temp);
-
-  // Date / Time display (alternates every 3s)
-  if (showDate) {
-    // Date: day (big), month (small top), year (small bottom)
-    display.setTextSize(2);
-    display.setCursor(86, 35);
-    display.print(ui_date.substring(0, 2));
-
-    display.setTextSize(1);
-    display.setCursor(109, 30);
-    display.print(ui_date.substring(3, 5));
-
-    display.setCursor(109, 37);
-    display.print(ui_date.substring(6, 8));
-  } else {
-    // Time: hours (big), minutes (small top), seconds (small bottom)
-    display.setTextSize(2);
-    display.setCursor(86, 35);
-    display.print(ui_time.substring(0, 2));
-
-    display.setTextSize(1);
-    display.setCursor(109, 30);
-    display.print(ui_time.substring(3, 5));
-
-    display.setCursor(109, 37);
-    display.print(ui_time.substring(6, 8));
+  UiRenderStats rs;
+  ui.snapshot(*(const UiState *)state, rs);
+  for (; cursor < UI_HEIGHT / 8 && n + UI_PBM_PAGE <= room; cursor++) {
+    ui.pbmPage(cursor, (uint8_t *)buf + n);
+    n += UI_PBM_PAGE;
   }
+  restoreLive();
+  return n;
+}
 
-  display.setTextSize(1);
-
-  // Latitude
-  display.setCursor(84, 49);
-  display.print(ui_lat);
-
-  // Longitude
-  display.setCursor(84, 59);
-  display.print(ui_lon);
+// /frame.pbm[?fixed=1&face=&weather=&day=&date=]: the UI as a 128x64 PBM
+// (1 = lit pixel), rendered off-screen. fixed=1 swaps in
+// UiRenderer::fixture(), the other parameters override single states.
+// Timing and GFX op counts come back as headers; tools/ui_capture.py walks
+// every state. None of it shows in ui.stats() or on the panel.
+void handleFrame(HttpRequest &req) {
+  UiState s;
+  uiSave(s);
+  if (req.arg("fixed") == "1")
+    UiRenderer::fixture(s);
+  if (req.hasArg("face"))
+    s.face = (FaceState)constrain(req.arg("face").toInt(), 0, FACE_COUNT - 1);
+  if (req.hasArg("weather"))
+    s.weatherCode = req.arg("weather").toInt();
+  if (req.hasArg("day"))
+    s.isDay = req.arg("day").toInt();
+  if (req.hasArg("date"))
+    s.showDate = req.arg("date").toInt();
+
+  // Rendered here for the timing headers; the body renders it again
+  UiRenderStats rs;
+  ui.snapshot(s, rs);
+  restoreLive();
+  char v[40];
+  snprintf(v, sizeof(v), "%lu", (unsigned long)rs.micros);
+  req.sendHeader(F("X-Render-Micros"), v);
+  snprintf(v, sizeof(v), "%lu", (unsigned long)rs.textMicros);
+  req.sendHeader(F("X-Text-Micros"), v);
+  snprintf(v, sizeof(v), "%lu/%lu/%lu", (unsigned long)rs.ops.pixels,
+           (unsigned long)rs.ops.hlines, (unsigned long)rs.ops.vlines);
+  req.sendHeader(F("X-Pixel-Ops"), v);
+  req.sendHeader(F("Cache-Control"), F("no-store"));
+  req.sendGenerated(200, "image/x-portable-bitmap", frameFill, &s, sizeof(s),
+                    UI_PBM_SIZE);
+}
 
-  display.display();
+void draw(void) {
+  uint32_t c0 = ESP.getCycleCount();
+  render();
+  uint32_t c1 = ESP.getCycleCount();
+  oled.flush(); // only the changed pages/columns go over I2C
+  metrics.add(LS_DRAW, c1 - c0);
+  metrics.add(LS_FLUSH, ESP.getCycleCount() - c1);
+  if (!boot.firstFrame)
+    bootMark(boot.firstFrame, "first frame");
 }
 
 void setup() {
-  Serial.begin(115200);
-  gpsSerial.begin(9600);
-  Wire.begin(OLED_SDA, OLED_SCL);
+  logBegin();
+  tel.begin();
+  bootTag = random(0x7FFFFFFF);
+  gpsIn.begin();
+#if GPS_CONFIG
+  gpsCfg.begin(millis()); // rate/baud/sentences, finished from loop()
+#endif
   dht.begin();
+  Wire.begin(OLED_SDA, OLED_SCL);
 
   if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    Serial.println(F("SSD1306 allocation failed"));
+    LOG.println(F("SSD1306 allocation failed"));
     for (;;)
       ;
   }
 
   display.clearDisplay();
-  display.display();
-  noFixSince = millis();
+  oled.flush(); // first flush sends the full frame
+
+  logic.begin(millis());
 
   setupWiFi();
 
+  // Last known weather drives the icon until GPS/WiFi catch up
+  wxCache.begin(WX_CACHE_ADDR);
+  loopLogic.begin();
+
+#if TRACK_LOG
+  track.begin();
+#endif
+
   // Init LEDs
   pinMode(LED_BOARD, OUTPUT);
   digitalWrite(LED_BOARD, HIGH); // OFF (active LOW)
 
-  Serial.println(F("System Initialized."));
+  heap.begin();
+  LOG.println(F("System Initialized."));
+  heap.print(LOG);
 }
 
-unsigned long lastUpdate = 0;
-unsigned long lastFlash = 0;
-unsigned long lastLookStep = 0;
-unsigned long lookTriggerTime = 0;
-bool lookActive = false;
-
 void loop() {
+  // Pass to pass, so time spent in the SDK between passes counts too (the
+  // power governor's sleep does not: the clock restarts after it)
+  static uint32_t lastPass = 0;
+  uint32_t c0 = ESP.getCycleCount();
+  if (lastPass)
+    metrics.add(LS_LOOP, c0 - lastPass);
+  lastPass = c0;
+
+  // Advance WiFi bring-up / link tracking (never blocks)
+  wifiLoop(millis());
+
   // Handle web server (both AP and STA modes)
-  server.handleClient();
+  c0 = ESP.getCycleCount();
+  server.loop(millis());
   if (wifiConnected)
     MDNS.update();
+  metrics.add(LS_HTTP, ESP.getCycleCount() - c0);
+  if (restartAt && (long)(millis() - restartAt) >= 0)
+    ESP.restart();
+
+  // Push telemetry changes to /events subscribers
+  events.publish(tel.takeChanges());
+  events.loop(millis());
+  trackExport.loop(millis());
 
   // GPS Processing
-  while (gpsSerial.available() > 0) {
-    gps.encode(gpsSerial.read());
-  }
+  c0 = ESP.getCycleCount();
+  gpsIn.poll(gps);
+  metrics.add(LS_GPS, ESP.getCycleCount() - c0);
+  gpsCfg.loop(millis());
+  track.loop(millis());
+  if (!boot.firstGpsSentence && gps.passedChecksum() > 0)
+    bootMark(boot.firstGpsSentence, "first GPS sentence");
 
   unsigned long now = millis();
 
-  // Battery blink timing (full=no blink, medium=1s, low=250ms)
-  unsigned long battInterval = 0;
-  if (batteryLevel == 0)
-    battInterval = 250; // fast blink: low
-  else if (batteryLevel <= 2)
-    battInterval = 1000; // slow blink: medium/charging
-  // level 3 = full, no blink (always on)
-
-  if (battInterval > 0 && now - lastBattBlink > battInterval) {
-    lastBattBlink = now;
-    battBlinkState = !battBlinkState;
-  } else if (battInterval == 0) {
-    battBlinkState = true; // always on when full
-  }
-
-  // WiFi icon blink (500ms when not connected)
-  if (!wifiConnected && now - lastIconBlink > 500) {
-    lastIconBlink = now;
-    iconBlinkState = !iconBlinkState;
-  } else if (wifiConnected) {
-    iconBlinkState = true; // always on when connected
-  }
-
-  // Blinking Logic (face)
-  if (currentFace == FACE_NORMAL || currentFace == FACE_LOOK) {
-    if (now - lastBlink > (eyeState ? blinkInterval : 150)) {
-      lastBlink = now;
-      eyeState = !eyeState;
-      if (eyeState)
-        blinkInterval = random(2000, 6000);
-      draw();
-    }
-  }
-
-  // Look Around Animation Steps
-  if (currentFace == FACE_LOOK && now - lastLookStep > 400) {
-    lastLookStep = now;
-    lookPhase++;
-    if (lookPhase > 4) {
-      lookPhase = 0;
-      currentFace = FACE_NORMAL;
-    }
-    draw();
-  }
-
-  // Flashing logic (500ms - satellite dish, sleepy z's)
-  if (now - lastFlash > 500) {
-    lastFlash = now;
-    flashState = !flashState;
-    draw();
+  // DHT11: read in the background, applied when a frame has been decoded
+  c0 = ESP.getCycleCount();
+  if (dht.loop(now) && dht.ok())
+    logic.dhtSample(dht.tempTenths(), dht.humTenths(), now);
+  metrics.add(LS_SENSORS, ESP.getCycleCount() - c0);
+
+  // Blinks and animations; battery, GPS and face once a second; weather
+  // schedule; frame due (see LoopLogic, which test_replay runs too)
+  bool hadFix = logic.fix();
+  uint8_t pass = loopLogic.pass(now, wifiConnected, weather.busy());
+  if (pass & PASS_UPDATE) {
+    uint16_t vcc = loopLogic.vcc();
+    if (logic.fix())
+      trackFix({loopLogic.epoch(), (int32_t)lround(gps.location.lat() * 1e6),
+                (int32_t)lround(gps.location.lng() * 1e6)});
+    else if (hadFix)
+      trackEnd();
+
+#if POWER_GOVERNOR
+    // Radio, frame rate, contrast and sleep gaps follow the battery
+    const GpsLinkStats &link = gpsIn.stats();
+    power.update(now, vcc,
+                 logic.face() == FACE_NORMAL || logic.face() == FACE_SLEEPY,
+                 wifiConnected && !apMode,
+                 link.overruns + link.rxErrors + gps.failedChecksum());
+#endif
+
+    const OledFlushStats &fs = oled.stats();
+    LOG.printf("Face:%d Bat:%d(%dmV) WiFi:%s Sat:%d T:%s WCode:%d Day:%d "
+               "OLED:%uB saved:%uB (%luus) Draw:%luus max:%luus "
+               "Text:%luus max:%luus Ops:%lu/%lu/%lu Frames:%lu/%lu\n",
+               logic.face(), logic.batteryLevel(), vcc,
+               wifiConnected ? "OK" : (apMode ? "AP" : "X"),
+               (int)gps.satellites.value(), tel.time, logic.weatherCode(),
+               logic.isDay(), fs.lastSent, fs.lastSaved,
+               (unsigned long)fs.lastMicros,
+               (unsigned long)ui.stats().micros,
+               (unsigned long)ui.stats().maxMicros,
+               (unsigned long)ui.stats().textMicros,
+               (unsigned long)ui.stats().maxTextMicros,
+               (unsigned long)ui.stats().ops.pixels,
+               (unsigned long)ui.stats().ops.hlines,
+               (unsigned long)ui.stats().ops.vlines,
+               (unsigned long)frames.produced(),
+               (unsigned long)frames.requested());
   }
 
-  // Date/Time toggle (every 5s)
-  if (now - lastDateToggle > 5000) {
-    lastDateToggle = now;
-    showDate = !showDate;
-    draw();
+  // Heap / fragmentation report
+  if (now - lastHeapReport > heapReportInterval) {
+    lastHeapReport = now;
+    heap.sample();
+    heap.print(LOG);
+    server.print(LOG);
+    LOG.printf("HTTP /data: 200=%lu 304=%lu\n", (unsigned long)dataServed,
+               (unsigned long)dataNotModified);
+    const SseStats &ss = events.stats();
+    LOG.printf("SSE: clients=%u events=%lu bytes=%lu dropped=%lu "
+               "rejected=%lu\n",
+               events.clients(), (unsigned long)ss.events,
+               (unsigned long)ss.bytes, (unsigned long)ss.dropped,
+               (unsigned long)ss.rejected);
+    gpsIn.print(LOG, gps);
+    gpsCfg.print(LOG);
+    track.print(LOG);
+    trackFilter.print(LOG);
+    dht.print(LOG);
+    logic.temp().print(LOG, "temp");
+    logic.hum().print(LOG, "hum");
+    power.print(LOG);
   }
 
-  // Value Updates (every 1 second)
-  if (now - lastUpdate > 1000) {
-    lastUpdate = now;
-
-    // Check WiFi status
-    if (!apMode) {
-      wifiConnected = (WiFi.status() == WL_CONNECTED);
-    }
-
-    // Read Sensors
-    float h = dht.readHumidity();
-    float t = dht.readTemperature();
-
-    if (!isnan(h))
-      ui_hum = String((int)h);
-    if (!isnan(t)) {
-      if (lastTemp != 0 && abs(t - lastTemp) > 3.0 &&
-          (now - lastTempChange < 10000)) {
-        currentFace = FACE_SURPRISED;
-        faceStateStart = now;
-      }
-      lastTemp = t;
-      lastTempChange = now;
-      ui_temp = String((int)t);
-    }
-
-    // Battery level from VCC
-    uint16_t vcc = ESP.getVcc();
-    if (vcc > 3200)
-      batteryLevel = 3;
-    else if (vcc > 3000)
-      batteryLevel = 2;
-    else if (vcc > 2800)
-      batteryLevel = 1;
-    else
-      batteryLevel = 0;
-
-    // GPS Time (UTC-3 Brasília)
-    if (gps.time.isValid() && gps.time.age() < 2000) {
-      currentHour = (gps.time.hour() - 3 + 24) % 24; // UTC-3
-      char timeStr[12];
-      snprintf(timeStr, sizeof(timeStr), "%02d:%02d:%02d", currentHour,
-               gps.time.minute(), gps.time.second());
-      ui_time = String(timeStr);
-    } else {
-      ui_time = "00:00:00";
-    }
-
-    // Determine isDay based on Time if API hasn't set it (or as a fallback)
-    if (weatherCode == -1) {
-      if (currentHour >= 6 && currentHour < 18) {
-        isDay = 1; // Day
-      } else {
-        isDay = 0; // Night
-      }
-    }
-
-    // GPS Date
-    if (gps.date.isValid() && gps.date.age() < 2000) {
-      char dateStr[12];
-      snprintf(dateStr, sizeof(dateStr), "%02d/%02d/%02d", gps.date.day(),
-               gps.date.month(), gps.date.year() % 100);
-      ui_date = String(dateStr);
-    } else {
-      ui_date = "00/00/00";
-    }
-
-    // GPS Location
-    bool hadFix = hasGPSFix;
-    hasGPSFix = gps.location.isValid() && gps.location.age() < 5000;
-
-    if (hasGPSFix) {
-      ui_lat = String(gps.location.lat(), 2);
-      ui_lon = String(gps.location.lng(), 2);
-      if (!hadFix) {
-        currentFace = FACE_HAPPY;
-        faceStateStart = now;
-      }
-      noFixSince = now;
-    } else {
-      ui_lat = "-0.00";
-      ui_lon = "-0.00";
-      if (now - noFixSince > 30000 && currentFace == FACE_NORMAL) {
-        currentFace = FACE_SLEEPY;
-        faceStateStart = now;
-      }
-    }
-
-    // GPS signal bars
-    int sats = gps.satellites.value();
-    if (sats >= 7)
-      gpsBars = 4;
-    else if (sats >= 5)
-      gpsBars = 3;
-    else if (sats >= 3)
-      gpsBars = 2;
-    else if (sats >= 1)
-      gpsBars = 1;
-    else
-      gpsBars = 0;
-
-    // Face state timeouts
-    if (currentFace == FACE_HAPPY && now - faceStateStart > 5000)
-      currentFace = FACE_NORMAL;
-    if (currentFace == FACE_SURPRISED && now - faceStateStart > 3000)
-      currentFace = FACE_NORMAL;
-    if (currentFace == FACE_SLEEPY && hasGPSFix) {
-      currentFace = FACE_HAPPY;
-      faceStateStart = now;
-    }
-
-    // Random Look Around
-    if (currentFace == FACE_NORMAL && !lookActive && random(0, 15) == 0) {
-      currentFace = FACE_LOOK;
-      lookPhase = 0;
-      lastLookStep = now;
-      lookActive = true;
-    }
-    if (currentFace != FACE_LOOK)
-      lookActive = false;
-
-    Serial.printf("Face:%d Bat:%d(%dmV) WiFi:%s Sat:%d T:%s WCode:%d Day:%d\n",
-                  currentFace, batteryLevel, vcc,
-                  wifiConnected ? "OK" : (apMode ? "AP" : "X"), sats,
-                  ui_time.c_str(), weatherCode, isDay);
-
+#if !GPS_HW_UART
+  // 'm' on the serial console dumps the loop latency table
+  if (Serial.available() && Serial.read() == 'm')
+    metrics.print(LOG);
+#endif
+
+  // Weather: the request LoopLogic asked for, advanced one step (never
+  // blocks on DNS/HTTP)
+  c0 = ESP.getCycleCount();
+  if (pass & PASS_FETCH)
+    weather.start(gps.location.lat(), gps.location.lng());
+  if (weather.loop(now))
+    loopLogic.weatherResult(weather.weatherCode(), weather.isDay());
+  metrics.add(LS_WEATHER, ESP.getCycleCount() - c0);
+
+  // Render at most one frame per pass, whatever asked for it
+  if (pass & PASS_FRAME) {
     draw();
   }
 
-  // Periodic Weather Update
-  if (now - lastWeatherUpdate > weatherInterval || lastWeatherUpdate == 0) {
-    if (wifiConnected && hasGPSFix &&
-        noFixSince > 0) { // Only update if connected and we have/had a fix
-      updateWeather();
-      lastWeatherUpdate = now;
+#if POWER_GOVERNOR
+  // LOW power: light-sleep until just before the next GPS burst
+  if (!frames.pending() && !trackExport.busy()) {
+    uint8_t hz = gpsCfg.rateHz() ? gpsCfg.rateHz() : 1;
+    uint16_t ms = power.gap(millis(), gpsIn.burstStart(), gpsIn.lastByteAt(),
+                            1000 / hz);
+    if (ms) {
+      delay(ms);
+      power.slept(ms);
+      lastPass = ESP.getCycleCount();
     }
   }
+#endif
 }
@@ -0,0 +1,86 @@
+#include "oled_flush.h"
+
+// Same bus speeds Adafruit_SSD1306 uses around its own transfers
+#define OLED_CLK_DURING 400000UL
+#define OLED_CLK_AFTER 100000UL
+
+#ifdef BUFFER_LENGTH
+#define OLED_WIRE_MAX BUFFER_LENGTH
+#else
+#define OLED_WIRE_MAX 32
+#endif
+
+OledFlush::OledFlush(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address)
+    : _display(display), _wire(wire), _address(address), _valid(false) {
+  memset(_shadow, 0, sizeof(_shadow));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void OledFlush::invalidate() { _valid = false; }
+
+void OledFlush::sendCommands(const uint8_t *cmds, uint8_t n) {
+  _wire.beginTransmission(_address);
+  _wire.write((uint8_t)0x00); // Co = 0, D/C = 0: command stream
+  _wire.write(cmds, n);
+  _wire.endTransmission();
+}
+
+void OledFlush::sendData(const uint8_t *data, uint16_t n) {
+  while (n > 0) {
+    uint16_t chunk = n < OLED_WIRE_MAX - 1 ? n : OLED_WIRE_MAX - 1;
+    _wire.beginTransmission(_address);
+    _wire.write((uint8_t)0x40); // Co = 0, D/C = 1: data stream
+    _wire.write(data, chunk);
+    _wire.endTransmission();
+    data += chunk;
+    n -= chunk;
+  }
+}
+
+uint16_t OledFlush::flush() {
+  const uint8_t *frame = _display.getBuffer();
+  unsigned long start = micros();
+  uint16_t sent = 0;
+
+  _wire.setClock(OLED_CLK_DURING);
+
+  for (uint8_t page = 0; page < OLED_PAGES; page++) {
+    const uint8_t *src = frame + page * OLED_COLS;
+    uint8_t *dst = _shadow + page * OLED_COLS;
+
+    int first = 0;
+    int last = OLED_COLS - 1;
+    if (_valid) {
+      while (first < OLED_COLS && src[first] == dst[first])
+        first++;
+      if (first == OLED_COLS)
+        continue; // page unchanged
+      while (src[last] == dst[last])
+        last--;
+    }
+
+    // Horizontal addressing mode (set by display.begin()): the window below
+    // makes the controller wrap within [first, last] on this page only.
+    const uint8_t window[] = {SSD1306_PAGEADDR, page, page, SSD1306_COLUMNADDR,
+                              (uint8_t)first, (uint8_t)last};
+    sendCommands(window, sizeof(window));
+
+    uint16_t len = last - first + 1;
+    sendData(src + first, len);
+    memcpy(dst + first, src + first, len);
+    sent += len;
+  }
+
+  _wire.setClock(OLED_CLK_AFTER);
+  _valid = true;
+
+  _stats.frames++;
+  if (sent == 0)
+    _stats.skipped++;
+  _stats.lastSent = sent;
+  _stats.lastSaved = OLED_FRAME_BYTES - sent;
+  _stats.bytesSent += sent;
+  _stats.bytesSaved += OLED_FRAME_BYTES - sent;
+  _stats.lastMicros = micros() - start;
+  return sent;
+}
@@ -0,0 +1,163 @@
+#include "power_governor.h"
+#include "gps_input.h"
+
+// Frame rate cap per state, {active, idle}; 0 = the configured maximum.
+// At 2 fps a 150 ms blink can fall between frames, which is fine in LOW.
+static const uint8_t POWER_FPS[POWER_STATES][2] = {{5, 2}, {10, 4}, {0, 10}};
+
+PowerGovernor::PowerGovernor(FrameScheduler &frames, Adafruit_SSD1306 &display,
+                             uint8_t maxFps)
+    : _frames(frames), _display(display), _maxFps(maxFps), _state(POWER_FULL),
+      _idle(false), _sta(false), _dimmed(false), _wifiApplied(-1), _busyAt(0),
+      _lastUpdate(0), _backoffUntil(0), _gpsLoss(0), _windowGapMs(0),
+      _carryMs(0), _ma(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+const char *PowerGovernor::name(uint8_t state) {
+  static const char *const names[] = {"low", "eco", "full"};
+  return state < POWER_STATES ? names[state] : "?";
+}
+
+void PowerGovernor::update(unsigned long now, uint16_t vccMv, bool idle,
+                           bool staConnected, uint32_t gpsLoss) {
+  // Account the second that just ended to the state it was spent in
+  unsigned long dt = _lastUpdate ? now - _lastUpdate : 0;
+  _lastUpdate = now;
+  _stats.mAms += (uint64_t)_ma * dt;
+  _carryMs += dt;
+  _stats.secondsIn[_state] += _carryMs / 1000;
+  _carryMs %= 1000;
+
+  // GPS data lost while sleeping between bursts: stop for a while
+  if (gpsLoss != _gpsLoss && _windowGapMs) {
+    _backoffUntil = now + POWER_GAP_BACKOFF_MS;
+    _stats.backoffs++;
+  }
+  _gpsLoss = gpsLoss;
+
+  if (!idle)
+    _busyAt = now;
+  _idle = now - _busyAt >= POWER_IDLE_MS;
+
+  PowerState target = vccMv > POWER_FULL_MV  ? POWER_FULL
+                      : vccMv > POWER_ECO_MV ? POWER_ECO
+                                             : POWER_LOW;
+  if (target > _state) {
+    PowerState up = vccMv > POWER_FULL_MV + POWER_HYSTERESIS_MV ? POWER_FULL
+                    : vccMv > POWER_ECO_MV + POWER_HYSTERESIS_MV
+                        ? POWER_ECO
+                        : POWER_LOW;
+    target = up > _state ? up : _state;
+  }
+  if (target != _state) {
+    _state = target;
+    _stats.changes++;
+  }
+  _sta = staConnected;
+  apply();
+
+  // Estimate for the coming second; the CPU share comes from the last one
+  uint32_t sleptPermille =
+      dt ? min(1000UL, (unsigned long)(_windowGapMs * 1000UL / dt)) : 0;
+  _windowGapMs = 0;
+  uint16_t cpu = (POWER_MA_CPU * (1000 - sleptPermille) +
+                  POWER_MA_CPU_SLEEP * sleptPermille) /
+                 1000;
+  uint16_t wifi = !_sta                 ? POWER_MA_WIFI_AWAKE
+                  : _state == POWER_FULL ? POWER_MA_WIFI_DTIM1
+                                         : POWER_MA_WIFI_DTIM3;
+  uint16_t oled = _dimmed ? POWER_MA_OLED_DIM : POWER_MA_OLED;
+  _ma = POWER_MA_GPS + cpu + wifi + oled;
+}
+
+void PowerGovernor::apply() {
+  uint8_t fps = POWER_FPS[_state][_idle];
+  _frames.setMaxFps(fps && fps < _maxFps ? fps : _maxFps);
+
+  bool dim = _state == POWER_LOW || (_state == POWER_ECO && _idle);
+  if (dim != _dimmed) {
+    _display.dim(dim);
+    _dimmed = dim;
+  }
+
+  // Sleep modes only apply to a station link; reapply after a reconnect
+  int8_t wifi = _sta ? _state : -1;
+  if (wifi != _wifiApplied) {
+    _wifiApplied = wifi;
+    if (_state == POWER_FULL)
+      WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+    else if (_sta)
+      WiFi.setSleepMode(_state == POWER_LOW ? WIFI_LIGHT_SLEEP
+                                            : WIFI_MODEM_SLEEP,
+                        POWER_LISTEN_INTERVAL);
+  }
+}
+
+uint16_t PowerGovernor::gap(unsigned long now, unsigned long burstStart,
+                            unsigned long lastByte, uint16_t periodMs) const {
+  if (_state != POWER_LOW || !_sta || !periodMs)
+    return 0;
+  if (_backoffUntil && (long)(now - _backoffUntil) < 0)
+    return 0;
+  if (now - lastByte <= GPS_BURST_GAP_MS)
+    return 0; // a burst is still arriving
+
+  // Next burst is due a whole number of periods after the last one started
+  long left = (long)periodMs - (long)((now - burstStart) % periodMs) -
+              POWER_WAKE_MARGIN_MS;
+  if (left <= 0)
+    return 0;
+  return left < POWER_GAP_MAX_MS ? left : POWER_GAP_MAX_MS;
+}
+
+void PowerGovernor::slept(uint16_t ms) {
+  _stats.gaps++;
+  _stats.gapMs += ms;
+  _windowGapMs += ms;
+}
+
+void PowerGovernor::print(Print &out) const {
+  unsigned long uAh = _stats.mAms / 3600UL;
+  out.printf("Power: %s%s ~%u mA, %lu.%03lu mAh | full %lus eco %lus low "
+             "%lus, %lu changes | gaps %lu (%lus), %lu backoffs\n",
+             name(_state), _idle ? " idle" : "", _ma, uAh / 1000, uAh % 1000,
+             (unsigned long)_stats.secondsIn[POWER_FULL],
+             (unsigned long)_stats.secondsIn[POWER_ECO],
+             (unsigned long)_stats.secondsIn[POWER_LOW],
+             (unsigned long)_stats.changes, (unsigned long)_stats.gaps,
+             (unsigned long)(_stats.gapMs / 1000),
+             (unsigned long)_stats.backoffs);
+}
+
+void PowerGovernor::write(Print &out) const {
+  for (uint8_t i = 0; writePart(i, out); i++)
+    ;
+}
+
+// Parts: the gauges and totals, then a line per state
+bool PowerGovernor::writePart(uint8_t part, Print &out) const {
+  if (part > POWER_STATES)
+    return false;
+  if (part > 0) {
+    out.printf("esp12f_power_state_seconds_total{state=\"%s\"} %lu\n",
+               name(part - 1), (unsigned long)_stats.secondsIn[part - 1]);
+    return true;
+  }
+  unsigned long uAh = _stats.mAms / 3600UL;
+  out.printf("# HELP esp12f_power_state 0 low, 1 eco, 2 full\n"
+             "# TYPE esp12f_power_state gauge\n"
+             "esp12f_power_state %u\n"
+             "# HELP esp12f_power_estimated_milliamps Estimated draw\n"
+             "# TYPE esp12f_power_estimated_milliamps gauge\n"
+             "esp12f_power_estimated_milliamps %u\n"
+             "# TYPE esp12f_power_estimated_mah_total counter\n"
+             "esp12f_power_estimated_mah_total %lu.%03lu\n"
+             "# TYPE esp12f_power_sleep_seconds_total counter\n"
+             "esp12f_power_sleep_seconds_total %lu.%03lu\n"
+             "# TYPE esp12f_power_state_seconds_total counter\n",
+             _state, _ma, uAh / 1000, uAh % 1000,
+             (unsigned long)(_stats.gapMs / 1000),
+             (unsigned long)(_stats.gapMs % 1000));
+  return true;
+}
@@ -0,0 +1,110 @@
+#include "sensor_filter.h"
+
+SensorFilter::SensorFilter(int16_t maxJump, uint8_t emaShift)
+    : _maxJump(maxJump), _emaShift(emaShift), _next(0), _count(0),
+      _rejectRun(0), _rejectSide(0), _ema(0), _rate(0), _markHead(0), _marks(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+int16_t SensorFilter::whole() const {
+  int16_t v = value();
+  return v >= 0 ? (v + 5) / 10 : (v - 5) / 10;
+}
+
+void SensorFilter::seed(int16_t x) {
+  for (uint8_t i = 0; i < FILTER_MEDIAN_N; i++)
+    _window[i] = x;
+  _count = FILTER_MEDIAN_N;
+  _ema = (int32_t)x << 8;
+}
+
+int16_t SensorFilter::median() const {
+  int16_t s[FILTER_MEDIAN_N];
+  uint8_t n = _count;
+  for (uint8_t i = 0; i < n; i++) { // insertion sort, n <= 5
+    int16_t v = _window[i];
+    uint8_t j = i;
+    for (; j > 0 && s[j - 1] > v; j--)
+      s[j] = s[j - 1];
+    s[j] = v;
+  }
+  return s[n / 2];
+}
+
+uint8_t SensorFilter::oldestMark() const {
+  return (_markHead + FILTER_RATE_SLOTS - _marks) % FILTER_RATE_SLOTS;
+}
+
+void SensorFilter::updateRate(unsigned long now) {
+  uint8_t newest = (_markHead + FILTER_RATE_SLOTS - 1) % FILTER_RATE_SLOTS;
+  if (!_marks ||
+      now - _markTime[newest] >= FILTER_RATE_WINDOW_MS / FILTER_RATE_SLOTS) {
+    _mark[_markHead] = _ema;
+    _markTime[_markHead] = now;
+    _markHead = (_markHead + 1) % FILTER_RATE_SLOTS;
+    if (_marks < FILTER_RATE_SLOTS)
+      _marks++;
+  }
+
+  uint8_t first = oldestMark();
+  unsigned long span = now - _markTime[first];
+  // Per minute in 100 ms units, which keeps DHT11 ranges within int32
+  _rate = span >= FILTER_RATE_MIN_MS
+              ? (_ema - _mark[first]) * 600 / (int32_t)(span / 100)
+              : 0;
+}
+
+void SensorFilter::add(int16_t x, unsigned long now) {
+  uint32_t c0 = ESP.getCycleCount();
+  _stats.samples++;
+
+  // Checkpoints past the window go, all of them after a gap in the
+  // samples, so a rate is never taken across one or left standing
+  while (_marks && now - _markTime[oldestMark()] > FILTER_RATE_WINDOW_MS)
+    _marks--;
+  if (!_marks)
+    _rate = 0;
+
+  // Outliers count towards a step only while they stay on one side
+  bool outlier = valid() && abs(x - value()) > _maxJump;
+  if (outlier) {
+    int8_t side = x > value() ? 1 : -1;
+    if (side != _rejectSide)
+      _rejectRun = 0;
+    _rejectSide = side;
+    _rejectRun++;
+  }
+
+  if (!valid()) {
+    seed(x);
+    updateRate(now);
+  } else if (outlier && _rejectRun < FILTER_REJECT_MAX) {
+    _stats.rejected++;
+  } else {
+    if (_rejectRun >= FILTER_REJECT_MAX) {
+      // Persistent: a real step, not noise. Jump to it; the checkpoints
+      // still hold the old level, so the step shows in the rate.
+      seed(x);
+    } else {
+      _window[_next] = x;
+      _next = (_next + 1) % FILTER_MEDIAN_N;
+      _ema += (((int32_t)median() << 8) - _ema) >> _emaShift;
+    }
+    _rejectRun = 0;
+    updateRate(now);
+  }
+
+  _stats.lastCycles = ESP.getCycleCount() - c0;
+  if (_stats.lastCycles > _stats.maxCycles)
+    _stats.maxCycles = _stats.lastCycles;
+}
+
+void SensorFilter::print(Print &out, const char *name) const {
+  int16_t v = value();
+  out.printf("Filter %s: %s%d.%d rate %d/min, %lu samples, %lu rejected, "
+             "%lu cycles max %lu\n",
+             name, v < 0 ? "-" : "", abs(v) / 10, abs(v) % 10, ratePerMin(),
+             (unsigned long)_stats.samples, (unsigned long)_stats.rejected,
+             (unsigned long)_stats.lastCycles,
+             (unsigned long)_stats.maxCycles);
+}
@@ -0,0 +1,109 @@
+#include "sse_hub.h"
+
+SseHub::SseHub(const Telemetry &tel) : _tel(tel) {
+  for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+    _slots[i].active = false;
+    _slots[i].pending = 0;
+    _slots[i].head = _slots[i].len = 0;
+  }
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool SseHub::add(WiFiClient &client) {
+  for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+    Slot &s = _slots[i];
+    if (s.active)
+      continue;
+    s.client = client; // keeps the socket open after the handler returns
+    s.client.setNoDelay(true);
+    s.active = true;
+    s.pending = 0xFF; // first event is a full snapshot
+    s.head = s.len = 0;
+    s.lastProgress = millis();
+    _stats.accepted++;
+    return true;
+  }
+  _stats.rejected++;
+  return false;
+}
+
+void SseHub::publish(uint8_t fields) {
+  if (!fields)
+    return;
+  for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+    if (_slots[i].active)
+      _slots[i].pending |= fields;
+  }
+}
+
+uint8_t SseHub::clients() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++)
+    n += _slots[i].active;
+  return n;
+}
+
+void SseHub::drop(Slot &s) {
+  s.client.stop();
+  s.client = WiFiClient();
+  s.active = false;
+  s.pending = 0;
+  s.head = s.len = 0;
+  _stats.dropped++;
+}
+
+// Serializes the pending fields (or a keep-alive comment) into an empty queue
+void SseHub::fill(Slot &s, unsigned long now) {
+  static const char prefix[] = "data: ";
+  const size_t pre = sizeof(prefix) - 1;
+
+  if (s.pending) {
+    memcpy(s.queue, prefix, pre);
+    size_t n = _tel.toJson((char *)s.queue + pre, SSE_QUEUE_BYTES - pre - 2,
+                           s.pending);
+    if (n == 0)
+      return;
+    s.queue[pre + n] = '\n';
+    s.queue[pre + n + 1] = '\n';
+    s.len = pre + n + 2;
+    s.pending = 0;
+    _stats.events++;
+  } else if (now - s.lastProgress > SSE_KEEPALIVE_MS) {
+    memcpy(s.queue, ":\n\n", 3);
+    s.len = 3;
+  }
+  s.head = 0;
+}
+
+void SseHub::drain(Slot &s, unsigned long now) {
+  if (s.len == 0)
+    return;
+  size_t room = s.client.availableForWrite();
+  if (room == 0) {
+    if (now - s.lastProgress > SSE_STALL_MS)
+      drop(s);
+    return;
+  }
+  size_t n = s.client.write(s.queue + s.head, room < s.len ? room : s.len);
+  if (n > 0) {
+    s.head += n;
+    s.len -= n;
+    s.lastProgress = now;
+    _stats.bytes += n;
+  }
+}
+
+void SseHub::loop(unsigned long now) {
+  for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+    Slot &s = _slots[i];
+    if (!s.active)
+      continue;
+    if (!s.client.connected()) {
+      drop(s);
+      continue;
+    }
+    if (s.len == 0)
+      fill(s, now);
+    drain(s, now);
+  }
+}
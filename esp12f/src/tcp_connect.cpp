@@ -0,0 +1,112 @@
+#include "tcp_connect.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+
+#include <ESP8266WiFi.h>
+#include <lwip/tcp.h>
+#include <include/ClientContext.h>
+
+// WiFiClient's ClientContext constructor is protected; WiFiServer uses it
+// the same way for accepted connections.
+class TcpConnectClient : public WiFiClient {
+public:
+  explicit TcpConnectClient(ClientContext *ctx) : WiFiClient(ctx) {}
+};
+
+static err_t tcpConnected(void *arg, struct tcp_pcb *pcb, err_t err) {
+  static_cast<TcpConnect *>(arg)->connected(pcb);
+  return ERR_OK;
+}
+
+// The pcb is already freed by lwIP when this runs
+static void tcpError(void *arg, err_t err) {
+  static_cast<TcpConnect *>(arg)->failed();
+}
+
+TcpConnect::TcpConnect() : _state(TCP_CONNECT_IDLE), _pcb(nullptr) {}
+
+TcpConnect::~TcpConnect() { cancel(); }
+
+bool TcpConnect::begin(const IPAddress &ip, uint16_t port) {
+  cancel();
+  _pcb = tcp_new();
+  if (!_pcb)
+    return false;
+  tcp_arg(_pcb, this);
+  tcp_err(_pcb, tcpError);
+  if (tcp_connect(_pcb, ip, port, tcpConnected) != ERR_OK) {
+    tcp_arg(_pcb, nullptr);
+    tcp_err(_pcb, nullptr);
+    tcp_abort(_pcb);
+    _pcb = nullptr;
+    return false;
+  }
+  _state = TCP_CONNECT_PENDING;
+  return true;
+}
+
+void TcpConnect::connected(struct tcp_pcb *pcb) {
+  // ClientContext takes over the pcb and replaces the callbacks
+  _pcb = nullptr;
+  _client = TcpConnectClient(new ClientContext(pcb, nullptr, nullptr));
+  _state = TCP_CONNECT_DONE;
+}
+
+void TcpConnect::failed() {
+  _pcb = nullptr;
+  _state = TCP_CONNECT_FAILED;
+}
+
+TcpConnectState TcpConnect::poll() { return _state; }
+
+void TcpConnect::cancel() {
+  if (_pcb) {
+    tcp_arg(_pcb, nullptr);
+    tcp_err(_pcb, nullptr);
+    tcp_abort(_pcb);
+    _pcb = nullptr;
+  }
+  _client.stop();
+  _client = WiFiClient();
+  _state = TCP_CONNECT_IDLE;
+}
+
+#else // host
+
+TcpConnect::TcpConnect() : _state(TCP_CONNECT_IDLE) {}
+
+TcpConnect::~TcpConnect() { cancel(); }
+
+bool TcpConnect::begin(const IPAddress &ip, uint16_t port) {
+  cancel();
+  if (!_client.beginConnect(ip, port))
+    return false;
+  _state = TCP_CONNECT_PENDING;
+  return true;
+}
+
+TcpConnectState TcpConnect::poll() {
+  if (_state == TCP_CONNECT_PENDING) {
+    int r = _client.pollConnect();
+    if (r != 0)
+      _state = r > 0 ? TCP_CONNECT_DONE : TCP_CONNECT_FAILED;
+  }
+  return _state;
+}
+
+void TcpConnect::cancel() {
+  _client.stop();
+  _client = WiFiClient();
+  _state = TCP_CONNECT_IDLE;
+}
+
+#endif
+
+bool TcpConnect::take(WiFiClient &client) {
+  if (poll() != TCP_CONNECT_DONE)
+    return false;
+  client = _client;
+  _client = WiFiClient();
+  _state = TCP_CONNECT_IDLE;
+  return true;
+}
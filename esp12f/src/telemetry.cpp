@@ -0,0 +1,178 @@
+#include "telemetry.h"
+
+// Formats degrees * 100 as "-23.55", clamped to +-180.00 so the worst
+// case ("-180.00") provably fits lat/lon
+static void formatE2(char *buf, size_t len, int32_t e2) {
+  uint16_t a = (uint16_t)std::min<uint32_t>(e2 < 0 ? -(uint32_t)e2 : e2, 18000);
+  snprintf(buf, len, "%s%u.%02u", e2 < 0 ? "-" : "", (unsigned)(a / 100),
+           (unsigned)(a % 100));
+}
+
+void Telemetry::begin() {
+  tempC = INT16_MIN;
+  humPct = INT16_MIN;
+  hour = minute = second = 0;
+  day = month = year = 0;
+  latE2 = lonE2 = 0;
+  timeValid = dateValid = locValid = false;
+  gpsFix = false;
+  led = false;
+  strcpy(temp, "--");
+  strcpy(hum, "--");
+  strcpy(time, "00:00:00");
+  strcpy(date, "00/00/00");
+  strcpy(lat, "-0.00");
+  strcpy(lon, "-0.00");
+  changed = 0xFF;
+  version = 1;
+}
+
+size_t Telemetry::toJson(char *buf, size_t len, uint8_t fields) const {
+  // Same keys and quoting the dashboard has always consumed
+  const char *str[] = {temp, hum, time, date, lat, lon,
+                       gpsFix ? "1" : "0", led ? "1" : "0"};
+  static const char *const keys[] = {"temp", "hum", "time", "date",
+                                     "lat",  "lon", "gps",  "led"};
+  size_t n = 0;
+  bool first = true;
+
+  if (len < 3)
+    return 0;
+  buf[n++] = '{';
+  for (uint8_t i = 0; i < 8; i++) {
+    if (!(fields & (1 << i)))
+      continue;
+    const char *fmt = (1 << i) == TELEM_LED ? "%s\"%s\":%s" : "%s\"%s\":\"%s\"";
+    int w = snprintf(buf + n, len - n, fmt, first ? "" : ",", keys[i], str[i]);
+    if (w < 0 || (size_t)w >= len - n - 1)
+      return 0; // would not fit with the closing brace
+    n += w;
+    first = false;
+  }
+  buf[n++] = '}';
+  buf[n] = 0;
+  return n;
+}
+
+void Telemetry::setTemp(int16_t c) {
+  if (c == tempC)
+    return;
+  tempC = c;
+  snprintf(temp, sizeof(temp), "%d", c);
+  mark(TELEM_TEMP);
+}
+
+void Telemetry::setHum(int16_t pct) {
+  if (pct == humPct)
+    return;
+  humPct = pct;
+  snprintf(hum, sizeof(hum), "%d", pct);
+  mark(TELEM_HUM);
+}
+
+void Telemetry::setTime(uint8_t h, uint8_t m, uint8_t s) {
+  if (timeValid && h == hour && m == minute && s == second)
+    return;
+  timeValid = true;
+  hour = h;
+  minute = m;
+  second = s;
+  // In range, the fields provably fit two digits each
+  snprintf(time, sizeof(time), "%02u:%02u:%02u", h % 24, m % 60, s % 60);
+  mark(TELEM_TIME);
+}
+
+void Telemetry::clearTime() {
+  if (!timeValid)
+    return;
+  timeValid = false;
+  hour = minute = second = 0;
+  strcpy(time, "00:00:00");
+  mark(TELEM_TIME);
+}
+
+void Telemetry::setDate(uint8_t d, uint8_t m, uint8_t y) {
+  if (dateValid && d == day && m == month && y == year)
+    return;
+  dateValid = true;
+  day = d;
+  month = m;
+  year = y;
+  snprintf(date, sizeof(date), "%02u/%02u/%02u", d % 32, m % 13, y % 100);
+  mark(TELEM_DATE);
+}
+
+void Telemetry::clearDate() {
+  if (!dateValid)
+    return;
+  dateValid = false;
+  day = month = year = 0;
+  strcpy(date, "00/00/00");
+  mark(TELEM_DATE);
+}
+
+void Telemetry::setLocation(double latDeg, double lonDeg) {
+  int32_t la = lround(latDeg * 100.0);
+  int32_t lo = lround(lonDeg * 100.0);
+  if (!locValid || la != latE2) {
+    latE2 = la;
+    formatE2(lat, sizeof(lat), la);
+    mark(TELEM_LAT);
+  }
+  if (!locValid || lo != lonE2) {
+    lonE2 = lo;
+    formatE2(lon, sizeof(lon), lo);
+    mark(TELEM_LON);
+  }
+  locValid = true;
+}
+
+void Telemetry::clearLocation() {
+  if (!locValid)
+    return;
+  locValid = false;
+  latE2 = lonE2 = 0;
+  strcpy(lat, "-0.00");
+  strcpy(lon, "-0.00");
+  mark(TELEM_LAT | TELEM_LON);
+}
+
+void Telemetry::setGpsFix(bool fix) {
+  if (fix == gpsFix)
+    return;
+  gpsFix = fix;
+  mark(TELEM_GPS);
+}
+
+void Telemetry::setLed(bool on) {
+  if (on == led)
+    return;
+  led = on;
+  mark(TELEM_LED);
+}
+
+void HeapReport::begin() {
+  sample();
+  minFree = freeBytes;
+  minMaxBlock = maxBlock;
+  maxFragPct = fragPct;
+}
+
+void HeapReport::sample() {
+  freeBytes = ESP.getFreeHeap();
+  maxBlock = ESP.getMaxFreeBlockSize();
+  fragPct = ESP.getHeapFragmentation();
+  if (freeBytes < minFree)
+    minFree = freeBytes;
+  if (maxBlock < minMaxBlock)
+    minMaxBlock = maxBlock;
+  if (fragPct > maxFragPct)
+    maxFragPct = fragPct;
+}
+
+void HeapReport::print(Print &out) const {
+  out.printf("Heap: free=%lu maxBlock=%lu frag=%u%% | min free=%lu "
+             "min maxBlock=%lu max frag=%u%%\n",
+             (unsigned long)freeBytes, (unsigned long)maxBlock, fragPct,
+             (unsigned long)minFree, (unsigned long)minMaxBlock, maxFragPct);
+}
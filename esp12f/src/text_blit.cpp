@@ -0,0 +1,42 @@
+#include "text_blit.h"
+#include "glyph_atlas.h"
+
+int16_t blitText(Adafruit_SSD1306 &display, int16_t x, int16_t y,
+                 const char *s, uint8_t n) {
+  uint8_t *buf = display.getBuffer();
+  const int16_t w = display.width();
+  const int16_t pages = display.height() / 8;
+
+  for (; n && *s; n--, s++) {
+    uint8_t c = *s;
+    if (c < ATLAS_FIRST || c > ATLAS_LAST) {
+      display.setCursor(x, y);
+      display.write(c);
+      x = display.getCursorX();
+      continue;
+    }
+
+    AtlasGlyph g;
+    memcpy_P(&g, &ATLAS_GLYPHS[c - ATLAS_FIRST], sizeof(g));
+    int16_t top = y + g.yOffset;
+    int16_t left = x + g.xOffset;
+    uint8_t shift = top >= 0 ? top & 7 : 0;
+    int16_t firstPage = top >= 0 ? top >> 3 : 0;
+
+    for (uint8_t col = 0; col < g.width; col++) {
+      int16_t px = left + col;
+      if (px < 0 || px >= w)
+        continue;
+      uint32_t bits = pgm_read_word(&ATLAS_COLUMNS[g.column + col]);
+      bits = top >= 0 ? bits << shift : bits >> -top;
+      uint8_t *dst = buf + firstPage * w + px;
+      for (int16_t page = firstPage; bits && page < pages; page++) {
+        *dst |= (uint8_t)bits;
+        bits >>= 8;
+        dst += w;
+      }
+    }
+    x += g.xAdvance;
+  }
+  return x;
+}
@@ -0,0 +1,237 @@
+#include "track_export.h"
+#include "debug_log.h"
+
+#define CHUNK_DATA 5        // after "XXX\r\n"
+#define POINT_MAX_TEXT 112  // longest formatted point, with margin
+
+static const char GPX_HEAD[] PROGMEM =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<gpx version=\"1.1\" creator=\"esp12f\" "
+    "xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+    "<trk><name>esp12f</name><trkseg>\n";
+static const char GPX_TAIL[] PROGMEM = "</trkseg></trk></gpx>\n";
+static const char GEOJSON_HEAD[] PROGMEM =
+    "{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\","
+    "\"coordinates\":[";
+static const char GEOJSON_MIDDLE[] PROGMEM =
+    "]},\"properties\":{\"name\":\"esp12f\",\"coordTimes\":[";
+static const char GEOJSON_TAIL[] PROGMEM = "]}}\n";
+
+// "-23.550000" from microdegrees, without going through float
+static void formatDeg(char *out, size_t len, int32_t e6) {
+  uint32_t a = e6 < 0 ? -(int64_t)e6 : e6;
+  snprintf(out, len, "%s%lu.%06lu", e6 < 0 ? "-" : "",
+           (unsigned long)(a / 1000000), (unsigned long)(a % 1000000));
+}
+
+// "2025-10-09T12:00:00Z"
+static void formatTime(char *out, size_t len, uint32_t epoch) {
+  int32_t z = epoch / 86400 + 719468;
+  int32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+  uint32_t year = yoe + era * 400 + (month <= 2);
+  uint32_t s = epoch % 86400;
+  snprintf(out, len, "%04lu-%02lu-%02luT%02lu:%02lu:%02luZ",
+           (unsigned long)year, (unsigned long)month, (unsigned long)day,
+           (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60),
+           (unsigned long)(s % 60));
+}
+
+TrackExport::TrackExport(TrackLog &log)
+    : _log(log), _phase(PHASE_IDLE), _format(TRACK_GPX), _from(0), _to(0),
+      _count(0), _began(0), _lastProgress(0), _sndBuf(0), _used(0), _head(0), _len(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool TrackExport::start(WiFiClient &client, TrackFormat format, uint32_t from,
+                        uint32_t to) {
+  if (busy()) {
+    _stats.rejected++;
+    return false;
+  }
+  _log.flush(); // include the fixes still in RAM
+  _log.holdRotation(true);
+
+  _client = client; // keeps the socket open after the handler returns
+  _format = format;
+  _from = from;
+  _to = to ? to : 0xFFFFFFFF;
+  _count = 0;
+  _began = _lastProgress = millis();
+  _sndBuf = _client.availableForWrite();
+  _head = _len = 0;
+  _phase = PHASE_HEAD;
+  _stats.started++;
+  _stats.points = 0;
+  _stats.bytes = 0;
+
+  char head[192];
+  int n = snprintf_P(
+      head, sizeof(head),
+      PSTR("HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+           "Content-Disposition: attachment; filename=track.%s\r\n"
+           "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n"),
+      format == TRACK_GPX ? "application/gpx+xml" : "application/geo+json",
+      format == TRACK_GPX ? "gpx" : "geojson");
+  _client.write((const uint8_t *)head, n);
+  return true;
+}
+
+// Callers keep POINT_MAX_TEXT free, which every piece fits in
+void TrackExport::append(const char *s) {
+  size_t n = strlen(s);
+  memcpy(_chunk + CHUNK_DATA + _used, s, n);
+  _used += n;
+}
+
+void TrackExport::appendP(PGM_P s) {
+  size_t n = strlen_P(s);
+  memcpy_P(_chunk + CHUNK_DATA + _used, s, n);
+  _used += n;
+}
+
+// Builds the next chunk from wherever the export is. May come back empty
+// when a narrow time range skips TRACK_EXPORT_SCAN records in a row.
+void TrackExport::fill() {
+  char text[POINT_MAX_TEXT];
+  uint16_t scanned = 0;
+  _used = 0;
+
+  while (_used + POINT_MAX_TEXT <= TRACK_EXPORT_CHUNK &&
+         scanned < TRACK_EXPORT_SCAN) {
+    if (_phase == PHASE_HEAD) {
+      appendP(_format == TRACK_GPX ? GPX_HEAD : GEOJSON_HEAD);
+      _reader.begin();
+      _phase = PHASE_POINTS;
+    } else if (_phase == PHASE_POINTS || _phase == PHASE_TIMES) {
+      TrackPoint p;
+      scanned++;
+      // The times pass never runs past the coordinates it pairs with
+      if ((_phase == PHASE_TIMES && _count >= _stats.points) ||
+          !_reader.next(p)) {
+        if (_phase == PHASE_POINTS)
+          _stats.points = _count;
+        _phase = _format == TRACK_GEOJSON && _phase == PHASE_POINTS
+                     ? PHASE_MIDDLE
+                     : PHASE_TAIL;
+        continue;
+      }
+      if (p.epoch < _from || p.epoch > _to)
+        continue;
+      char lat[13], lon[13], when[21];
+      formatDeg(lat, sizeof(lat), p.lat);
+      formatDeg(lon, sizeof(lon), p.lon);
+      formatTime(when, sizeof(when), p.epoch);
+      const char *sep = _count ? "," : "";
+      if (_format == TRACK_GPX)
+        snprintf(text, sizeof(text),
+                 "<trkpt lat=\"%s\" lon=\"%s\"><time>%s</time></trkpt>\n",
+                 lat, lon, when);
+      else if (_phase == PHASE_POINTS)
+        snprintf(text, sizeof(text), "%s[%s,%s]", sep, lon, lat);
+      else
+        snprintf(text, sizeof(text), "%s\"%s\"", sep, when);
+      append(text);
+      _count++;
+    } else if (_phase == PHASE_MIDDLE) {
+      appendP(GEOJSON_MIDDLE);
+      _reader.rewind();
+      _count = 0;
+      _phase = PHASE_TIMES;
+    } else if (_phase == PHASE_TAIL) {
+      appendP(_format == TRACK_GPX ? GPX_TAIL : GEOJSON_TAIL);
+      _reader.end();
+      _phase = PHASE_LAST_CHUNK;
+      break;
+    } else {
+      break;
+    }
+  }
+
+  _head = 0;
+  if (_used == 0) {
+    _len = 0;
+    if (_phase == PHASE_LAST_CHUNK) {
+      memcpy(_chunk, "0\r\n\r\n", 5);
+      _len = 5;
+      _phase = PHASE_DONE;
+    }
+    return;
+  }
+  char size[4];
+  snprintf(size, sizeof(size), "%03X", (unsigned)_used);
+  memcpy(_chunk, size, 3);
+  _chunk[3] = '\r';
+  _chunk[4] = '\n';
+  _chunk[CHUNK_DATA + _used] = '\r';
+  _chunk[CHUNK_DATA + _used + 1] = '\n';
+  _len = CHUNK_DATA + _used + 2;
+}
+
+void TrackExport::finish(bool ok, unsigned long now) {
+  _client.stop();
+  _client = WiFiClient();
+  _reader.end();
+  _log.holdRotation(false);
+  _phase = PHASE_IDLE;
+  _len = 0;
+  _stats.millis = now - _began;
+  if (!ok) {
+    _stats.aborted++;
+    LOG.println(F("Track export: aborted"));
+    return;
+  }
+  unsigned long ms = _stats.millis ? _stats.millis : 1;
+  unsigned long kbps10 = (uint64_t)_stats.bytes * 10000 / ms / 1024;
+  LOG.printf("Track export: %lu points, %lu B in %lums (%lu.%lu KB/s)\n",
+             (unsigned long)_stats.points, (unsigned long)_stats.bytes, ms,
+             kbps10 / 10, kbps10 % 10);
+}
+
+void TrackExport::loop(unsigned long now) {
+  if (!busy())
+    return;
+  if (_phase == PHASE_DRAIN) {
+    // Close once the client has acked everything, so stop() never waits
+    // or resets a connection with the end of the file still unsent
+    if (_client.availableForWrite() >= _sndBuf || !_client.connected())
+      finish(true, now);
+    else if (now - _lastProgress > TRACK_EXPORT_DRAIN_MS)
+      finish(false, now);
+    return;
+  }
+  if (!_client.connected()) {
+    finish(false, now);
+    return;
+  }
+
+  if (_len == 0)
+    fill();
+  if (_len == 0) {
+    if (_phase == PHASE_DONE) {
+      _phase = PHASE_DRAIN; // terminating chunk is queued
+      _lastProgress = now;
+    }
+    return;
+  }
+
+  size_t room = _client.availableForWrite();
+  if (room == 0) {
+    if (now - _lastProgress > TRACK_EXPORT_STALL_MS)
+      finish(false, now);
+    return;
+  }
+  size_t n = _client.write((const uint8_t *)_chunk + _head,
+                           room < _len ? room : _len);
+  if (n > 0) {
+    _head += n;
+    _len -= n;
+    _stats.bytes += n;
+    _lastProgress = now;
+  }
+}
@@ -0,0 +1,239 @@
+#include "track_log.h"
+#include "debug_log.h"
+
+static size_t putVarint(uint8_t *out, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (v >> 31); }
+
+static size_t putLE32(uint8_t *out, uint32_t v) {
+  out[0] = v;
+  out[1] = v >> 8;
+  out[2] = v >> 16;
+  out[3] = v >> 24;
+  return 4;
+}
+
+TrackLog::TrackLog()
+    : _mounted(false), _holdRotation(false), _len(0), _firstQueued(0), _lastEpoch(0), _lastLat(0),
+      _lastLon(0), _sinceKey(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool TrackLog::begin() {
+  if (!LittleFS.begin()) {
+    LOG.println(F("Track: formatting LittleFS..."));
+    if (!LittleFS.format() || !LittleFS.begin()) {
+      LOG.println(F("Track: no filesystem, logging off"));
+      return false;
+    }
+  }
+  _mounted = true;
+  return true;
+}
+
+size_t TrackLog::encode(uint8_t *out, uint32_t epoch, int32_t lat,
+                        int32_t lon) {
+  size_t n = 0;
+  bool key = _len == 0 || _sinceKey >= TRACK_KEYFRAME_EVERY ||
+             epoch <= _lastEpoch;
+  if (key) {
+    out[n++] = 0;
+    n += putLE32(out + n, epoch);
+    n += putLE32(out + n, lat);
+    n += putLE32(out + n, lon);
+    _sinceKey = 0;
+    _stats.keyframes++;
+  } else {
+    n += putVarint(out + n, epoch - _lastEpoch);
+    n += putVarint(out + n, zigzag(lat - _lastLat));
+    n += putVarint(out + n, zigzag(lon - _lastLon));
+    _sinceKey++;
+  }
+  _lastEpoch = epoch;
+  _lastLat = lat;
+  _lastLon = lon;
+  return n;
+}
+
+void TrackLog::add(uint32_t epoch, int32_t lat, int32_t lon) {
+  if (!_mounted || epoch == 0)
+    return;
+  if (_len + TRACK_RECORD_MAX > TRACK_BLOCK)
+    flush(); // records never straddle a block
+  if (_len == 0)
+    _firstQueued = millis();
+  _len += encode(_buf + _len, epoch, lat, lon);
+  _stats.fixes++;
+}
+
+void TrackLog::loop(unsigned long now) {
+  if (_len && now - _firstQueued > TRACK_FLUSH_MS)
+    flush();
+}
+
+void TrackLog::flush() {
+  if (!_mounted || _len == 0)
+    return;
+
+  unsigned long t0 = micros();
+  File f = LittleFS.open(TRACK_FILE, "a");
+  if (f && f.size() + _len > TRACK_MAX_BYTES && !_holdRotation) {
+    f.close();
+    LittleFS.remove(TRACK_OLD_FILE);
+    LittleFS.rename(TRACK_FILE, TRACK_OLD_FILE);
+    f = LittleFS.open(TRACK_FILE, "a");
+  }
+  bool ok = f;
+  if (ok && f.size() == 0)
+    ok = f.write((const uint8_t *)TRACK_MAGIC, 4) == 4;
+  if (ok)
+    ok = f.write(_buf, _len) == _len;
+  if (f)
+    f.close();
+
+  if (ok) {
+    _stats.bytes += _len;
+  } else {
+    _stats.failed++;
+    LOG.println(F("Track: write failed, block dropped"));
+  }
+  _stats.flushes++;
+  _stats.lastFlushMicros = micros() - t0;
+  if (_stats.lastFlushMicros > _stats.maxFlushMicros)
+    _stats.maxFlushMicros = _stats.lastFlushMicros;
+  _len = 0; // next record is a keyframe
+}
+
+void TrackLog::print(Print &out) const {
+  unsigned long perFix100 =
+      _stats.fixes ? (_stats.bytes + _len) * 100UL / _stats.fixes : 0;
+  out.printf("Track: %lu fixes, %lu keyframes, %lu B (%lu.%02lu B/fix), "
+             "flush %luus max %luus, %lu failed\n",
+             (unsigned long)_stats.fixes, (unsigned long)_stats.keyframes,
+             (unsigned long)(_stats.bytes + _len), perFix100 / 100,
+             perFix100 % 100, (unsigned long)_stats.lastFlushMicros,
+             (unsigned long)_stats.maxFlushMicros,
+             (unsigned long)_stats.failed);
+}
+
+TrackReader::TrackReader()
+    : _index(2), _size{0, 0}, _remaining(0), _pos(0), _len(0),
+      _haveKey(false) {}
+
+bool TrackReader::begin() {
+  for (uint8_t i = 0; i < 2; i++) {
+    File f = LittleFS.open(i == 0 ? TRACK_OLD_FILE : TRACK_FILE, "r");
+    _size[i] = f ? f.size() : 0;
+  }
+  return rewind();
+}
+
+bool TrackReader::rewind() {
+  _haveKey = false;
+  return open(0) || open(1);
+}
+
+void TrackReader::end() {
+  if (_file)
+    _file.close();
+  _index = 2;
+}
+
+bool TrackReader::open(uint8_t index) {
+  if (_file)
+    _file.close();
+  _index = index;
+  _pos = _len = 0;
+  _remaining = 0;
+  if (index > 1)
+    return false;
+  _file = LittleFS.open(index == 0 ? TRACK_OLD_FILE : TRACK_FILE, "r");
+  if (!_file)
+    return false;
+  _remaining = _file.size() < _size[index] ? _file.size() : _size[index];
+  char magic[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t c;
+    if (!readByte(c))
+      return false;
+    magic[i] = c;
+  }
+  _haveKey = false; // deltas never cross files
+  return memcmp(magic, TRACK_MAGIC, 4) == 0;
+}
+
+bool TrackReader::readByte(uint8_t &c) {
+  if (_pos == _len) {
+    if (_remaining == 0)
+      return false;
+    size_t want = _remaining < sizeof(_buf) ? _remaining : sizeof(_buf);
+    _len = _file.read(_buf, want);
+    _pos = 0;
+    if (_len == 0)
+      return false;
+    _remaining -= _len;
+  }
+  c = _buf[_pos++];
+  return true;
+}
+
+bool TrackReader::readVarint(uint32_t &v) {
+  v = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    uint8_t c;
+    if (!readByte(c))
+      return false;
+    v |= (uint32_t)(c & 0x7F) << shift;
+    if (c < 0x80)
+      return true;
+  }
+  return false;
+}
+
+bool TrackReader::readLE32(uint32_t &v) {
+  v = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t c;
+    if (!readByte(c))
+      return false;
+    v |= (uint32_t)c << (8 * i);
+  }
+  return true;
+}
+
+bool TrackReader::next(TrackPoint &p) {
+  while (_index < 2) {
+    uint32_t h, t, a, b;
+    if (!readVarint(h)) {
+      open(_index + 1); // end of file (a torn tail is skipped)
+      continue;
+    }
+    if (h == 0) {
+      if (!readLE32(t) || !readLE32(a) || !readLE32(b))
+        continue;
+      _last.epoch = t;
+      _last.lat = (int32_t)a;
+      _last.lon = (int32_t)b;
+      _haveKey = true;
+    } else {
+      if (!readVarint(a) || !readVarint(b))
+        continue;
+      if (!_haveKey)
+        continue; // file did not start with a keyframe
+      _last.epoch += h;
+      _last.lat += (int32_t)(a >> 1) ^ -(int32_t)(a & 1);
+      _last.lon += (int32_t)(b >> 1) ^ -(int32_t)(b & 1);
+    }
+    p = _last;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,72 @@
+#include "track_simplify.h"
+
+#define M_PER_UDEG 0.1113195f // metres per microdegree of latitude
+
+TrackSimplifier::TrackSimplifier()
+    : _hasAnchor(false), _count(0), _kx(M_PER_UDEG), _in(0), _out(0) {
+  setTolerance(TRACK_TOLERANCE_M);
+}
+
+void TrackSimplifier::setAnchor(const TrackPoint &p) {
+  _anchor = p;
+  _hasAnchor = true;
+  _kx = M_PER_UDEG * cosf(p.lat * (float)(M_PI / 180e6));
+  _out++;
+}
+
+// True if every buffered fix is within tolerance of anchor -> end
+bool TrackSimplifier::fits(const TrackPoint &end) const {
+  float bx = (end.lon - _anchor.lon) * _kx;
+  float by = (end.lat - _anchor.lat) * M_PER_UDEG;
+  float len2 = bx * bx + by * by;
+
+  for (uint8_t i = 0; i < _count; i++) {
+    float px = (_window[i].lon - _anchor.lon) * _kx;
+    float py = (_window[i].lat - _anchor.lat) * M_PER_UDEG;
+    float t = len2 > 0 ? (px * bx + py * by) / len2 : 0;
+    t = constrain(t, 0.0f, 1.0f);
+    float dx = px - t * bx;
+    float dy = py - t * by;
+    if (dx * dx + dy * dy > _tol2)
+      return false;
+  }
+  return true;
+}
+
+bool TrackSimplifier::push(const TrackPoint &p, TrackPoint &out) {
+  _in++;
+  if (!_hasAnchor) {
+    setAnchor(p);
+    out = p;
+    return true;
+  }
+
+  if (_count < TRACK_WINDOW && fits(p)) {
+    _window[_count++] = p;
+    return false;
+  }
+
+  // p bends the track (or the window is full): keep the fix before it
+  out = _window[_count - 1];
+  setAnchor(out);
+  _window[0] = p;
+  _count = 1;
+  return true;
+}
+
+bool TrackSimplifier::flush(TrackPoint &out) {
+  _hasAnchor = false; // next fix starts a new segment
+  if (_count == 0)
+    return false;
+  out = _window[_count - 1];
+  _count = 0;
+  _out++;
+  return true;
+}
+
+void TrackSimplifier::print(Print &out) const {
+  unsigned long ratio10 = _out ? _in * 10UL / _out : 0;
+  out.printf("Track simplify: %lu fixes -> %lu points (%lu.%lux, %.1f m)\n",
+             (unsigned long)_in, (unsigned long)_out, ratio10 / 10,
+             ratio10 % 10, sqrtf(_tol2));
+}
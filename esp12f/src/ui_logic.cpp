@@ -0,0 +1,199 @@
+#include "ui_logic.h"
+
+// DHT11 smoothing: outlier gate 5.0 C / 15.0 %, EMA alpha 1/4 (tenths)
+UiLogic::UiLogic(Telemetry &tel, FrameScheduler &frames)
+    : _tel(tel), _frames(frames), _temp(50, 2), _hum(150, 2),
+      _surpriseArmed(true), _face(FACE_NORMAL), _faceStart(0), _fix(false),
+      _noFixSince(0), _batteryLevel(3), _gpsBars(0), _hour(12),
+      _weatherCode(-1), _isDay(1), _weatherLive(false), _wifi(false),
+      _eye(true), _lastBlink(0), _blinkInterval(3000), _lookPhase(0),
+      _lookActive(false), _lastLookStep(0), _flash(false), _lastFlash(0),
+      _showDate(false), _lastDateToggle(0), _battBlink(true),
+      _lastBattBlink(0), _iconBlink(true), _lastIconBlink(0),
+      _lastUpdate(0) {}
+
+void UiLogic::begin(unsigned long now) { _noFixSince = now; }
+
+void UiLogic::setFace(FaceState face, unsigned long now) {
+  _face = face;
+  _faceStart = now;
+}
+
+void UiLogic::dhtSample(int16_t tempTenths, int16_t humTenths,
+                        unsigned long now) {
+  _hum.add(humTenths, now);
+  _temp.add(tempTenths, now);
+  _tel.setHum(_hum.whole());
+  _tel.setTemp(_temp.whole());
+
+  // Surprised on a fast temperature swing, once per swing
+  int16_t rate = abs(_temp.ratePerMin());
+  if (rate > FACE_SURPRISE_RATE && _surpriseArmed) {
+    _surpriseArmed = false;
+    setFace(FACE_SURPRISED, now);
+    _frames.request();
+  } else if (rate < FACE_SURPRISE_RATE / 2) {
+    _surpriseArmed = true;
+  }
+}
+
+bool UiLogic::loop(unsigned long now) {
+  // Battery blink timing (full=no blink, medium=1s, low=250ms)
+  unsigned long battInterval = 0;
+  if (_batteryLevel == 0)
+    battInterval = 250; // fast blink: low
+  else if (_batteryLevel <= 2)
+    battInterval = 1000; // slow blink: medium/charging
+  // level 3 = full, no blink (always on)
+
+  if (battInterval > 0 && now - _lastBattBlink > battInterval) {
+    _lastBattBlink = now;
+    _battBlink = !_battBlink;
+  } else if (battInterval == 0) {
+    _battBlink = true; // always on when full
+  }
+
+  // WiFi icon blink (500ms when not connected)
+  if (!_wifi && now - _lastIconBlink > 500) {
+    _lastIconBlink = now;
+    _iconBlink = !_iconBlink;
+  } else if (_wifi) {
+    _iconBlink = true; // always on when connected
+  }
+
+  // Blinking Logic (face)
+  if (_face == FACE_NORMAL || _face == FACE_LOOK) {
+    if (now - _lastBlink > (_eye ? _blinkInterval : 150)) {
+      _lastBlink = now;
+      _eye = !_eye;
+      if (_eye)
+        _blinkInterval = random(2000, 6000);
+      _frames.request();
+    }
+  }
+
+  // Look Around Animation Steps
+  if (_face == FACE_LOOK && now - _lastLookStep > UI_LOOK_STEP_MS) {
+    _lastLookStep = now;
+    _lookPhase++;
+    if (_lookPhase > 4) {
+      _lookPhase = 0;
+      _face = FACE_NORMAL;
+    }
+    _frames.request();
+  }
+
+  // Flashing logic (500ms - satellite dish, sleepy z's)
+  if (now - _lastFlash > 500) {
+    _lastFlash = now;
+    _flash = !_flash;
+    _frames.request();
+  }
+
+  // Date/Time toggle (every 5s)
+  if (now - _lastDateToggle > 5000) {
+    _lastDateToggle = now;
+    _showDate = !_showDate;
+    _frames.request();
+  }
+
+  if (now - _lastUpdate > UI_UPDATE_MS) {
+    _lastUpdate = now;
+    return true;
+  }
+  return false;
+}
+
+void UiLogic::update(unsigned long now, uint16_t vccMv, TinyGPSPlus &gps) {
+  // Battery level from VCC
+  if (vccMv > 3200)
+    _batteryLevel = 3;
+  else if (vccMv > 3000)
+    _batteryLevel = 2;
+  else if (vccMv > 2800)
+    _batteryLevel = 1;
+  else
+    _batteryLevel = 0;
+
+  // GPS Time (UTC-3 Brasília). Each field has its own age: RMC/GGA keep
+  // the time fresh without a fix, and only a fix commits the location.
+  if (gps.time.isValid() && gps.time.age() < UI_GPS_TIME_MAX_AGE) {
+    _hour = (gps.time.hour() + UI_UTC_OFFSET + 24) % 24;
+    _tel.setTime(_hour, gps.time.minute(), gps.time.second());
+  } else {
+    _tel.clearTime();
+  }
+
+  // Determine isDay based on Time if API hasn't set it (or as a fallback);
+  // a cached isDay from the last boot is kept until GPS time is known
+  if (!_weatherLive && (_tel.timeValid || _weatherCode == -1))
+    _isDay = _hour >= 6 && _hour < 18;
+
+  // GPS Date
+  if (gps.date.isValid() && gps.date.age() < UI_GPS_TIME_MAX_AGE) {
+    _tel.setDate(gps.date.day(), gps.date.month(), gps.date.year() % 100);
+  } else {
+    _tel.clearDate();
+  }
+
+  // GPS Location
+  bool hadFix = _fix;
+  _fix = gps.location.isValid() && gps.location.age() < UI_GPS_FIX_MAX_AGE;
+  _tel.setGpsFix(_fix);
+  if (_fix) {
+    _tel.setLocation(gps.location.lat(), gps.location.lng());
+    if (!hadFix)
+      setFace(FACE_HAPPY, now);
+    _noFixSince = now;
+  } else {
+    _tel.clearLocation();
+    if (now - _noFixSince > UI_SLEEPY_AFTER_MS && _face == FACE_NORMAL)
+      setFace(FACE_SLEEPY, now);
+  }
+
+  // GPS signal bars
+  int sats = gps.satellites.value();
+  if (sats >= 7)
+    _gpsBars = 4;
+  else if (sats >= 5)
+    _gpsBars = 3;
+  else if (sats >= 3)
+    _gpsBars = 2;
+  else if (sats >= 1)
+    _gpsBars = 1;
+  else
+    _gpsBars = 0;
+
+  // Face state timeouts
+  if (_face == FACE_HAPPY && now - _faceStart > UI_HAPPY_MS)
+    _face = FACE_NORMAL;
+  if (_face == FACE_SURPRISED && now - _faceStart > UI_SURPRISED_MS)
+    _face = FACE_NORMAL;
+  if (_face == FACE_SLEEPY && _fix)
+    setFace(FACE_HAPPY, now);
+
+  // Random Look Around
+  if (_face == FACE_NORMAL && !_lookActive &&
+      random(0, UI_LOOK_CHANCE) == 0) {
+    _face = FACE_LOOK;
+    _lookPhase = 0;
+    _lastLookStep = now;
+    _lookActive = true;
+  }
+  if (_face != FACE_LOOK)
+    _lookActive = false;
+
+  _frames.request();
+}
+
+void UiLogic::setWeather(int code, int isDay, bool live) {
+  _weatherCode = code;
+  _isDay = isDay;
+  _weatherLive = live;
+  _frames.request();
+}
+
+void UiLogic::save(UiState &s) const {
+  s = {_face, _weatherCode, _isDay, _lookPhase, _showDate, _eye,
+       _flash, _battBlink, _iconBlink, false, _fix, _wifi, _tel};
+}
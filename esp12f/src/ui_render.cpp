@@ -0,0 +1,382 @@
+#include "ui_render.h"
+#include "Org_01.h"
+#include "text_blit.h"
+
+// UI Bitmaps
+
+static const unsigned char PROGMEM image_Pin_star_bits[] = {
+    0x92, 0x54, 0x38, 0xfe, 0x38, 0x54, 0x92};
+static const unsigned char PROGMEM image_weather_humidity_bits[] = {
+    0x04, 0x00, 0x04, 0x00, 0x0c, 0x00, 0x0e, 0x00, 0x1e, 0x00, 0x1f,
+    0x00, 0x3f, 0x80, 0x3f, 0x80, 0x7e, 0xc0, 0x7f, 0x40, 0xff, 0x60,
+    0xff, 0xe0, 0x7f, 0xc0, 0x7f, 0xc0, 0x3f, 0x80, 0x0f, 0x00};
+static const unsigned char PROGMEM image_weather_temperature_bits[] = {
+    0x1c, 0x00, 0x22, 0x02, 0x2b, 0x05, 0x2a, 0x02, 0x2b, 0x38, 0x2a,
+    0x60, 0x2b, 0x40, 0x2a, 0x40, 0x2a, 0x60, 0x49, 0x38, 0x9c, 0x80,
+    0xae, 0x80, 0xbe, 0x80, 0x9c, 0x80, 0x41, 0x00, 0x3e, 0x00};
+static const unsigned char PROGMEM image_passport_left_bits[] = {
+    0x3c, 0x40, 0x98, 0xa4, 0xa4, 0x98, 0x80, 0x80, 0xa0, 0x90, 0x88, 0xa4,
+    0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4, 0x90, 0x88, 0xa4,
+    0x90, 0x88, 0x84, 0x80, 0x40, 0x60, 0x70, 0x78, 0x7c, 0x5c, 0x4c, 0x4c,
+    0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c};
+static const unsigned char PROGMEM image_passport_left__copy__bits[] = {
+    0xf0, 0x08, 0x64, 0x94, 0x94, 0x64, 0x04, 0x04, 0x14, 0x24, 0x44, 0x94,
+    0x24, 0x44, 0x94, 0x24, 0x44, 0x94, 0x24, 0x44, 0x94, 0x24, 0x44, 0x94,
+    0x24, 0x44, 0x84, 0x04, 0x08, 0x18, 0x38, 0x78, 0xf8, 0xe8, 0xc8, 0xc8,
+    0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8};
+static const unsigned char PROGMEM image_clock_alarm_bits[] = {
+    0x79, 0x3c, 0xb3, 0x9a, 0xed, 0x6e, 0xd0, 0x16, 0xa0, 0x0a, 0x41,
+    0x04, 0x41, 0x04, 0x81, 0x02, 0xc1, 0x06, 0x82, 0x02, 0x44, 0x04,
+    0x48, 0x04, 0x20, 0x08, 0x10, 0x10, 0x2d, 0x68, 0x43, 0x84};
+static const unsigned char PROGMEM image_calendar_bits[] = {
+    0x09, 0x20, 0x76, 0xdc, 0xff, 0xfe, 0xff, 0xfe, 0x80, 0x02, 0x86,
+    0xda, 0x86, 0xda, 0x80, 0x02, 0xb6, 0xda, 0xb6, 0xda, 0x80, 0x02,
+    0xb6, 0xc2, 0xb6, 0xc2, 0x80, 0x02, 0x7f, 0xfc, 0x00, 0x00};
+static const unsigned char PROGMEM image_earth_bits[] = {
+    0x07, 0xc0, 0x1e, 0x70, 0x27, 0xf8, 0x61, 0xe4, 0x43, 0xe4, 0x87,
+    0xca, 0x9f, 0xf6, 0xdf, 0x82, 0xdf, 0x82, 0xe3, 0xc2, 0x61, 0xf4,
+    0x70, 0xf4, 0x31, 0xf8, 0x1b, 0xf0, 0x07, 0xc0, 0x00, 0x00};
+static const unsigned char PROGMEM image_passport_left__copy___copy__bits[] = {
+    0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c,
+    0x5c, 0x7c, 0x78, 0x70, 0x60, 0x40, 0x80, 0x84, 0x88, 0x90, 0xa4, 0x88,
+    0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88, 0x90, 0xa4, 0x88,
+    0x90, 0xa0, 0x80, 0x80, 0x98, 0xa4, 0xa4, 0x98, 0x40, 0x3c};
+static const unsigned char PROGMEM image_weather_sun_bits[] = {
+    0x01, 0x00, 0x21, 0x08, 0x10, 0x10, 0x03, 0x80, 0x8c, 0x62, 0x48,
+    0x24, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x48, 0x24, 0x8c, 0x62,
+    0x03, 0x80, 0x10, 0x10, 0x21, 0x08, 0x01, 0x00, 0x00, 0x00};
+static const unsigned char PROGMEM image_weather_cloud_rain_bits[] = {
+    0x00, 0x00, 0x00, 0x07, 0xc0, 0x00, 0x08, 0x20, 0x00, 0x10, 0x10, 0x00,
+    0x30, 0x08, 0x00, 0x40, 0x0e, 0x00, 0x80, 0x01, 0x00, 0x80, 0x00, 0x80,
+    0x40, 0x00, 0x80, 0x3f, 0xff, 0x00, 0x01, 0x10, 0x00, 0x22, 0x22, 0x00,
+    0x44, 0x84, 0x00, 0x91, 0x28, 0x00, 0x22, 0x40, 0x00, 0x00, 0x80, 0x00};
+static const unsigned char PROGMEM image_weather_cloud_lightning_bolt_bits[] = {
+    0x00, 0x00, 0x00, 0x07, 0xc0, 0x00, 0x08, 0x20, 0x00, 0x10, 0x10, 0x00,
+    0x30, 0x08, 0x00, 0x40, 0x0e, 0x00, 0x80, 0x81, 0x00, 0x81, 0x00, 0x80,
+    0x43, 0x00, 0x80, 0x26, 0x3f, 0x00, 0x0f, 0x80, 0x00, 0x01, 0x80, 0x00,
+    0x03, 0x00, 0x00, 0x02, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00};
+static const unsigned char PROGMEM image_satellite_dish_bits[] = {
+    0x00, 0x00, 0x00, 0x78, 0x30, 0x04, 0x2c, 0x32, 0x63, 0x0a, 0xa8,
+    0xea, 0x92, 0xa2, 0x90, 0xe0, 0x89, 0x10, 0x8a, 0x48, 0x44, 0x08,
+    0x43, 0x24, 0x20, 0xc4, 0x30, 0x3c, 0x0c, 0x10, 0x03, 0xe0};
+static const unsigned char PROGMEM image_weather_cloud_sunny_bits[] = {
+    0x00, 0x20, 0x00, 0x02, 0x02, 0x00, 0x00, 0x70, 0x00, 0x01, 0x8c, 0x00,
+    0x09, 0x04, 0x80, 0x02, 0x02, 0x00, 0x02, 0x02, 0x00, 0x07, 0x82, 0x00,
+    0x08, 0x44, 0x80, 0x10, 0x2c, 0x00, 0x30, 0x30, 0x00, 0x60, 0x1e, 0x00,
+    0x80, 0x03, 0x00, 0x80, 0x01, 0x00, 0x80, 0x01, 0x00, 0x7f, 0xfe, 0x00};
+static const unsigned char PROGMEM image_weather_wind_bits[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x03, 0x88, 0x04, 0x44, 0x04,
+    0x44, 0x00, 0x44, 0x00, 0x88, 0xff, 0x32, 0x00, 0x00, 0xad, 0x82,
+    0x00, 0x60, 0x00, 0x10, 0x00, 0x10, 0x01, 0x20, 0x00, 0xc0};
+static const unsigned char PROGMEM image_Bluetooth_Idle_bits[] = {
+    0x20, 0xb0, 0x68, 0x30, 0x30, 0x68, 0xb0, 0x20};
+static const unsigned char PROGMEM image_BLE_beacon_bits[] = {
+    0x44, 0x92, 0xaa, 0x92, 0x54, 0x10, 0x10, 0x7c};
+static const unsigned char PROGMEM
+    image_passport_left__copy___copy___copy__bits[] = {
+        0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8, 0xc8,
+        0xe8, 0xf8, 0x78, 0x38, 0x18, 0x08, 0x04, 0x84, 0x44, 0x24, 0x94, 0x44,
+        0x24, 0x94, 0x44, 0x24, 0x94, 0x44, 0x24, 0x94, 0x44, 0x24, 0x94, 0x44,
+        0x24, 0x14, 0x04, 0x04, 0x64, 0x94, 0x94, 0x64, 0x08, 0xf0};
+static const unsigned char PROGMEM image_mouth_bits[] = {0x82, 0x82, 0x82, 0x44,
+                                                         0x38};
+static const unsigned char PROGMEM image_Battery_bits[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f,
+    0xf0, 0x10, 0x08, 0x32, 0xa8, 0x32, 0xa8, 0x10, 0x08, 0x0f, 0xf0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+static const unsigned char PROGMEM image_device_sleep_mode_black_bits[] = {
+    0x04, 0x00, 0x1c, 0x0e, 0x38, 0x02, 0x78, 0x04, 0x71, 0xee, 0xf0,
+    0x40, 0xf0, 0x80, 0xf1, 0xe0, 0xf8, 0x00, 0xf8, 0x06, 0x7e, 0x1c,
+    0x7f, 0xfc, 0x3f, 0xf8, 0x1f, 0xf0, 0x07, 0xc0, 0x00, 0x00};
+
+UiRenderer::UiRenderer(CountingSSD1306 &display)
+    : _display(display), _backgroundValid(false), _atlas(UI_GLYPH_ATLAS) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+// Helper: Draw animated face
+void UiRenderer::drawFace(const UiState &s) {
+  int eyeLX = 54, eyeRX = 76, eyeY = 6;
+
+  // Adjust eye position for LOOK animation
+  if (s.face == FACE_LOOK) {
+    int offset = 0;
+    if (s.lookPhase == 1)
+      offset = -3; // look left
+    else if (s.lookPhase == 3)
+      offset = 3; // look right
+    eyeLX += offset;
+    eyeRX += offset;
+  }
+
+  switch (s.face) {
+  case FACE_HAPPY:
+    // ^  ^ eyes (arc shapes)
+    _display.drawLine(eyeLX - 3, eyeY + 1, eyeLX, eyeY - 2, 1);
+    _display.drawLine(eyeLX, eyeY - 2, eyeLX + 3, eyeY + 1, 1);
+    _display.drawLine(eyeRX - 3, eyeY + 1, eyeRX, eyeY - 2, 1);
+    _display.drawLine(eyeRX, eyeY - 2, eyeRX + 3, eyeY + 1, 1);
+    // Big smile
+    _display.drawLine(60, 12, 63, 15, 1);
+    _display.drawLine(63, 15, 67, 15, 1);
+    _display.drawLine(67, 15, 70, 12, 1);
+    break;
+
+  case FACE_SLEEPY:
+    // Half-closed eyes (lines lower)
+    _display.drawLine(eyeLX - 3, eyeY + 2, eyeLX + 3, eyeY + 2, 1);
+    _display.drawLine(eyeLX - 2, eyeY + 1, eyeLX + 2, eyeY + 1, 1);
+    _display.drawLine(eyeRX - 3, eyeY + 2, eyeRX + 3, eyeY + 2, 1);
+    _display.drawLine(eyeRX - 2, eyeY + 1, eyeRX + 2, eyeY + 1, 1);
+    // Small flat mouth
+    _display.drawLine(62, 13, 68, 13, 1);
+    // "z z z" bubble (colour set here too: the text below comes later, and
+    // the display starts out with none that draws)
+    _display.setFont(NULL);
+    _display.setTextColor(1);
+    _display.setTextSize(1);
+    _display.setCursor(80, 0);
+    _display.print("z");
+    if (s.flashState) {
+      _display.setCursor(85, 0);
+      _display.print("z");
+    }
+    break;
+
+  case FACE_SURPRISED:
+    // Big round eyes
+    _display.drawCircle(eyeLX, eyeY, 4, 1);
+    _display.fillCircle(eyeLX, eyeY, 2, 1);
+    _display.drawCircle(eyeRX, eyeY, 4, 1);
+    _display.fillCircle(eyeRX, eyeY, 2, 1);
+    // Small "O" mouth
+    _display.drawCircle(65, 13, 2, 1);
+    break;
+
+  case FACE_LOOK:
+  case FACE_NORMAL:
+  default:
+    // Normal eyes with blink
+    if (s.eyeState) {
+      _display.fillCircle(eyeLX, eyeY, 3, 1);
+      _display.fillCircle(eyeRX, eyeY, 3, 1);
+    } else {
+      _display.drawLine(eyeLX - 3, eyeY, eyeLX + 3, eyeY, 1);
+      _display.drawLine(eyeRX - 3, eyeY, eyeRX + 3, eyeY, 1);
+    }
+    // Normal mouth
+    _display.drawBitmap(62, 10, image_mouth_bits, 7, 5, 1);
+    break;
+  }
+}
+
+// Parts of the frame that never change after boot
+void UiRenderer::drawStatic() {
+  // weather_humidity
+  _display.drawBitmap(9, 45, image_weather_humidity_bits, 11, 16, 1);
+
+  // weather_temperature
+  _display.drawBitmap(9, 24, image_weather_temperature_bits, 16, 16, 1);
+
+  // passport_borders
+  _display.drawBitmap(0, 18, image_passport_left_bits, 6, 46, 1);
+  _display.drawBitmap(122, 18, image_passport_left__copy__bits, 6, 46, 1);
+  _display.drawBitmap(0, -29, image_passport_left__copy___copy__bits, 6, 46,
+                      1);
+  _display.drawBitmap(122, -29, image_passport_left__copy___copy___copy__bits,
+                      6, 46, 1);
+
+  // Separator line
+  _display.drawLine(5, 18, 122, 18, 1);
+}
+
+void UiRenderer::drawBackground() {
+#if UI_STATIC_BACKGROUND
+  if (!_backgroundValid) {
+    _display.clearDisplay();
+    drawStatic();
+    memcpy(_background, _display.getBuffer(), sizeof(_background));
+    _backgroundValid = true;
+    return;
+  }
+  memcpy(_display.getBuffer(), _background, sizeof(_background));
+#else
+  _display.clearDisplay();
+  drawStatic();
+#endif
+}
+
+// Prints the two characters at s (e.g. "HH" out of "HH:MM:SS")
+void UiRenderer::printPair(const char *s) {
+  _display.write(s[0]);
+  _display.write(s[1]);
+}
+
+// Size-2 text at (x, y): atlas blit or the GFX path it replaces
+int16_t UiRenderer::printBig(int16_t x, int16_t y, const char *s, uint8_t n) {
+  if (_atlas)
+    return blitText(_display, x, y, s, n);
+  _display.setCursor(x, y);
+  for (; n && *s; n--, s++)
+    _display.write(*s);
+  return _display.getCursorX();
+}
+
+void UiRenderer::render(const UiState &s) {
+  unsigned long drawStart = micros();
+  memset(&_display.ops, 0, sizeof(_display.ops));
+  drawBackground();
+
+  // Clock / Calendar (alternates)
+  if (s.showDate) {
+    _display.drawBitmap(65, 24, image_calendar_bits, 15, 16, 1);
+  } else {
+    _display.drawBitmap(65, 24, image_clock_alarm_bits, 15, 16, 1);
+  }
+
+  if (s.gpsFix) {
+    _display.drawBitmap(65, 45, image_earth_bits, 15, 16, 1);
+  } else {
+    if (s.flashState) {
+      _display.drawBitmap(67, 44, image_satellite_dish_bits, 15, 16, 1);
+    }
+  }
+
+  // Bluetooth Icon (blinks when WiFi not connected)
+  // if (wifiConnected || iconBlinkState) {
+  //  display.drawBitmap(115, 0, image_Bluetooth_Idle_bits, 5, 8, 1);
+  //}
+  // Pin_star (LED indicator - only visible when LED is on)
+  if (s.led) {
+    _display.drawBitmap(104, 0, image_Pin_star_bits, 7, 7, 1);
+  }
+  // BLE Beacon (blinks when WiFi not connected)
+  if (s.wifi || s.iconBlink) {
+    _display.drawBitmap(113, 0, image_BLE_beacon_bits, 7, 8, 1);
+  }
+
+  // Battery (blink speed depends on level)
+  if (s.battBlink) {
+    _display.drawBitmap(106, 5, image_Battery_bits, 16, 16, 1);
+  }
+
+  // Dynamic Weather Icon
+  // Dynamic Weather Icon & Night Mode
+  if (s.isDay == 0) {
+    // Night Mode (Sleep Icon)
+    _display.drawBitmap(8, 0, image_device_sleep_mode_black_bits, 16, 16, 1);
+  } else {
+    // Day Mode - Weather Condition
+    if (s.weatherCode >= 95) { // Thunderstorm
+      _display.drawBitmap(8, 0, image_weather_cloud_lightning_bolt_bits, 17,
+                          16, 1);
+    } else if (s.weatherCode >= 51) { // Rain / Drizzle
+      _display.drawBitmap(8, 0, image_weather_cloud_rain_bits, 17, 16, 1);
+    } else if (s.weatherCode >= 1 &&
+               s.weatherCode <= 3) { // Cloud/Partly Cloudy
+      _display.drawBitmap(8, 0, image_weather_cloud_sunny_bits, 17, 16, 1);
+    } else if (s.weatherCode == 0) { // Clear Sky
+      _display.drawBitmap(8, 0, image_weather_sun_bits, 15, 16, 1);
+    } else {
+      // Default or unknown (e.g. Fog 45/48) -> Sunny Cloud as fallback
+      _display.drawBitmap(8, 0, image_weather_cloud_sunny_bits, 17, 16, 1);
+    }
+  }
+
+  // Animated Face
+  drawFace(s);
+
+  // Text Values
+  unsigned long textStart = micros();
+  const Telemetry &tel = s.tel;
+  _display.setFont(&Org_01);
+  _display.setTextColor(1);
+  _display.setTextSize(2);
+  _display.setTextWrap(false);
+
+  // Humidity Value
+  printBig(printBig(27, 56, tel.hum), 56, "%");
+
+  // Temperature Value
+  printBig(27, 35, tel.temp);
+
+  // Date / Time display (alternates every 3s)
+  if (s.showDate) {
+    // Date: day (big), month (small top), year (small bottom)
+    _display.setTextSize(2);
+    printBig(86, 35, tel.date, 2);
+
+    _display.setTextSize(1);
+    _display.setCursor(109, 30);
+    printPair(tel.date + 3);
+
+    _display.setCursor(109, 37);
+    printPair(tel.date + 6);
+  } else {
+    // Time: hours (big), minutes (small top), seconds (small bottom)
+    _display.setTextSize(2);
+    printBig(86, 35, tel.time, 2);
+
+    _display.setTextSize(1);
+    _display.setCursor(109, 30);
+    printPair(tel.time + 3);
+
+    _display.setCursor(109, 37);
+    printPair(tel.time + 6);
+  }
+
+  _display.setTextSize(1);
+
+  // Latitude
+  _display.setCursor(84, 49);
+  _display.print(tel.lat);
+
+  // Longitude
+  _display.setCursor(84, 59);
+  _display.print(tel.lon);
+
+  _stats.textMicros = micros() - textStart;
+  if (_stats.textMicros > _stats.maxTextMicros)
+    _stats.maxTextMicros = _stats.textMicros;
+
+  _stats.micros = micros() - drawStart;
+  if (_stats.micros > _stats.maxMicros)
+    _stats.maxMicros = _stats.micros;
+  _stats.ops = _display.ops;
+}
+
+void UiRenderer::snapshot(const UiState &s, UiRenderStats &stats) {
+  UiRenderStats live = _stats;
+  render(s);
+  stats = _stats;
+  _stats = live;
+}
+
+// Page-major SSD1306 buffer -> row-major PBM
+void UiRenderer::pbmPage(uint8_t page, uint8_t rows[UI_PBM_PAGE]) const {
+  const uint8_t *buf = _display.getBuffer();
+  memset(rows, 0, UI_PBM_PAGE);
+  for (uint8_t x = 0; x < UI_WIDTH; x++) {
+    uint8_t col = buf[page * UI_WIDTH + x];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      if (col & (1 << bit))
+        rows[bit * UI_WIDTH / 8 + x / 8] |= 0x80 >> (x & 7);
+    }
+  }
+}
+
+void UiRenderer::fixture(UiState &s) {
+  s.tel.begin();
+  s.tel.setTemp(23);
+  s.tel.setHum(45);
+  s.tel.setTime(12, 34, 56);
+  s.tel.setDate(9, 10, 25);
+  s.tel.setLocation(-23.55, -46.63);
+  s.lookPhase = 1;
+  s.eyeState = true;
+  s.flashState = true;
+  s.battBlink = s.iconBlink = true;
+  s.led = true;
+  s.gpsFix = s.wifi = true;
+}
@@ -0,0 +1,83 @@
+#include "weather_cache.h"
+#include <EEPROM.h>
+
+void WeatherCache::begin(int addr) {
+  _addr = addr;
+  EEPROM.get(_addr, _magic);
+  EEPROM.get(_addr + sizeof(_magic), _entries);
+  if (_magic != WEATHER_CACHE_MAGIC) {
+    _magic = WEATHER_CACHE_MAGIC;
+    memset(_entries, 0, sizeof(_entries));
+  }
+}
+
+const WeatherCacheEntry *WeatherCache::lookup(uint32_t cell) const {
+  for (uint8_t i = 0; i < WEATHER_CACHE_ENTRIES; i++) {
+    if (_entries[i].used && _entries[i].cell == cell)
+      return &_entries[i];
+  }
+  return nullptr;
+}
+
+const WeatherCacheEntry *WeatherCache::latest() const {
+  const WeatherCacheEntry *best = nullptr;
+  for (uint8_t i = 0; i < WEATHER_CACHE_ENTRIES; i++) {
+    if (_entries[i].used && (!best || _entries[i].fetchedAt > best->fetchedAt))
+      best = &_entries[i];
+  }
+  return best;
+}
+
+void WeatherCache::store(uint32_t cell, int code, int isDay, uint32_t epoch) {
+  WeatherCacheEntry *slot = nullptr;
+  for (uint8_t i = 0; i < WEATHER_CACHE_ENTRIES && !slot; i++) {
+    if (_entries[i].used && _entries[i].cell == cell)
+      slot = &_entries[i];
+  }
+
+  if (slot && slot->code == code && slot->isDay == isDay &&
+      epoch - slot->fetchedAt < WEATHER_CACHE_REFRESH_S) {
+    return; // nothing worth a flash write
+  }
+
+  if (!slot) {
+    // Free entry, else the oldest one
+    slot = &_entries[0];
+    for (uint8_t i = 0; i < WEATHER_CACHE_ENTRIES; i++) {
+      if (!_entries[i].used) {
+        slot = &_entries[i];
+        break;
+      }
+      if (_entries[i].fetchedAt < slot->fetchedAt)
+        slot = &_entries[i];
+    }
+  }
+
+  slot->cell = cell;
+  slot->fetchedAt = epoch;
+  slot->code = code;
+  slot->isDay = isDay;
+  slot->used = 1;
+
+  EEPROM.put(_addr, _magic);
+  EEPROM.put(_addr + sizeof(_magic), _entries);
+  EEPROM.commit();
+}
+
+uint32_t WeatherCache::cellFor(double lat, double lon) {
+  uint32_t row = (uint32_t)((lat + 90.0) / WEATHER_CELL_DEG);
+  uint32_t col = (uint32_t)((lon + 180.0) / WEATHER_CELL_DEG);
+  return row * (uint32_t)(360.0 / WEATHER_CELL_DEG + 1) + col + 1; // 0 = none
+}
+
+// Days-from-civil (proleptic Gregorian), valid for the GPS era
+uint32_t WeatherCache::epochFrom(uint16_t year, uint8_t month, uint8_t day,
+                                 uint8_t hour, uint8_t minute, uint8_t second) {
+  int y = year - (month <= 2);
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int32_t days = era * 146097 + doe - 719468;
+  return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
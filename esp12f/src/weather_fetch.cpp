@@ -0,0 +1,255 @@
+#include "weather_fetch.h"
+#include "debug_log.h"
+#include "peak_allocator.h"
+#include <ArduinoJson.h>
+
+extern "C" {
+#include <lwip/dns.h>
+}
+
+#define WX_TCP_ESTABLISHED 4 // lwIP tcp_state
+
+static void weatherDnsFound(const char *name, const ip_addr_t *ipaddr,
+                            void *arg) {
+  WeatherFetch *wx = static_cast<WeatherFetch *>(arg);
+  if (ipaddr)
+    wx->dnsResult(true, (uint32_t)IPAddress(ipaddr));
+  else
+    wx->dnsResult(false, 0);
+}
+
+WeatherFetch::WeatherFetch()
+    : _phase(WX_IDLE), _phaseStart(0), _dnsState(0), _dnsAddr(0),
+      _lineLen(0), _statusSeen(false), _status(0), _contentLength(-1),
+      _weatherCode(-1), _isDay(1) {
+  _path[0] = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+const char *WeatherFetch::phaseName(uint8_t phase) {
+  static const char *const names[] = {"resolve", "connect", "send", "headers",
+                                      "body"};
+  return phase < WX_PHASES ? names[phase] : "idle";
+}
+
+void WeatherFetch::dnsResult(bool ok, uint32_t addr) {
+  if (_phase != WX_RESOLVE)
+    return; // late answer for a fetch that already timed out
+  _dnsAddr = addr;
+  _dnsState = ok ? 1 : 2;
+}
+
+bool WeatherFetch::start(double lat, double lon) {
+  if (busy())
+    return false;
+
+  snprintf(_path, sizeof(_path),
+           "/v1/forecast?latitude=%.4f&longitude=%.4f"
+           "&current=is_day,weather_code&timezone=auto",
+           lat, lon);
+
+  _stats.started++;
+  memset(_stats.lastMs, 0, sizeof(_stats.lastMs));
+  _lineLen = 0;
+  _statusSeen = false;
+  _status = 0;
+  _contentLength = -1;
+  _phase = WX_RESOLVE;
+  _phaseStart = millis();
+
+  // IP literal (local stand-in) or a cached name resolves immediately
+  if (_ip.fromString(WEATHER_HOST)) {
+    _dnsState = 1;
+    _dnsAddr = (uint32_t)_ip;
+    return true;
+  }
+  _dnsState = 0;
+  ip_addr_t addr;
+  err_t err = dns_gethostbyname(WEATHER_HOST, &addr, weatherDnsFound, this);
+  if (err == ERR_OK) {
+    _dnsAddr = (uint32_t)IPAddress(&addr);
+    _dnsState = 1;
+  } else if (err != ERR_INPROGRESS) {
+    _dnsState = 2;
+  }
+  return true;
+}
+
+void WeatherFetch::enter(WeatherPhase next, unsigned long now) {
+  if (_phase < WX_PHASES) {
+    uint16_t ms = now - _phaseStart;
+    _stats.lastMs[_phase] = ms;
+    if (ms > _stats.maxMs[_phase])
+      _stats.maxMs[_phase] = ms;
+  }
+  _phase = next;
+  _phaseStart = now;
+}
+
+void WeatherFetch::fail(const char *why) {
+  LOG.printf("Weather: %s failed (%s)\n", phaseName(_phase), why);
+  _connect.cancel();
+  _client.stop();
+  enter(WX_IDLE, millis());
+  _stats.failed++;
+}
+
+// Consumes header bytes as they arrive. True once the blank line is seen.
+bool WeatherFetch::readHeaders(unsigned long now) {
+  while (_client.available() > 0) {
+    char c = _client.read();
+    if (c == '\r')
+      continue;
+    if (c != '\n') {
+      if (_lineLen < sizeof(_line) - 1)
+        _line[_lineLen++] = c; // long headers are truncated, which is fine
+      continue;
+    }
+    _line[_lineLen] = 0;
+    if (_lineLen == 0)
+      return true; // end of headers
+    if (!_statusSeen) {
+      // "HTTP/1.x 200 OK"
+      const char *sp = strchr(_line, ' ');
+      _status = sp ? atoi(sp + 1) : 0;
+      _statusSeen = true;
+    } else if (strncasecmp(_line, "Content-Length:", 15) == 0) {
+      _contentLength = atol(_line + 15);
+    }
+    _lineLen = 0;
+  }
+  return false;
+}
+
+// Reads the buffered body from the socket through a filter that keeps only
+// current.is_day and current.weather_code, so the document stays a few
+// dozen bytes. The whole body is already there: a read never waits, and a
+// truncated one fails at once instead of after a timeout.
+bool WeatherFetch::parseBody() {
+  static JsonDocument filter;
+  if (filter.isNull()) {
+    filter["current"]["is_day"] = true;
+    filter["current"]["weather_code"] = true;
+  }
+
+  _client.setTimeout(0);
+  unsigned long t0 = micros();
+
+  PeakAllocator alloc;
+  JsonDocument doc(&alloc);
+  DeserializationError error =
+      deserializeJson(doc, _client, DeserializationOption::Filter(filter));
+
+  _stats.parseMicros = micros() - t0;
+  _stats.parseHeap = alloc.peak();
+  if (_stats.parseHeap > _stats.maxParseHeap)
+    _stats.maxParseHeap = _stats.parseHeap;
+
+  if (error) {
+    LOG.print("JSON Error: ");
+    LOG.println(error.c_str());
+    return false;
+  }
+  _isDay = doc["current"]["is_day"];
+  _weatherCode = doc["current"]["weather_code"];
+  return true;
+}
+
+bool WeatherFetch::loop(unsigned long now) {
+  unsigned long elapsed = now - _phaseStart;
+
+  switch (_phase) {
+  case WX_IDLE:
+    return false;
+
+  case WX_RESOLVE:
+    if (_dnsState == 1) {
+      _ip = IPAddress(_dnsAddr);
+      enter(WX_CONNECT, now);
+      if (!_connect.begin(_ip, WEATHER_PORT))
+        fail("no socket");
+    } else if (_dnsState == 2) {
+      fail("no address");
+    } else if (elapsed > WEATHER_RESOLVE_TIMEOUT) {
+      fail("timeout");
+    }
+    return false;
+
+  case WX_CONNECT:
+    switch (_connect.poll()) {
+    case TCP_CONNECT_DONE:
+      _connect.take(_client);
+      enter(WX_SEND, now);
+      break;
+    case TCP_CONNECT_FAILED:
+      fail("refused");
+      break;
+    default:
+      if (elapsed > WEATHER_CONNECT_TIMEOUT)
+        fail("timeout");
+    }
+    return false;
+
+  case WX_SEND: {
+    // HTTP/1.0: no chunked encoding, server closes when done
+    char req[224];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n",
+                     _path, WEATHER_HOST);
+    if (n <= 0 || n >= (int)sizeof(req) ||
+        _client.write((const uint8_t *)req, n) != (size_t)n) {
+      fail("write");
+      return false;
+    }
+    enter(WX_HEADERS, millis());
+    return false;
+  }
+
+  case WX_HEADERS:
+    if (readHeaders(now)) {
+      if (_status != 200) {
+        fail("HTTP status");
+        return false;
+      }
+      enter(WX_BODY, now);
+    } else if (elapsed > WEATHER_HEADERS_TIMEOUT) {
+      fail("timeout");
+    }
+    return false;
+
+  case WX_BODY: {
+    // Parse once the whole body is buffered, so the parser never waits. A
+    // body larger than the TCP window could never be fully buffered, so
+    // anything over WEATHER_BODY_MAX fails rather than being waited for.
+    int buffered = _client.available();
+    if (_contentLength > WEATHER_BODY_MAX || buffered > WEATHER_BODY_MAX) {
+      fail("too large");
+      return false;
+    }
+    bool complete = _contentLength >= 0
+                        ? buffered >= _contentLength
+                        : _client.status() != WX_TCP_ESTABLISHED;
+    if (!complete) {
+      if (elapsed > WEATHER_BODY_TIMEOUT)
+        fail("timeout");
+      return false;
+    }
+    if (!parseBody()) {
+      fail("parse");
+      return false;
+    }
+    _client.stop();
+    enter(WX_IDLE, millis());
+    _stats.ok++;
+    LOG.printf("Weather Update: Code=%d isDay=%d (dns %u, connect %u, "
+               "send %u, headers %u, body %u ms; parse %luus %luB)\n",
+               _weatherCode, _isDay, _stats.lastMs[WX_RESOLVE],
+               _stats.lastMs[WX_CONNECT], _stats.lastMs[WX_SEND],
+               _stats.lastMs[WX_HEADERS], _stats.lastMs[WX_BODY],
+               (unsigned long)_stats.parseMicros,
+               (unsigned long)_stats.parseHeap);
+    return true;
+  }
+  }
+  return false;
+}
@@ -0,0 +1,139 @@
+// DhtReader::decode() on edge lists built the way onEdge() records them:
+// the cycle counter with bit 0 replaced by the line level after the edge.
+// Timings are the DHT11 datasheet's: 80 us response low and high, then per
+// bit a 50 us low and a 26-28 us (0) or 70 us (1) high.
+
+#include "dht_reader.h"
+#include <unity.h>
+#include <vector>
+
+#define MHZ 80
+
+typedef std::vector<uint32_t> Edges;
+
+struct Frame {
+  Edges edges;
+  uint32_t at; // cycle counter
+  explicit Frame(uint32_t start = 1000000) : at(start & ~1UL) {}
+  void edge(uint32_t afterUs, bool level) {
+    at += afterUs * MHZ;
+    edges.push_back((at & ~1UL) | level);
+  }
+};
+
+// Host release, sensor response, 40 bits, release; `oneUs`/`zeroUs` are
+// the high-pulse widths, `ringing` short pulses follow the release
+static Frame frame(const uint8_t data[5], uint32_t zeroUs = 27,
+                   uint32_t oneUs = 70, uint32_t start = 1000000,
+                   int ringing = 0) {
+  Frame f(start);
+  f.edge(0, 1); // host releases the line
+  for (int i = 0; i < ringing; i++) {
+    f.edge(2, 0);
+    f.edge(2, 1);
+  }
+  f.edge(30, 0); // sensor pulls it low
+  f.edge(80, 1);
+  f.edge(80, 0);
+  for (int bit = 0; bit < 40; bit++) {
+    f.edge(50, 1);
+    f.edge(data[bit / 8] & (0x80 >> bit % 8) ? oneUs : zeroUs, 0);
+  }
+  f.edge(50, 1); // sensor lets go
+  return f;
+}
+
+static bool decode(const Edges &e, uint8_t out[5]) {
+  return DhtReader::decode(e.data(), e.size(), MHZ, out);
+}
+
+static const uint8_t READING[5] = {45, 0, 23, 4, 72}; // 45% 23.4 C
+
+void setUp() {}
+void tearDown() {}
+
+void test_valid_frame() {
+  Frame f = frame(READING);
+  TEST_ASSERT_EQUAL(85, f.edges.size());
+  TEST_ASSERT_LESS_OR_EQUAL(DHT_MAX_EDGES, f.edges.size());
+  uint8_t out[5];
+  TEST_ASSERT_TRUE(decode(f.edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(READING, out, 5);
+}
+
+void test_all_zero_and_all_one_bytes() {
+  const uint8_t zeros[5] = {0, 0, 0, 0, 0};
+  const uint8_t ones[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+  uint8_t out[5];
+  TEST_ASSERT_TRUE(decode(frame(zeros).edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(zeros, out, 5);
+  TEST_ASSERT_TRUE(decode(frame(ones).edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ones, out, 5);
+}
+
+void test_checksum_error() {
+  uint8_t bad[5];
+  memcpy(bad, READING, 5);
+  bad[4] ^= 0x01;
+  uint8_t out[5];
+  TEST_ASSERT_FALSE(decode(frame(bad).edges, out));
+}
+
+void test_missing_edges() {
+  Edges e = frame(READING).edges;
+  uint8_t out[5];
+  // Capture window closed early: the last bits never arrived
+  Edges cut(e.begin(), e.end() - 10);
+  TEST_ASSERT_FALSE(decode(cut, out));
+  // An interrupt missed mid-frame merges two highs into one
+  Edges gap = e;
+  gap.erase(gap.begin() + 40, gap.begin() + 42);
+  TEST_ASSERT_FALSE(decode(gap, out));
+  TEST_ASSERT_FALSE(decode(Edges(), out));
+  TEST_ASSERT_FALSE(decode(Edges(1, 1), out));
+}
+
+void test_extra_leading_edges_are_skipped() {
+  // Ringing when the host releases the line: more short highs in front
+  Frame f = frame(READING, 27, 70, 1000000, 3);
+  TEST_ASSERT_EQUAL(91, f.edges.size());
+  uint8_t out[5];
+  TEST_ASSERT_TRUE(decode(f.edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(READING, out, 5);
+}
+
+void test_one_threshold_is_50us() {
+  const uint8_t ones[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+  uint8_t out[5];
+  const uint8_t zeros[5] = {0, 0, 0, 0, 0};
+  // Every bit in `ones` but the checksum's last two is a 1: 50 us highs
+  // read as 0 (a frame of zeros, which checks out), 51 us highs as 1
+  TEST_ASSERT_TRUE(decode(frame(ones, 27, DHT_ONE_US).edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(zeros, out, 5);
+  TEST_ASSERT_TRUE(decode(frame(ones, 27, DHT_ONE_US + 1).edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ones, out, 5);
+  // A slow sensor's long zero still reads as 0 up to the threshold
+  TEST_ASSERT_TRUE(decode(frame(READING, DHT_ONE_US, 70).edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(READING, out, 5);
+}
+
+void test_cycle_counter_wraps_mid_frame() {
+  uint8_t out[5];
+  // The 32-bit counter wraps every ~54 s at 80 MHz
+  Frame f = frame(READING, 27, 70, 0xFFFFFFFF - 2000 * MHZ);
+  TEST_ASSERT_TRUE(f.edges.back() < f.edges.front());
+  TEST_ASSERT_TRUE(decode(f.edges, out));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(READING, out, 5);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_valid_frame);
+  RUN_TEST(test_all_zero_and_all_one_bytes);
+  RUN_TEST(test_checksum_error);
+  RUN_TEST(test_missing_edges);
+  RUN_TEST(test_extra_leading_edges_are_skipped);
+  RUN_TEST(test_one_threshold_is_50us);
+  RUN_TEST(test_cycle_counter_wraps_mid_frame);
+  return UNITY_END();
+}
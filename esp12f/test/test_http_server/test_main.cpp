@@ -0,0 +1,507 @@
+// HttpServer on the host (lib/host's WiFiServer on 127.0.0.1:HTTP_TEST_PORT)
+// with the firmware's two big generated bodies: /metrics (LoopMetrics, ~8
+// KB) and /frame.pbm (1 KB), served as main.cpp serves them, a slot buffer
+// at a time, and as they used to be, written straight to the socket by the
+// handler (/metrics-blocking, /frame-blocking).
+//
+// The clients read over an emulated WiFi link: a small receive buffer and
+// LINK_BYTES every LINK_MS, so the host WiFiClient, which like lwIP takes
+// no more than WIFICLIENT_SND_BUF unacked bytes, waits for acks as the
+// device does. The load test runs POLLERS clients back to back against
+// each variant and prints how long server.loop() held the caller.
+//
+//   pio test -e native -f test_http_server
+//
+// HTTP_SERVE=<seconds> keeps serving /metrics, /frame.pbm and /data for
+// tools/http_load.py (HTTP_BLOCKING=1 for the old handlers), with the
+// server's own passes in the /metrics histograms:
+//
+//   HTTP_SERVE=40 pio test -e native -f test_http_server &
+//   python tools/http_load.py 127.0.0.1:18081 --path /metrics --seconds 30
+
+#include "http_server.h"
+#include "loop_metrics.h"
+#include "ui_render.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+#define HTTP_TEST_PORT 18081
+#define POLLERS 10
+#define LOAD_MS 3000
+#define LINK_RCVBUF 2048 // client receive window
+#define LINK_BYTES 536   // one MSS ...
+#define LINK_MS 5        // ... per 5 ms: ~100 KB/s
+
+static HttpServer server(HTTP_TEST_PORT);
+static LoopMetrics served; // what /metrics shows
+static CountingSSD1306 display(UI_WIDTH, UI_HEIGHT, &Wire, -1);
+static UiRenderer ui(display);
+
+// --- The handlers, as in main.cpp ---
+
+static size_t metricsFill(char *buf, size_t room, void *state,
+                          uint32_t &cursor) {
+  HttpChunk out(buf, room);
+  for (;;) {
+    uint16_t part = cursor & 0xFFFF;
+    bool more;
+    switch (cursor >> 16) {
+    case 0:
+      more = served.writePart(part, out);
+      break;
+    case 1:
+      more = part == 0;
+      if (more)
+        out.printf("# TYPE esp12f_http_connections_total counter\n"
+                   "esp12f_http_connections_total %lu\n",
+                   (unsigned long)server.stats().accepted);
+      break;
+    default:
+      if (*(bool *)state) {
+        served.reset();
+        *(bool *)state = false;
+      }
+      return out.length();
+    }
+    if (!more)
+      cursor = ((cursor >> 16) + 1) << 16;
+    else if (out.commit())
+      cursor++;
+    else
+      return out.length();
+  }
+}
+
+static void handleMetrics(HttpRequest &req) {
+  bool reset = req.arg("reset") == "1";
+  req.sendHeader(F("Cache-Control"), F("no-store"));
+  req.sendGenerated(200, "text/plain; version=0.0.4", metricsFill, &reset,
+                    sizeof(reset));
+}
+
+static size_t frameFill(char *buf, size_t room, void *state,
+                        uint32_t &cursor) {
+  if (cursor >= UI_HEIGHT / 8)
+    return 0;
+  size_t n = 0;
+  if (cursor == 0) {
+    n = sizeof(UI_PBM_HEADER) - 1;
+    memcpy(buf, UI_PBM_HEADER, n);
+  }
+  UiRenderStats rs;
+  ui.snapshot(*(const UiState *)state, rs);
+  for (; cursor < UI_HEIGHT / 8 && n + UI_PBM_PAGE <= room; cursor++) {
+    ui.pbmPage(cursor, (uint8_t *)buf + n);
+    n += UI_PBM_PAGE;
+  }
+  return n;
+}
+
+static void handleFrame(HttpRequest &req) {
+  UiState s = {};
+  UiRenderer::fixture(s);
+  UiRenderStats rs;
+  ui.snapshot(s, rs);
+  char v[24];
+  snprintf(v, sizeof(v), "%lu", (unsigned long)rs.micros);
+  req.sendHeader(F("X-Render-Micros"), v);
+  req.sendGenerated(200, "image/x-portable-bitmap", frameFill, &s, sizeof(s),
+                    UI_PBM_SIZE);
+}
+
+// --- The same, as they were: written by the handler, waiting on acks ---
+
+class ClientPrint : public Print {
+public:
+  explicit ClientPrint(WiFiClient &client) : _client(client), _len(0) {}
+  size_t write(uint8_t c) override {
+    _buf[_len++] = c;
+    if (_len == sizeof(_buf))
+      send();
+    return 1;
+  }
+  void send() {
+    if (_len)
+      _client.write((const uint8_t *)_buf, _len);
+    _len = 0;
+  }
+
+private:
+  WiFiClient &_client;
+  char _buf[256];
+  size_t _len;
+};
+
+static void handleMetricsBlocking(HttpRequest &req) {
+  ClientPrint out(req.client());
+  out.print(F("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+              "Cache-Control: no-store\r\nConnection: close\r\n\r\n"));
+  served.write(out);
+  out.printf("# TYPE esp12f_http_connections_total counter\n"
+             "esp12f_http_connections_total %lu\n",
+             (unsigned long)server.stats().accepted);
+  out.send();
+  req.done();
+  if (req.arg("reset") == "1")
+    served.reset();
+}
+
+static void handleFrameBlocking(HttpRequest &req) {
+  UiState s = {};
+  UiRenderer::fixture(s);
+  ui.render(s);
+  WiFiClient &client = req.client();
+  client.printf("HTTP/1.1 200 OK\r\nContent-Type: image/x-portable-bitmap\r\n"
+                "Content-Length: %u\r\nX-Render-Micros: %lu\r\n"
+                "Connection: close\r\n\r\n",
+                (unsigned)UI_PBM_SIZE, (unsigned long)ui.stats().micros);
+  client.write((const uint8_t *)UI_PBM_HEADER, sizeof(UI_PBM_HEADER) - 1);
+  uint8_t rows[UI_PBM_PAGE];
+  for (uint8_t page = 0; page < UI_HEIGHT / 8; page++) {
+    ui.pbmPage(page, rows);
+    client.write(rows, sizeof(rows));
+  }
+  req.done();
+}
+
+// Generator state over half the slot buffer: refused
+static void handleTooBig(HttpRequest &req) {
+  static const char state[HTTP_BUF_SIZE] = {};
+  req.sendGenerated(200, "text/plain", frameFill, state, sizeof(state));
+}
+
+static void handleData(HttpRequest &req) {
+  req.send(200, "application/json", "{\"temp\":24,\"hum\":61,\"fix\":true}");
+}
+
+// --- Clients ---
+
+struct Response {
+  int status = 0;
+  std::string head, body;
+  long contentLength = -1;
+};
+
+// GET over a fresh connection, read to the close; slow = the emulated link
+static bool get(const char *path, Response &res, bool slow) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (slow) {
+    int rcv = LINK_RCVBUF;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcv, sizeof(rcv));
+  }
+  timeval tv = {10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(HTTP_TEST_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+  char request[128];
+  int n = snprintf(request, sizeof(request),
+                   "GET %s HTTP/1.1\r\nHost: esp12f\r\n\r\n", path);
+  send(fd, request, n, MSG_NOSIGNAL);
+
+  std::string raw;
+  char buf[LINK_BYTES];
+  ssize_t r;
+  while ((r = recv(fd, buf, slow ? LINK_BYTES : sizeof(buf), 0)) > 0) {
+    raw.append(buf, r);
+    if (slow)
+      usleep(LINK_MS * 1000);
+  }
+  close(fd);
+  if (r < 0)
+    return false;
+
+  size_t end = raw.find("\r\n\r\n");
+  if (end == std::string::npos ||
+      sscanf(raw.c_str(), "HTTP/1.1 %d", &res.status) != 1)
+    return false;
+  res.head = raw.substr(0, end + 2);
+  res.body = raw.substr(end + 4);
+  size_t cl = res.head.find("Content-Length: ");
+  if (cl != std::string::npos)
+    res.contentLength = atol(res.head.c_str() + cl + 16);
+  return true;
+}
+
+// Complete: 200, and the whole body (Content-Length, or the metrics' end)
+static bool complete(const Response &res) {
+  if (res.status != 200)
+    return false;
+  if (res.contentLength >= 0)
+    return (size_t)res.contentLength == res.body.size();
+  return res.body.size() > 1000 &&
+         res.body.find("esp12f_http_connections_total ") != std::string::npos &&
+         res.body.back() == '\n';
+}
+
+// --- The loop ---
+
+// server.loop() until `until` is true, each call timed into passUs (and the
+// served histograms when record is set); delay(1) stands for the rest of
+// the firmware's loop()
+template <typename Until>
+static void serve(Until until, std::vector<uint32_t> *passUs = nullptr,
+                  bool record = false) {
+  uint32_t last = ESP.getCycleCount();
+  while (!until()) {
+    uint32_t c0 = ESP.getCycleCount();
+    server.loop(millis());
+    uint32_t c1 = ESP.getCycleCount();
+    if (passUs)
+      passUs->push_back((c1 - c0) / ESP.getCpuFreqMHz());
+    if (record) {
+      served.add(LS_HTTP, c1 - c0);
+      served.add(LS_LOOP, c0 - last);
+      last = c0;
+    }
+    delay(1);
+  }
+}
+
+// One GET on a client thread while the test thread runs the server
+static Response fetch(const char *path, bool slow) {
+  Response res;
+  std::atomic<bool> finished(false);
+  bool ok = false;
+  std::thread client([&] {
+    ok = get(path, res, slow);
+    finished = true;
+  });
+  serve([&] { return finished.load(); });
+  client.join();
+  TEST_ASSERT_TRUE_MESSAGE(ok, path);
+  return res;
+}
+
+static void fillHistograms() {
+  served.reset();
+  for (uint32_t i = 0; i < 5000; i++)
+    served.add((LoopSection)(i % LS_SECTIONS), (i * 7919) % 4000000);
+}
+
+static std::string expectedMetrics() {
+  struct : Print {
+    std::string s;
+    size_t write(uint8_t c) override {
+      s += (char)c;
+      return 1;
+    }
+  } out;
+  served.write(out);
+  out.printf("# TYPE esp12f_http_connections_total counter\n"
+             "esp12f_http_connections_total %lu\n",
+             (unsigned long)server.stats().accepted);
+  return out.s;
+}
+
+static std::string expectedFrame() {
+  UiState s = {};
+  UiRenderer::fixture(s);
+  ui.render(s);
+  std::string out(UI_PBM_HEADER);
+  uint8_t rows[UI_PBM_PAGE];
+  for (uint8_t page = 0; page < UI_HEIGHT / 8; page++) {
+    ui.pbmPage(page, rows);
+    out.append((const char *)rows, sizeof(rows));
+  }
+  return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_chunk_keeps_parts_whole() {
+  char buf[16];
+  HttpChunk out(buf, sizeof(buf));
+  out.print("0123456789");
+  TEST_ASSERT_TRUE(out.commit());
+  out.print("abcdefghij"); // does not fit: dropped, not cut
+  TEST_ASSERT_FALSE(out.commit());
+  TEST_ASSERT_EQUAL(10, out.length());
+  TEST_ASSERT_EQUAL_MEMORY("0123456789", buf, 10);
+}
+
+void test_metrics_parts_make_write() {
+  fillHistograms();
+  std::string whole = expectedMetrics();
+  TEST_ASSERT_GREATER_THAN(7000, whole.size());
+  Response res = fetch("/metrics", true);
+  TEST_ASSERT_EQUAL(200, res.status);
+  TEST_ASSERT_EQUAL(-1, res.contentLength); // the close ends it
+  TEST_ASSERT_TRUE(res.head.find("Cache-Control: no-store\r\n") !=
+                   std::string::npos);
+  // accepted went up by this request since expectedMetrics()
+  TEST_ASSERT_EQUAL_STRING(expectedMetrics().c_str(), res.body.c_str());
+}
+
+void test_metrics_reset_after_body() {
+  fillHistograms();
+  Response res = fetch("/metrics?reset=1", false);
+  TEST_ASSERT_TRUE(complete(res));
+  TEST_ASSERT_TRUE(res.body.find("count{section=\"loop\"} 714\n") !=
+                   std::string::npos);
+  TEST_ASSERT_EQUAL(0, served.section(LS_LOOP).count);
+}
+
+void test_frame_body() {
+  std::string frame = expectedFrame();
+  for (bool slow : {false, true}) {
+    Response res = fetch("/frame.pbm", slow);
+    TEST_ASSERT_EQUAL(200, res.status);
+    TEST_ASSERT_EQUAL(UI_PBM_SIZE, res.contentLength);
+    TEST_ASSERT_TRUE(res.head.find("X-Render-Micros: ") != std::string::npos);
+    TEST_ASSERT_TRUE(res.body == frame);
+  }
+}
+
+void test_blocking_handlers_same_bodies() {
+  fillHistograms();
+  Response res = fetch("/metrics-blocking", false);
+  TEST_ASSERT_TRUE(complete(res));
+  TEST_ASSERT_EQUAL_STRING(expectedMetrics().c_str(), res.body.c_str());
+  res = fetch("/frame-blocking", false);
+  TEST_ASSERT_TRUE(complete(res));
+  TEST_ASSERT_TRUE(res.body == expectedFrame());
+}
+
+void test_state_too_large_is_500() {
+  Response res = fetch("/too-big", false);
+  TEST_ASSERT_EQUAL(500, res.status);
+  TEST_ASSERT_EQUAL(0,
+                    res.head.find("HTTP/1.1 500 Internal Server Error\r\n"));
+  TEST_ASSERT_EQUAL(0, res.contentLength);
+}
+
+struct Load {
+  uint32_t requests = 0, errors = 0;
+  std::vector<uint32_t> passUs;
+};
+
+static uint32_t percentile(std::vector<uint32_t> v, unsigned q) {
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, v.size() * q / 100)];
+}
+
+static uint32_t stalls(const std::vector<uint32_t> &v) {
+  uint32_t n = 0;
+  for (uint32_t us : v)
+    n += us > METRICS_STALL_US;
+  return n;
+}
+
+// POLLERS clients back to back over the emulated link, half on /metrics,
+// half on /frame.pbm
+static Load load(const char *metricsPath, const char *framePath) {
+  Load run;
+  std::mutex lock;
+  std::atomic<bool> stop(false);
+  std::atomic<int> running(POLLERS);
+  std::vector<std::thread> pollers;
+  for (int i = 0; i < POLLERS; i++)
+    pollers.emplace_back([&, i] {
+      const char *path = i % 2 ? framePath : metricsPath;
+      while (!stop) {
+        Response res;
+        bool ok = get(path, res, true) && complete(res);
+        std::lock_guard<std::mutex> g(lock);
+        run.requests++;
+        run.errors += !ok;
+      }
+      running--;
+    });
+
+  unsigned long start = millis();
+  serve(
+      [&] {
+        if (millis() - start > LOAD_MS)
+          stop = true;
+        return running == 0;
+      },
+      &run.passUs);
+  for (std::thread &t : pollers)
+    t.join();
+  return run;
+}
+
+static void printLoad(const char *name, const Load &run) {
+  printf("%-10s %8u %6u %8u %8u %8u %7u\n", name, run.requests, run.errors,
+         percentile(run.passUs, 50), percentile(run.passUs, 99),
+         percentile(run.passUs, 100), stalls(run.passUs));
+}
+
+void test_load_loop_latency() {
+  fillHistograms();
+  Load before = load("/metrics-blocking", "/frame-blocking");
+  Load after = load("/metrics", "/frame.pbm");
+
+  printf("\n%d pollers, %d ms, link %d B / %d ms; server.loop() per pass:\n",
+         POLLERS, LOAD_MS, LINK_BYTES, LINK_MS);
+  printf("%-10s %8s %6s %8s %8s %8s %7s\n", "handlers", "requests", "errors",
+         "p50 us", "p99 us", "max us", "stalls");
+  printLoad("blocking", before);
+  printLoad("generated", after);
+
+  TEST_ASSERT_EQUAL(0, after.errors);
+  TEST_ASSERT_GREATER_THAN(POLLERS, after.requests);
+  // Waiting on acks is what the blocking handlers do; none of that is left
+  TEST_ASSERT_LESS_THAN(stalls(before.passUs), stalls(after.passUs));
+  TEST_ASSERT_LESS_THAN(percentile(before.passUs, 99),
+                        percentile(after.passUs, 99));
+}
+
+void test_serve_for_http_load() {
+  const char *seconds = getenv("HTTP_SERVE");
+  if (!seconds)
+    TEST_IGNORE_MESSAGE("set HTTP_SERVE=<seconds> to run");
+  served.reset();
+  unsigned long start = millis(), ms = atol(seconds) * 1000UL;
+  printf("serving on 127.0.0.1:%d for %s s (%s handlers)\n", HTTP_TEST_PORT,
+         seconds, getenv("HTTP_BLOCKING") ? "blocking" : "generated");
+  fflush(stdout);
+  serve([&] { return millis() - start > ms; }, nullptr, true);
+}
+
+int main() {
+  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  // First match wins: HTTP_BLOCKING puts the old handlers on the real paths
+  if (getenv("HTTP_BLOCKING")) {
+    server.on("/metrics", handleMetricsBlocking);
+    server.on("/frame.pbm", handleFrameBlocking);
+  }
+  server.on("/metrics", handleMetrics);
+  server.on("/frame.pbm", handleFrame);
+  server.on("/metrics-blocking", handleMetricsBlocking);
+  server.on("/frame-blocking", handleFrameBlocking);
+  server.on("/data", handleData);
+  server.on("/too-big", handleTooBig);
+  server.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_chunk_keeps_parts_whole);
+  if (!getenv("HTTP_BLOCKING")) {
+    RUN_TEST(test_metrics_parts_make_write);
+    RUN_TEST(test_metrics_reset_after_body);
+    RUN_TEST(test_frame_body);
+  }
+  RUN_TEST(test_blocking_handlers_same_bodies);
+  RUN_TEST(test_state_too_large_is_500);
+  if (!getenv("HTTP_BLOCKING"))
+    RUN_TEST(test_load_loop_latency);
+  RUN_TEST(test_serve_for_http_load);
+  return UNITY_END();
+}
@@ -0,0 +1,574 @@
+// Recorded inputs through the firmware's per-pass decisions on a virtual
+// clock: NMEA, DHT and supply voltage lines go to TinyGPSPlus, UiLogic and
+// ESP.getVcc() as loop() would hand them over, and each pass, one every
+// STEP_MS of trace time, is LoopLogic::pass() as loop() calls it, with
+// millis() pinned to the trace (so the TinyGPSPlus field ages are trace
+// time too). There is no network: the link counts as up (Replay::online),
+// and a weather request it asks for is logged, never made. When rendering,
+// each due frame is drawn and one that changed no pixel counts as wasted;
+// that is most of the cost, so the day run only counts frames unless
+// RENDER=1.
+//
+//   pio test -e native -f test_replay
+//   TRACE=trace.txt RENDER=1 pio test -e native -f test_replay
+//
+// Without TRACE the day run is a synthetic day (see SyntheticTrace). Its
+// event log goes to .pio/test_replay/events.txt, one "<ms> <kind> <value>"
+// per line, for `python tools/trace_build.py report`:
+//   F <face>             face change (FaceState)
+//   X <0|1>              GPS fix gained/lost
+//   W <cell>             weather fetch attempt (WeatherCache cell)
+//   R <frames> [wasted]  frames due in the last FRAME_PERIOD_MS, and how
+//                        many of them changed no pixel (when rendering)
+
+#include "loop_logic.h"
+#include <EEPROM.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unity.h>
+
+#define STEP_MS 10              // virtual time per loop() pass
+#define MAX_FPS 20              // UI_MAX_FPS in main.cpp
+#define FRAME_PERIOD_MS 60000UL // R event period
+#define EVENTS_DIR ".pio/test_replay"
+#define DAY_HOURS 24
+#define RENDER_HOURS 2
+
+// Input lines, "<ms> <input>" in time order (tools/trace_build.py format)
+class Trace {
+public:
+  virtual ~Trace() {}
+  virtual bool next(std::string &line) = 0;
+};
+
+class FileTrace : public Trace {
+public:
+  explicit FileTrace(const char *path) : _f(fopen(path, "r")) {}
+  ~FileTrace() {
+    if (_f)
+      fclose(_f);
+  }
+  bool ok() const { return _f != nullptr; }
+  bool next(std::string &line) override {
+    char buf[128];
+    if (!_f || !fgets(buf, sizeof(buf), _f))
+      return false;
+    line = buf;
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+      line.pop_back();
+    return true;
+  }
+
+private:
+  FILE *_f;
+};
+
+// One hour, repeated: RMC + GGA every second from 09:00 UTC (06:00 local,
+// so a day crosses night), with a 5 min stretch of void RMC / GGA quality
+// 0 at :40 and 5 min of silence at :45; a DHT sample every 2 s, with a
+// hand on the sensor at :20 (+8 C in a minute, cooling over ten); the
+// supply falling from 3300 to 2750 mV over the whole trace.
+class SyntheticTrace : public Trace {
+public:
+  explicit SyntheticTrace(unsigned hours) : _seconds(hours * 3600), _s(0) {}
+
+  bool next(std::string &line) override {
+    while (_queue.empty()) {
+      if (_s >= _seconds)
+        return false;
+      second(_s++);
+    }
+    line = _queue.front();
+    _queue.pop_front();
+    return true;
+  }
+
+private:
+  void add(unsigned long ms, const char *text) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%lu %s", ms, text);
+    _queue.push_back(buf);
+  }
+
+  void sentence(unsigned long ms, const char *body) {
+    uint8_t sum = 0;
+    for (const char *c = body; *c; c++)
+      sum ^= *c;
+    char buf[100];
+    snprintf(buf, sizeof(buf), "$%s*%02X", body, sum);
+    add(ms, buf);
+  }
+
+  void second(unsigned long s) {
+    unsigned long ms = s * 1000;
+    unsigned minute = s / 60 % 60;
+    unsigned long utc = 9 * 3600 + s;
+    char hms[16], date[16], body[90];
+    snprintf(hms, sizeof(hms), "%02lu%02lu%02lu.00", utc / 3600 % 24,
+             utc / 60 % 60, utc % 60);
+    snprintf(date, sizeof(date), "%02lu1026", (17 + utc / 86400) % 32);
+
+    if (minute < 40 || minute >= 50) {
+      snprintf(body, sizeof(body),
+               "GPRMC,%s,A,2333.0000,S,04637.8000,W,0.0,0.0,%s,,,A", hms, date);
+      sentence(ms, body);
+      snprintf(body, sizeof(body),
+               "GPGGA,%s,2333.0000,S,04637.8000,W,1,08,0.9,760.0,M,-5.0,M,,",
+               hms);
+      sentence(ms, body);
+    } else if (minute < 45) {
+      snprintf(body, sizeof(body), "GPRMC,%s,V,,,,,,,%s,,,N", hms, date);
+      sentence(ms, body);
+      snprintf(body, sizeof(body), "GPGGA,%s,,,,,0,00,99.99,,,,,,", hms);
+      sentence(ms, body);
+    }
+
+    if (s % 2 == 0) {
+      unsigned into = s % 3600;
+      double c = 25;
+      if (into >= 1200 && into < 1260)
+        c += 8.0 * (into - 1200) / 60;
+      else if (into >= 1260 && into < 1860)
+        c += 8 - 8.0 * (into - 1260) / 600;
+      snprintf(body, sizeof(body), "D %d 600", (int)lround(c) * 10); // DHT11
+      add(ms + 500, body);
+    }
+    if (s % 10 == 0) {
+      snprintf(body, sizeof(body), "V %lu", 3300 - 550 * s / _seconds);
+      add(ms + 700, body);
+    }
+  }
+
+  unsigned long _seconds, _s;
+  std::deque<std::string> _queue;
+};
+
+struct ReplayStats {
+  uint32_t passes, sentences, dhtSamples, vccSamples, bad;
+  uint32_t frames, wasted, events, gained, lost, surprised;
+  uint32_t fetches, cached; // weather from the network / the cache
+};
+
+class Replay {
+public:
+  explicit Replay(Trace &trace, bool render = false)
+      : frames(MAX_FPS), logic(tel, frames),
+        loopLogic(logic, frames, cache, gps), online(true),
+        display(UI_WIDTH, UI_HEIGHT, &Wire, -1), ui(display), _trace(trace),
+        _render(render), _now(0), _framesAt(0), _periodFrames(0),
+        _periodWasted(0) {
+    memset(&stats, 0, sizeof(stats));
+    memset(_last, 0, sizeof(_last));
+    randomSeed(1); // a "seed" line may override it
+    hostClockSet(0);
+    ESP.setVcc(3300);
+    EEPROM.clear(); // an empty weather cache; tests may store() into it
+    EEPROM.begin(WeatherCache::STORAGE_SIZE);
+    cache.begin(0);
+    tel.begin();
+    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+    logic.begin(0);
+    loopLogic.begin();
+    _pending = read();
+  }
+  ~Replay() { hostClockReal(); }
+
+  // loop() passes up to trace time `until`; false once the trace is over
+  bool runUntil(unsigned long until) {
+    while (_now < until) {
+      if (!_pending) {
+        flushFrames();
+        return false;
+      }
+      pass();
+    }
+    return true;
+  }
+
+  void run() { runUntil(ULONG_MAX); }
+  unsigned long now() const { return _now; }
+  bool rendering() const { return _render; }
+
+  TinyGPSPlus gps;
+  Telemetry tel;
+  FrameScheduler frames;
+  UiLogic logic;
+  WeatherCache cache;
+  LoopLogic loopLogic;
+  bool online; // WiFi link up
+  CountingSSD1306 display;
+  UiRenderer ui;
+  ReplayStats stats;
+  std::string events;
+
+private:
+  // Buffers the next timed line (timestamp stripped) in _line, _at
+  bool read() {
+    std::string line;
+    while (_trace.next(line)) {
+      if (line.empty() || line[0] == '#')
+        continue;
+      if (line.compare(0, 5, "seed ") == 0) {
+        randomSeed(strtoul(line.c_str() + 5, nullptr, 10));
+        continue;
+      }
+      char *p;
+      _at = strtoul(line.c_str(), &p, 10);
+      if (p == line.c_str() || *p != ' ') {
+        stats.bad++;
+        continue;
+      }
+      _line = p + 1;
+      return true;
+    }
+    return false;
+  }
+
+  void apply() {
+    int t, h;
+    switch (_line[0]) {
+    case '$':
+      for (char c : _line)
+        gps.encode(c);
+      // The checksum is checked when its term ends, on the '\r'
+      stats.sentences += gps.encode('\r');
+      gps.encode('\n');
+      break;
+    case 'D':
+      if (sscanf(_line.c_str() + 1, "%d %d", &t, &h) == 2) {
+        logic.dhtSample(t, h, _now);
+        stats.dhtSamples++;
+      } else {
+        stats.bad++;
+      }
+      break;
+    case 'V':
+      ESP.setVcc(atoi(_line.c_str() + 1));
+      stats.vccSamples++;
+      break;
+    default:
+      stats.bad++;
+    }
+  }
+
+  // loop() with the inputs, minus the hardware and the network
+  void pass() {
+    _now += STEP_MS;
+    hostClockSet(_now);
+    stats.passes++;
+    FaceState face = logic.face();
+    bool fix = logic.fix();
+
+    while (_pending && (long)(_now - _at) >= 0) {
+      apply();
+      _pending = read();
+    }
+    // No request ever runs, as when one fails at once
+    uint8_t flags = loopLogic.pass(_now, online, false);
+    if (flags & PASS_FETCH) {
+      event('W', loopLogic.weatherCell());
+      stats.fetches++;
+    }
+    stats.cached += (flags & PASS_CACHED) != 0;
+    if (flags & PASS_FRAME)
+      frame();
+
+    if (logic.face() != face) {
+      event('F', logic.face());
+      stats.surprised += logic.face() == FACE_SURPRISED;
+    }
+    if (logic.fix() != fix) {
+      event('X', logic.fix());
+      (logic.fix() ? stats.gained : stats.lost)++;
+    }
+    if (_now - _framesAt >= FRAME_PERIOD_MS)
+      flushFrames();
+  }
+
+  void frame() {
+    stats.frames++;
+    _periodFrames++;
+    if (!_render)
+      return;
+    UiState s;
+    logic.save(s);
+    ui.render(s);
+    bool wasted = memcmp(_last, display.getBuffer(), sizeof(_last)) == 0;
+    memcpy(_last, display.getBuffer(), sizeof(_last));
+    if (wasted) {
+      stats.wasted++;
+      _periodWasted++;
+    }
+  }
+
+  void event(char kind, long value) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%lu %c %ld\n", _now, kind, value);
+    events += buf;
+    stats.events++;
+  }
+
+  void flushFrames() {
+    if (_periodFrames) {
+      char buf[40];
+      if (_render)
+        snprintf(buf, sizeof(buf), "%lu R %u %u\n", _now, _periodFrames,
+                 _periodWasted);
+      else
+        snprintf(buf, sizeof(buf), "%lu R %u\n", _now, _periodFrames);
+      events += buf;
+      stats.events++;
+    }
+    _periodFrames = _periodWasted = 0;
+    _framesAt = _now;
+  }
+
+  Trace &_trace;
+  bool _render;
+  bool _pending;
+  unsigned long _at;
+  std::string _line;
+  unsigned long _now;
+  unsigned long _framesAt;
+  unsigned _periodFrames, _periodWasted;
+  uint8_t _last[UI_WIDTH * UI_HEIGHT / 8];
+};
+
+static unsigned long at(unsigned minute, unsigned second = 0) {
+  return (minute * 60 + second) * 1000UL;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// A receiver that keeps talking without a fix: RMC 'V' and GGA quality 0
+// still commit the time and date, never the location, so the fix goes
+// after UI_GPS_FIX_MAX_AGE while the clock stays up
+void test_void_rmc_loses_fix_keeps_clock() {
+  SyntheticTrace trace(1);
+  Replay r(trace);
+
+  r.runUntil(at(39, 59));
+  TEST_ASSERT_TRUE(r.logic.fix());
+  TEST_ASSERT_TRUE(r.tel.timeValid);
+
+  r.runUntil(at(40, 3));
+  TEST_ASSERT_TRUE(r.logic.fix()); // location 4 s old
+  r.runUntil(at(40, 7));
+  TEST_ASSERT_FALSE(r.logic.fix());
+  TEST_ASSERT_FALSE(r.tel.gpsFix);
+  TEST_ASSERT_TRUE(r.tel.timeValid);
+  TEST_ASSERT_TRUE(r.tel.dateValid);
+
+  r.runUntil(at(41));
+  TEST_ASSERT_EQUAL(FACE_SLEEPY, r.logic.face());
+  r.runUntil(at(44, 59));
+  TEST_ASSERT_FALSE(r.logic.fix());
+  TEST_ASSERT_TRUE(r.tel.timeValid);
+  TEST_ASSERT_EQUAL(1, r.stats.lost);
+}
+
+// Nothing at all from the receiver: the clock goes too, and a fix comes
+// back with the happy face
+void test_silence_clears_clock() {
+  SyntheticTrace trace(1);
+  Replay r(trace);
+
+  r.runUntil(at(45, 3));
+  TEST_ASSERT_FALSE(r.tel.timeValid);
+  TEST_ASSERT_FALSE(r.tel.dateValid);
+  TEST_ASSERT_FALSE(r.logic.fix());
+
+  r.runUntil(at(50, 2));
+  TEST_ASSERT_TRUE(r.logic.fix());
+  TEST_ASSERT_TRUE(r.tel.timeValid);
+  TEST_ASSERT_EQUAL(FACE_HAPPY, r.logic.face());
+  r.runUntil(at(50, 7));
+  TEST_ASSERT_NOT_EQUAL(FACE_HAPPY, r.logic.face());
+  TEST_ASSERT_EQUAL(2, r.stats.gained);
+}
+
+// Trace times of the events of one kind (and value, unless -1)
+static std::vector<unsigned long> eventTimes(const Replay &r, char kind,
+                                             long value = -1) {
+  std::vector<unsigned long> times;
+  unsigned long ms;
+  char k;
+  long v;
+  for (const char *p = r.events.c_str(); *p; p = strchr(p, '\n') + 1) {
+    if (sscanf(p, "%lu %c %ld", &ms, &k, &v) == 3 && k == kind &&
+        (value < 0 || v == value))
+      times.push_back(ms);
+  }
+  return times;
+}
+
+// Weather is fetched on the first fix, then every WEATHER_REFRESH_MS (the
+// first pass past it) while the fix lasts; a fix that comes back after
+// that asks at once. Offline, nothing is asked for.
+void test_weather_fetch_timing() {
+  SyntheticTrace trace(2);
+  Replay r(trace);
+  r.run();
+
+  std::vector<unsigned long> fetches = eventTimes(r, 'W');
+  std::vector<unsigned long> gained = eventTimes(r, 'X', 1);
+  uint32_t cell = WeatherCache::cellFor(-23.55, -46.63);
+  TEST_ASSERT_EQUAL(3, gained.size()); // start, after each silence
+  // 0:01, 15:01, 30:01; lost from 40:05, the fix asks again at 50:01, and
+  // so on every 15 min. The second regain, at 110:00, is inside the
+  // interval of the 95:01 fetch, so that one waits for 110:01.
+  TEST_ASSERT_EQUAL(8, fetches.size());
+  TEST_ASSERT_EQUAL(fetches.size(), r.stats.fetches);
+  TEST_ASSERT_EQUAL(cell, r.loopLogic.weatherCell());
+  TEST_ASSERT_EQUAL(gained[0], fetches[0]);
+  for (size_t i = 1; i < fetches.size(); i++) {
+    unsigned long gap = fetches[i] - fetches[i - 1];
+    if (gap == WEATHER_REFRESH_MS + STEP_MS)
+      continue;
+    TEST_ASSERT_GREATER_THAN(WEATHER_REFRESH_MS, gap);
+    TEST_ASSERT_TRUE(std::find(gained.begin(), gained.end(), fetches[i]) !=
+                     gained.end());
+  }
+  TEST_ASSERT_EQUAL(gained[1], fetches[3]);
+  TEST_ASSERT_LESS_THAN(fetches[7], gained[2]);
+  TEST_ASSERT_EQUAL(WEATHER_REFRESH_MS + STEP_MS, fetches[7] - fetches[6]);
+
+  SyntheticTrace offline(1);
+  Replay o(offline);
+  o.online = false;
+  o.run();
+  TEST_ASSERT_EQUAL(0, o.stats.fetches);
+}
+
+// A fresh cache entry for the cell is shown on the first fix, and the
+// network is asked only once it is WEATHER_REFRESH_MS old
+void test_fresh_cache_delays_fetch() {
+  SyntheticTrace trace(1);
+  Replay r(trace);
+  uint32_t cell = WeatherCache::cellFor(-23.55, -46.63);
+  uint32_t start = WeatherCache::epochFrom(2026, 10, 17, 9, 0, 0);
+  r.cache.store(cell, 61, 1, start - 600); // 10 min old at 09:00 UTC
+
+  r.runUntil(at(4, 50));
+  TEST_ASSERT_TRUE(r.logic.fix());
+  TEST_ASSERT_EQUAL(1, r.stats.cached);
+  TEST_ASSERT_EQUAL(0, r.stats.fetches);
+  TEST_ASSERT_EQUAL(61, r.logic.weatherCode());
+  TEST_ASSERT_TRUE(r.logic.weatherLive());
+
+  r.runUntil(at(5, 10));
+  TEST_ASSERT_EQUAL(1, r.stats.fetches);
+  std::vector<unsigned long> fetches = eventTimes(r, 'W');
+  unsigned long fix = eventTimes(r, 'X', 1)[0];
+  // Due when the entry turns 900 s old, give or take the second of GPS
+  // time it was aged by
+  TEST_ASSERT_UINT32_WITHIN(1000, fix + (WEATHER_REFRESH_MS - 600000),
+                            fetches[0]);
+}
+
+// Replays one trace to the end; real seconds taken
+static double timedRun(Replay &r) {
+  auto t0 = std::chrono::steady_clock::now();
+  r.run();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+static void printStats(const char *name, const Replay &r, double real) {
+  const ReplayStats &s = r.stats;
+  double hours = r.now() / 3.6e6;
+  printf("%s: %.1f h in %.2f s (%.0f h/min), %lu passes, %lu NMEA, %lu DHT, "
+         "%lu VCC, %lu bad\n",
+         name, hours, real, hours / real * 60, (unsigned long)s.passes,
+         (unsigned long)s.sentences, (unsigned long)s.dhtSamples,
+         (unsigned long)s.vccSamples, (unsigned long)s.bad);
+  printf("  fix gained %lu, lost %lu, surprised %lu, %lu frames",
+         (unsigned long)s.gained, (unsigned long)s.lost,
+         (unsigned long)s.surprised, (unsigned long)s.frames);
+  if (r.rendering())
+    printf(" (%lu changed no pixel, %.1f%%)", (unsigned long)s.wasted,
+           s.frames ? 100.0 * s.wasted / s.frames : 0);
+  printf(", %lu weather fetches, %lu events\n", (unsigned long)s.fetches,
+         (unsigned long)s.events);
+}
+
+// Same trace, same seed: same decisions at the same trace times
+void test_same_trace_same_events() {
+  std::string first;
+  for (int run = 0; run < 2; run++) {
+    SyntheticTrace trace(2);
+    Replay r(trace);
+    r.run();
+    TEST_ASSERT_GREATER_THAN(0, r.stats.events);
+    if (run == 0)
+      first = r.events;
+    else
+      TEST_ASSERT_TRUE(first == r.events);
+  }
+}
+
+// Every due frame drawn: how many changed nothing on the screen. Drawing
+// must not change what the loop decides.
+void test_rendered_frames() {
+  SyntheticTrace counted(RENDER_HOURS), drawn(RENDER_HOURS);
+  Replay c(counted);
+  c.run();
+  Replay r(drawn, true);
+  double real = timedRun(r);
+  printStats("rendered", r, real);
+
+  TEST_ASSERT_EQUAL(c.stats.frames, r.stats.frames);
+  TEST_ASSERT_EQUAL(c.stats.gained, r.stats.gained);
+  TEST_ASSERT_EQUAL(c.stats.surprised, r.stats.surprised);
+  TEST_ASSERT_GREATER_THAN(0, r.stats.frames);
+  TEST_ASSERT_LESS_THAN(r.stats.frames, r.stats.wasted);
+}
+
+// A whole day (or $TRACE), timed: simulated hours per real minute
+void test_day() {
+  const char *path = getenv("TRACE");
+  FileTrace file(path ? path : "");
+  SyntheticTrace synthetic(DAY_HOURS);
+  if (path)
+    TEST_ASSERT_TRUE_MESSAGE(file.ok(), path);
+  Trace &trace = path ? (Trace &)file : (Trace &)synthetic;
+
+  Replay r(trace, getenv("RENDER") != nullptr);
+  double real = timedRun(r);
+  printStats(path ? path : "synthetic", r, real);
+
+  mkdir(".pio", 0755);
+  mkdir(EVENTS_DIR, 0755);
+  FILE *f = fopen(EVENTS_DIR "/events.txt", "w");
+  TEST_ASSERT_NOT_NULL(f);
+  fputs(r.events.c_str(), f);
+  fclose(f);
+  printf("  -> " EVENTS_DIR "/events.txt\n");
+
+  TEST_ASSERT_EQUAL(0, r.stats.bad);
+  if (!path) {
+    // Fix at the start and after each silence, lost in each void stretch;
+    // one surprise per warm-up (the cooling is too slow for one)
+    TEST_ASSERT_EQUAL(DAY_HOURS + 1, r.stats.gained);
+    TEST_ASSERT_EQUAL(DAY_HOURS, r.stats.lost);
+    TEST_ASSERT_EQUAL(DAY_HOURS, r.stats.surprised);
+    TEST_ASSERT_EQUAL(0, r.logic.batteryLevel());
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_void_rmc_loses_fix_keeps_clock);
+  RUN_TEST(test_silence_clears_clock);
+  RUN_TEST(test_weather_fetch_timing);
+  RUN_TEST(test_fresh_cache_delays_fetch);
+  RUN_TEST(test_same_trace_same_events);
+  RUN_TEST(test_rendered_frames);
+  RUN_TEST(test_day);
+  return UNITY_END();
+}
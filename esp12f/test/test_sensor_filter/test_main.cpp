@@ -0,0 +1,154 @@
+// SensorFilter's rate and the surprised face on DHT11-shaped temperature
+// traces: a reading every DHT_INTERVAL_MS, whole degrees as the DHT11
+// reports them, rounded from a true temperature with a little noise. The
+// face logic is main.cpp's dhtSample(): surprised once the rate exceeds
+// FACE_SURPRISE_RATE, re-armed below half of it.
+
+#include "dht_reader.h"
+#include "sensor_filter.h"
+#include <math.h>
+#include <unity.h>
+
+#define FACE_SURPRISE_RATE 30 // as in main.cpp
+#define RUN_MS (20 * 60000UL)
+
+typedef double (*Truth)(double minutes);
+
+struct Run {
+  int surprises;
+  int16_t maxRate; // tenths/min, absolute
+  int16_t last;    // filtered value at the end
+};
+
+// Deterministic sensor noise in [-amp, amp] C
+static double noise(uint32_t &state, double amp) {
+  state = state * 1664525 + 1013904223;
+  return ((state >> 8) / 16777216.0 * 2 - 1) * amp;
+}
+
+static Run replay(Truth truth, double noiseC) {
+  SensorFilter f(50, 2); // tempFilter in main.cpp
+  Run run = {0, 0, 0};
+  bool armed = true;
+  uint32_t seed = 3;
+  for (unsigned long now = 0; now < RUN_MS; now += DHT_INTERVAL_MS) {
+    double c = truth(now / 60000.0) + noise(seed, noiseC);
+    f.add((int16_t)lround(c) * 10, now);
+    int16_t rate = abs(f.ratePerMin());
+    if (rate > run.maxRate)
+      run.maxRate = rate;
+    if (rate > FACE_SURPRISE_RATE && armed) {
+      armed = false;
+      run.surprises++;
+    } else if (rate < FACE_SURPRISE_RATE / 2) {
+      armed = true;
+    }
+  }
+  run.last = f.value();
+  return run;
+}
+
+static Run report(const char *name, Truth truth, double noiseC = 0.3) {
+  Run r = replay(truth, noiseC);
+  printf("%-16s max rate %3d tenths/min, %d surprised\n", name, r.maxRate,
+         r.surprises);
+  return r;
+}
+
+// Sitting right at a rounding boundary: every reading is 23 or 24
+static double boundary(double) { return 23.5; }
+// One 1 C step, the reviewer's case
+static double oneStep(double m) { return m < 5 ? 23.2 : 24.2; }
+// Two steps a minute apart: 2 C/min at most
+static double twoSteps(double m) { return m < 5 ? 23.2 : m < 6 ? 24.2 : 25.2; }
+// Afternoon sun: 3 C over 20 minutes
+static double drift(double m) { return 22.2 + m * 0.15; }
+// Hand on the sensor: 6 C in a minute and a half, then back
+static double handOn(double m) {
+  if (m < 5)
+    return 23.2;
+  if (m < 6.5)
+    return 23.2 + (m - 5) * 4;
+  if (m < 10)
+    return 29.2;
+  return 29.2 - fmin(m - 10, 3) * 2;
+}
+// Carried outside: 9 C at once, past maxJump, confirmed as a real step
+static double outside(double m) { return m < 5 ? 23.2 : 14.2; }
+
+void setUp() {}
+void tearDown() {}
+
+void test_one_sensor_step_is_not_a_swing() {
+  Run r = report("one step", oneStep, 0);
+  TEST_ASSERT_EQUAL(0, r.surprises);
+  TEST_ASSERT_LESS_OR_EQUAL(14, r.maxRate);
+  TEST_ASSERT_EQUAL(240, r.last);
+  TEST_ASSERT_EQUAL(0, report("boundary flicker", boundary).surprises);
+  TEST_ASSERT_EQUAL(0, report("two steps", twoSteps, 0).surprises);
+  TEST_ASSERT_EQUAL(0, report("slow drift", drift).surprises);
+}
+
+void test_fast_swing_is_surprising_once() {
+  Run r = report("hand on sensor", handOn);
+  TEST_ASSERT_EQUAL(1, r.surprises); // heating; cooling stays under 3 C/min
+  TEST_ASSERT_GREATER_THAN(FACE_SURPRISE_RATE, r.maxRate);
+  r = report("carried outside", outside);
+  TEST_ASSERT_EQUAL(1, r.surprises);
+  TEST_ASSERT_EQUAL(140, r.last);
+}
+
+void test_alternating_spikes_are_not_a_step() {
+  SensorFilter f(50, 2);
+  unsigned long now = 0;
+  for (int i = 0; i < 10; i++, now += DHT_INTERVAL_MS)
+    f.add(240, now);
+  // Up, down, up, ...: each one an outlier, never three on one side
+  for (int i = 0; i < 12; i++, now += DHT_INTERVAL_MS)
+    f.add(i % 2 ? 140 : 340, now);
+  TEST_ASSERT_EQUAL(240, f.value());
+  TEST_ASSERT_EQUAL(12, f.stats().rejected);
+
+  // Three on the same side are a real step
+  for (int i = 0; i < 3; i++, now += DHT_INTERVAL_MS)
+    f.add(340, now);
+  TEST_ASSERT_EQUAL(340, f.value());
+}
+
+void test_no_rate_over_a_short_history() {
+  // A 6 C/min ramp: no rate for the first FILTER_RATE_MIN_MS, nor for as
+  // long after the sensor stops answering for two minutes
+  SensorFilter f(50, 2);
+  for (unsigned long now = 0; now < 10 * 60000UL; now += DHT_INTERVAL_MS) {
+    if (now >= 4 * 60000UL && now < 6 * 60000UL)
+      continue;
+    f.add(230 + now / 1000, now);
+    unsigned long history = now < 6 * 60000UL ? now : now - 6 * 60000UL;
+    if (history < FILTER_RATE_MIN_MS)
+      TEST_ASSERT_EQUAL(0, f.ratePerMin());
+    else if (history > FILTER_RATE_MIN_MS + 10000) // the gate re-seeds first
+      TEST_ASSERT_GREATER_THAN(FACE_SURPRISE_RATE, f.ratePerMin());
+  }
+}
+
+void test_cycles_per_sample() {
+  SensorFilter f(50, 2);
+  const int n = 100000;
+  uint32_t seed = 5;
+  uint32_t t0 = micros();
+  for (int i = 0; i < n; i++)
+    f.add(230 + (int16_t)lround(noise(seed, 3)), i * DHT_INTERVAL_MS);
+  uint32_t us = micros() - t0;
+  printf("add(): %.0f ns per sample on the host\n", us * 1000.0 / n);
+  TEST_ASSERT_EQUAL(n, f.stats().samples);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_sensor_step_is_not_a_swing);
+  RUN_TEST(test_fast_swing_is_surprising_once);
+  RUN_TEST(test_alternating_spikes_are_not_a_step);
+  RUN_TEST(test_no_rate_over_a_short_history);
+  RUN_TEST(test_cycles_per_sample);
+  return UNITY_END();
+}
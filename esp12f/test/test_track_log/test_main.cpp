@@ -0,0 +1,78 @@
+// TrackLog and TrackReader on the host LittleFS (a directory under .pio):
+// what the reader sees is fixed at begin(), so the two GeoJSON passes of a
+// track export (coordinates, then coordTimes) pair up one to one even when
+// the logger flushes more fixes in between.
+
+#include "track_log.h"
+#include <unity.h>
+
+#define BASE_EPOCH 1760000000UL
+#define BASE_LAT -23550000
+#define BASE_LON -46630000
+
+static TrackLog *track;
+
+static void addFixes(uint32_t first, uint32_t n) {
+  for (uint32_t i = first; i < first + n; i++)
+    track->add(BASE_EPOCH + i, BASE_LAT + (int32_t)i * 7,
+               BASE_LON - (int32_t)i * 5);
+  track->flush();
+}
+
+static uint32_t readAll(TrackReader &r, uint32_t first = 0) {
+  TrackPoint p;
+  uint32_t n = first;
+  while (r.next(p)) {
+    TEST_ASSERT_EQUAL_UINT32(BASE_EPOCH + n, p.epoch);
+    TEST_ASSERT_EQUAL_INT32(BASE_LAT + (int32_t)n * 7, p.lat);
+    n++;
+  }
+  return n;
+}
+
+void setUp() {
+  TEST_ASSERT_TRUE(LittleFS.begin() && LittleFS.format());
+  track = new TrackLog();
+  TEST_ASSERT_TRUE(track->begin());
+}
+
+void tearDown() {
+  delete track;
+  track = nullptr;
+}
+
+void test_reads_what_was_flushed() {
+  addFixes(0, 300);
+  TrackReader r;
+  TEST_ASSERT_TRUE(r.begin());
+  TEST_ASSERT_EQUAL(300, readAll(r));
+  r.end();
+}
+
+void test_flush_between_passes_is_not_seen() {
+  addFixes(0, 300);
+  TrackReader r;
+  TEST_ASSERT_TRUE(r.begin());
+  TrackPoint p;
+  for (int i = 0; i < 100; i++)
+    TEST_ASSERT_TRUE(r.next(p));
+
+  addFixes(300, 200); // flushed during the first pass
+  TEST_ASSERT_EQUAL(300, readAll(r, 100));
+
+  addFixes(500, 200); // and between the passes
+  TEST_ASSERT_TRUE(r.rewind());
+  TEST_ASSERT_EQUAL(300, readAll(r));
+  r.end();
+
+  TEST_ASSERT_TRUE(r.begin()); // a new export sees all of it
+  TEST_ASSERT_EQUAL(700, readAll(r));
+  r.end();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reads_what_was_flushed);
+  RUN_TEST(test_flush_between_passes_is_not_seen);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+// TrackSimplifier on synthetic tracks: every fix dropped between two kept
+// points must lie within TRACK_TOLERANCE_M of the segment joining them, the
+// first and last fix are always kept, and the point count is checked
+// against a full Douglas-Peucker run over the same fixes in double
+// precision, the whole-track pass the streaming version stands in for.
+
+#include "track_simplify.h"
+#include <math.h>
+#include <unity.h>
+#include <vector>
+
+#define M_PER_UDEG 0.1113195 // as in track_simplify.cpp
+#define ROUNDING_M 0.05      // float arithmetic in the simplifier
+#define BASE_LAT -23550000
+#define BASE_LON -46630000
+
+typedef std::vector<TrackPoint> Track;
+
+static double kx() { return M_PER_UDEG * cos(BASE_LAT * M_PI / 180e6); }
+
+// Metres east/north of the base point, one fix a second
+static void addFix(Track &t, double east, double north) {
+  TrackPoint p;
+  p.epoch = 1760000000 + t.size();
+  p.lat = BASE_LAT + (int32_t)lround(north / M_PER_UDEG);
+  p.lon = BASE_LON + (int32_t)lround(east / kx());
+  t.push_back(p);
+}
+
+// Deterministic jitter in [-amp, amp]
+static double jitter(uint32_t &state, double amp) {
+  state = state * 1664525 + 1013904223;
+  return ((state >> 8) / 16777216.0 * 2 - 1) * amp;
+}
+
+static double segmentDistance(const TrackPoint &a, const TrackPoint &b,
+                              const TrackPoint &p) {
+  double bx = (b.lon - a.lon) * kx(), by = (b.lat - a.lat) * M_PER_UDEG;
+  double px = (p.lon - a.lon) * kx(), py = (p.lat - a.lat) * M_PER_UDEG;
+  double len2 = bx * bx + by * by;
+  double t = len2 > 0 ? (px * bx + py * by) / len2 : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  return hypot(px - t * bx, py - t * by);
+}
+
+static void douglasPeucker(const Track &t, size_t first, size_t last,
+                           double tol, std::vector<bool> &keep) {
+  double worst = 0;
+  size_t at = first;
+  for (size_t i = first + 1; i < last; i++) {
+    double d = segmentDistance(t[first], t[last], t[i]);
+    if (d > worst) {
+      worst = d;
+      at = i;
+    }
+  }
+  if (worst <= tol)
+    return;
+  keep[at] = true;
+  douglasPeucker(t, first, at, tol, keep);
+  douglasPeucker(t, at, last, tol, keep);
+}
+
+static size_t referenceCount(const Track &t, double tol) {
+  std::vector<bool> keep(t.size(), false);
+  keep.front() = keep.back() = true;
+  douglasPeucker(t, 0, t.size() - 1, tol, keep);
+  size_t n = 0;
+  for (bool k : keep)
+    n += k;
+  return n;
+}
+
+struct Outcome {
+  size_t points;
+  double maxDeviation;
+};
+
+// Runs the track through a simplifier and measures what it kept
+static Outcome simplify(const Track &t, float tol = TRACK_TOLERANCE_M) {
+  TrackSimplifier s;
+  s.setTolerance(tol);
+  std::vector<size_t> kept; // indexes into t
+  TrackPoint out;
+  size_t next = 0;
+  auto record = [&](const TrackPoint &p) {
+    while (next < t.size() && t[next].epoch != p.epoch)
+      next++;
+    TEST_ASSERT_TRUE_MESSAGE(next < t.size(),
+                             "kept point is not a fix, or out of order");
+    kept.push_back(next++);
+  };
+  for (const TrackPoint &p : t)
+    if (s.push(p, out))
+      record(out);
+  if (s.flush(out))
+    record(out);
+
+  TEST_ASSERT_EQUAL(0, kept.front());
+  TEST_ASSERT_EQUAL(t.size() - 1, kept.back());
+  TEST_ASSERT_EQUAL(t.size(), s.in());
+  TEST_ASSERT_EQUAL(kept.size(), s.out());
+
+  Outcome o = {kept.size(), 0};
+  for (size_t k = 0; k + 1 < kept.size(); k++) {
+    TEST_ASSERT_LESS_OR_EQUAL(TRACK_WINDOW, kept[k + 1] - kept[k]);
+    for (size_t i = kept[k] + 1; i < kept[k + 1]; i++)
+      o.maxDeviation = fmax(o.maxDeviation,
+                            segmentDistance(t[kept[k]], t[kept[k + 1]], t[i]));
+  }
+  return o;
+}
+
+static void check(const char *name, const Track &t) {
+  Outcome o = simplify(t);
+  size_t ref = referenceCount(t, TRACK_TOLERANCE_M);
+  printf("%-10s %4u fixes -> %3u points (Douglas-Peucker %3u), max %.2f m\n",
+         name, (unsigned)t.size(), (unsigned)o.points, (unsigned)ref,
+         o.maxDeviation);
+  TEST_ASSERT_LESS_OR_EQUAL(TRACK_TOLERANCE_M + ROUNDING_M, o.maxDeviation);
+  // Greedy and windowed, so it may keep more than a whole-track pass, but
+  // within a small factor plus the points forced by the window cap
+  TEST_ASSERT_LESS_OR_EQUAL(2 * ref + t.size() / TRACK_WINDOW, o.points);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_straight_line_keeps_window_points_only() {
+  Track t;
+  for (int i = 0; i < 320; i++)
+    addFix(t, i * 8.0, i * 3.0);
+  check("straight", t);
+  // Only the window cap forces points: one per TRACK_WINDOW fixes
+  Outcome o = simplify(t);
+  TEST_ASSERT_LESS_OR_EQUAL(t.size() / TRACK_WINDOW + 2, o.points);
+}
+
+void test_jitter_below_tolerance_is_dropped() {
+  Track straight, noisy;
+  uint32_t seed = 1;
+  for (int i = 0; i < 320; i++) {
+    addFix(straight, i * 8.0, 0);
+    addFix(noisy, i * 8.0, jitter(seed, 2.0));
+  }
+  check("jitter", noisy);
+  TEST_ASSERT_LESS_OR_EQUAL(simplify(straight).points + 2,
+                            simplify(noisy).points);
+}
+
+void test_zigzag_keeps_every_corner() {
+  Track t;
+  const int legs = 12, fixesPerLeg = 10;
+  for (int leg = 0; leg < legs; leg++)
+    for (int i = 0; i < fixesPerLeg; i++) {
+      double along = leg * 50.0 + i * 5.0;
+      double across = (leg % 2 ? fixesPerLeg - i : i) * 5.0;
+      addFix(t, along, across);
+    }
+  check("zigzag", t);
+  TEST_ASSERT_GREATER_OR_EQUAL(legs + 1, simplify(t).points);
+}
+
+void test_circle() {
+  Track t;
+  for (int i = 0; i <= 360; i += 3)
+    addFix(t, 150 * sin(i * M_PI / 180), 150 * cos(i * M_PI / 180));
+  check("circle", t);
+}
+
+void test_city_drive() {
+  // Straight blocks, right-angle turns, GPS noise, a stop at a light
+  Track t;
+  uint32_t seed = 7;
+  double x = 0, y = 0;
+  const double dir[4][2] = {{1, 0}, {0, 1}, {1, 0}, {0, -1}};
+  for (int block = 0; block < 16; block++) {
+    const double *d = dir[block % 4];
+    for (int i = 0; i < 25; i++) {
+      double v = (block == 5 && i < 15) ? 0 : 11; // ~40 km/h, or stopped
+      x += d[0] * v;
+      y += d[1] * v;
+      addFix(t, x + jitter(seed, 1.5), y + jitter(seed, 1.5));
+    }
+  }
+  check("city", t);
+}
+
+void test_larger_tolerance_keeps_fewer_points() {
+  Track t;
+  for (int i = 0; i <= 360; i += 3)
+    addFix(t, 150 * sin(i * M_PI / 180), 150 * cos(i * M_PI / 180));
+  Outcome fine = simplify(t, 2.0f), coarse = simplify(t, 10.0f);
+  TEST_ASSERT_LESS_OR_EQUAL(2.0 + ROUNDING_M, fine.maxDeviation);
+  TEST_ASSERT_LESS_OR_EQUAL(10.0 + ROUNDING_M, coarse.maxDeviation);
+  TEST_ASSERT_LESS_THAN(fine.points, coarse.points);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_straight_line_keeps_window_points_only);
+  RUN_TEST(test_jitter_below_tolerance_is_dropped);
+  RUN_TEST(test_zigzag_keeps_every_corner);
+  RUN_TEST(test_circle);
+  RUN_TEST(test_city_drive);
+  RUN_TEST(test_larger_tolerance_keeps_fewer_points);
+  return UNITY_END();
+}
@@ -0,0 +1,239 @@
+// Every frame the UI can show, rendered on the host and compared with the
+// goldens in test/test_ui_render/golden: each face with each sky (one
+// weather code per day icon, and night) and with the clock and the date,
+// from UiRenderer::fixture()'s telemetry. The files are the PBMs
+// /frame.pbm serves, named as tools/ui_capture.py names them, so a device
+// can be checked against the same set.
+//
+//   pio test -e native -f test_ui_render                    # compare
+//   UPDATE_GOLDEN=1 pio test -e native -f test_ui_render    # rewrite
+//
+// A frame that differs is written to .pio/test_ui_render/ for viewing.
+// The table is the render benchmark: average render() and text time over
+// RUNS frames and the GFX pixel operations (pixels/h-lines/v-lines) of one.
+// Times are the host's; op counts are the same as on the device.
+
+#include "ui_render.h"
+#include <string>
+#include <sys/stat.h>
+#include <unity.h>
+
+#define GOLDEN_DIR "test/test_ui_render/golden"
+#define ACTUAL_DIR ".pio/test_ui_render"
+#define RUNS 200
+
+static const char *const FACES[FACE_COUNT] = {"normal", "happy", "sleepy",
+                                              "surprised", "look"};
+// One code per day icon (clear, cloudy, fog fallback, rain, storm), then
+// night, where the code does not matter
+static const struct {
+  int code, isDay;
+} SKIES[] = {{0, 1}, {2, 1}, {45, 1}, {61, 1}, {95, 1}, {0, 0}};
+
+static CountingSSD1306 display(UI_WIDTH, UI_HEIGHT, &Wire, -1);
+
+static std::string frameName(int face, int sky, bool date) {
+  char name[40];
+  if (SKIES[sky].isDay)
+    snprintf(name, sizeof(name), "%s_wx%d_%s", FACES[face], SKIES[sky].code,
+             date ? "date" : "time");
+  else
+    snprintf(name, sizeof(name), "%s_night_%s", FACES[face],
+             date ? "date" : "time");
+  return name;
+}
+
+static UiState state(int face, int sky, bool date) {
+  UiState s = {};
+  UiRenderer::fixture(s);
+  s.face = (FaceState)face;
+  s.weatherCode = SKIES[sky].code;
+  s.isDay = SKIES[sky].isDay;
+  s.showDate = date;
+  return s;
+}
+
+static std::string pbm(const UiRenderer &ui) {
+  std::string out(UI_PBM_HEADER);
+  uint8_t rows[UI_PBM_PAGE];
+  for (uint8_t page = 0; page < UI_HEIGHT / 8; page++) {
+    ui.pbmPage(page, rows);
+    out.append((const char *)rows, sizeof(rows));
+  }
+  return out;
+}
+
+static bool readFile(const std::string &path, std::string &out) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  char buf[512];
+  size_t n;
+  out.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static void writeFile(const std::string &path, const std::string &data) {
+  FILE *f = fopen(path.c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+}
+
+static int pixelsDiffering(const std::string &a, const std::string &b) {
+  int n = 0;
+  for (size_t i = sizeof(UI_PBM_HEADER) - 1; i < a.size() && i < b.size(); i++)
+    n += __builtin_popcount((uint8_t)(a[i] ^ b[i]));
+  return n;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_frames_match_goldens() {
+  bool update = getenv("UPDATE_GOLDEN") != nullptr;
+  UiRenderer ui(display);
+  int failed = 0;
+
+  printf("%-24s %9s %8s %14s %s\n", "state", "render us", "text us",
+         "px/h/v ops", "golden");
+  for (int face = 0; face < FACE_COUNT; face++)
+    for (size_t sky = 0; sky < sizeof(SKIES) / sizeof(SKIES[0]); sky++)
+      for (int date = 0; date < 2; date++) {
+        std::string name = frameName(face, sky, date);
+        UiState s = state(face, sky, date);
+
+        uint32_t t0 = micros(), text = 0;
+        for (int i = 0; i < RUNS; i++) {
+          ui.render(s);
+          text += ui.stats().textMicros;
+        }
+        double us = (micros() - t0) / (double)RUNS;
+        std::string frame = pbm(ui);
+        TEST_ASSERT_EQUAL(UI_PBM_SIZE, frame.size());
+
+        std::string golden, status;
+        std::string path = std::string(GOLDEN_DIR "/") + name + ".pbm";
+        if (update) {
+          writeFile(path, frame);
+          status = "updated";
+        } else if (!readFile(path, golden)) {
+          status = "missing";
+          failed++;
+        } else if (golden != frame) {
+          mkdir(".pio", 0755);
+          mkdir(ACTUAL_DIR, 0755);
+          writeFile(std::string(ACTUAL_DIR "/") + name + ".pbm", frame);
+          status = std::to_string(pixelsDiffering(golden, frame)) +
+                   " px differ";
+          failed++;
+        } else {
+          status = "ok";
+        }
+
+        const PixelOps &ops = ui.stats().ops;
+        char opsText[36];
+        snprintf(opsText, sizeof(opsText), "%lu/%lu/%lu",
+                 (unsigned long)ops.pixels, (unsigned long)ops.hlines,
+                 (unsigned long)ops.vlines);
+        printf("%-24s %9.1f %8.1f %14s %s\n", name.c_str(), us,
+               text / (double)RUNS, opsText, status.c_str());
+      }
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, failed,
+                            "frames differ from the goldens or are missing "
+                            "(UPDATE_GOLDEN=1 rewrites them)");
+}
+
+// A frame depends on its state only, not on what was drawn before: the
+// same state renders the same after any other, with or without the cached
+// background
+void test_render_has_no_memory() {
+  UiRenderer first(display);
+  first.render(state(FACE_SLEEPY, 0, false)); // the display's first text
+  std::string sleepy = pbm(first);
+
+  UiRenderer ui(display);
+  for (int face = 0; face < FACE_COUNT; face++)
+    ui.render(state(face, 3, true));
+  ui.render(state(FACE_SLEEPY, 0, false));
+  TEST_ASSERT_TRUE(sleepy == pbm(ui));
+
+  ui.invalidateBackground();
+  ui.render(state(FACE_SLEEPY, 0, false));
+  TEST_ASSERT_TRUE(sleepy == pbm(ui));
+}
+
+// A /frame.pbm snapshot draws the same frame as render(), but its timing
+// and ops are its own: the live figures in stats() stay as they were
+void test_snapshot_leaves_live_stats() {
+  UiRenderer ui(display);
+  ui.render(state(FACE_NORMAL, 0, false));
+  UiRenderStats live = ui.stats();
+
+  UiRenderStats rs;
+  ui.snapshot(state(FACE_SURPRISED, 4, true), rs);
+  std::string snapshot = pbm(ui);
+  TEST_ASSERT_EQUAL_MEMORY(&live, &ui.stats(), sizeof(live));
+  TEST_ASSERT_GREATER_THAN(0, rs.ops.pixels + rs.ops.hlines + rs.ops.vlines);
+
+  ui.render(state(FACE_SURPRISED, 4, true));
+  TEST_ASSERT_TRUE(snapshot == pbm(ui));
+}
+
+// The size-2 text through the glyph atlas and through Adafruit_GFX (one
+// fillRect per font pixel): the same frames, and what each costs
+void test_atlas_text_matches_gfx() {
+  UiRenderer atlas(display), gfx(display);
+  atlas.setAtlas(true);
+  gfx.setAtlas(false);
+  uint64_t atlasText = 0, gfxText = 0, atlasOps = 0, gfxOps = 0;
+  uint64_t atlasFrame = 0, gfxFrame = 0;
+  int frames = 0;
+
+  for (int face = 0; face < FACE_COUNT; face++)
+    for (size_t sky = 0; sky < sizeof(SKIES) / sizeof(SKIES[0]); sky++)
+      for (int date = 0; date < 2; date++) {
+        UiState s = state(face, sky, date);
+        gfx.render(s);
+        std::string viaGfx = pbm(gfx);
+        atlas.render(s);
+        TEST_ASSERT_TRUE_MESSAGE(viaGfx == pbm(atlas),
+                                 frameName(face, sky, date).c_str());
+
+        for (int i = 0; i < RUNS; i++) {
+          gfx.render(s);
+          gfxText += gfx.stats().textMicros;
+          gfxFrame += gfx.stats().micros;
+          atlas.render(s);
+          atlasText += atlas.stats().textMicros;
+          atlasFrame += atlas.stats().micros;
+        }
+        const PixelOps &g = gfx.stats().ops, &a = atlas.stats().ops;
+        gfxOps += g.pixels + g.hlines + g.vlines;
+        atlasOps += a.pixels + a.hlines + a.vlines;
+        frames++;
+      }
+
+  double n = (double)frames * RUNS;
+  printf("per frame, %d states x %d   text us  frame us  GFX ops\n", frames,
+         RUNS);
+  printf("Adafruit_GFX fillRect      %8.2f  %8.2f  %7.0f\n", gfxText / n,
+         gfxFrame / n, gfxOps / (double)frames);
+  printf("glyph atlas                %8.2f  %8.2f  %7.0f\n", atlasText / n,
+         atlasFrame / n, atlasOps / (double)frames);
+  TEST_ASSERT_LESS_THAN(gfxOps, atlasOps);
+}
+
+int main() {
+  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  UNITY_BEGIN();
+  RUN_TEST(test_render_has_no_memory);
+  RUN_TEST(test_snapshot_leaves_live_stats);
+  RUN_TEST(test_frames_match_goldens);
+  RUN_TEST(test_atlas_text_matches_gfx);
+  return UNITY_END();
+}
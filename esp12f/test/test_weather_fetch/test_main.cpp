@@ -0,0 +1,206 @@
+// WeatherFetch against a local stand-in for the Open-Meteo API. The native
+// env points WEATHER_HOST/WEATHER_PORT at 127.0.0.1:18080, where each test
+// listens. Besides the result, every test checks that no loop() call held
+// the caller: the connect used to block for up to WEATHER_CONNECT_TIMEOUT.
+
+#include "weather_fetch.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unity.h>
+
+#define LOOP_BUDGET_US 20000 // one loop() call, generous for a loaded host
+
+static const char RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "{\"latitude\":-23.5,\"longitude\":-46.625,\"generationtime_ms\":0.03,"
+    "\"utc_offset_seconds\":-10800,\"timezone\":\"America/Sao_Paulo\","
+    "\"timezone_abbreviation\":\"GMT-3\",\"elevation\":760.0,"
+    "\"current_units\":{\"time\":\"iso8601\",\"interval\":\"seconds\","
+    "\"is_day\":\"\",\"weather_code\":\"wmo code\"},"
+    "\"current\":{\"time\":\"2025-10-09T21:45\",\"interval\":900,"
+    "\"is_day\":0,\"weather_code\":61}}";
+
+// Listening socket on WEATHER_PORT; serve() answers one request
+class StandIn {
+public:
+  explicit StandIn(int backlog = 4) {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(WEATHER_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(_fd, (sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(_fd, backlog));
+  }
+  ~StandIn() {
+    shutdown(_fd, SHUT_RDWR); // wakes a pending accept()
+    if (_thread.joinable())
+      _thread.join();
+    close(_fd);
+  }
+
+  // Replies after `delayMs`, in pieces of `piece` bytes
+  void serve(const char *response, unsigned delayMs, size_t piece = 0) {
+    _thread = std::thread([=] {
+      int c = accept(_fd, nullptr, nullptr);
+      if (c < 0)
+        return;
+      char buf[512];
+      std::string request;
+      while (request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(c, buf, sizeof(buf), 0);
+        if (n <= 0)
+          break;
+        request.append(buf, n);
+      }
+      usleep(delayMs * 1000);
+      size_t len = strlen(response), step = piece ? piece : len;
+      for (size_t off = 0; off < len; off += step) {
+        send(c, response + off, std::min(step, len - off), MSG_NOSIGNAL);
+        if (piece)
+          usleep(20000);
+      }
+      close(c);
+    });
+  }
+
+private:
+  int _fd;
+  std::thread _thread;
+};
+
+static StandIn *server; // torn down even when an assertion fails
+
+struct Run {
+  bool result = false;
+  unsigned long ms = 0;
+  uint32_t worstUs = 0; // longest single loop() call
+};
+
+static Run runFetch(WeatherFetch &wx, unsigned long limitMs) {
+  Run run;
+  unsigned long start = millis();
+  TEST_ASSERT_TRUE(wx.start(-23.55, -46.63));
+  while (wx.busy() && millis() - start < limitMs) {
+    uint32_t t0 = micros();
+    if (wx.loop(millis()))
+      run.result = true;
+    uint32_t us = micros() - t0;
+    if (us > run.worstUs)
+      run.worstUs = us;
+    delay(1);
+  }
+  run.ms = millis() - start;
+  return run;
+}
+
+void setUp() {}
+
+void tearDown() {
+  delete server;
+  server = nullptr;
+}
+
+void test_fetch_completes() {
+  server = new StandIn();
+  server->serve(RESPONSE, 0);
+  WeatherFetch wx;
+  Run run = runFetch(wx, 3000);
+
+  TEST_ASSERT_TRUE(run.result);
+  TEST_ASSERT_EQUAL(61, wx.weatherCode());
+  TEST_ASSERT_EQUAL(0, wx.isDay());
+  TEST_ASSERT_EQUAL(1, wx.stats().ok);
+  TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, run.worstUs);
+}
+
+// The server answers late and in pieces: headers and body are polled
+void test_slow_server_does_not_hold_loop() {
+  server = new StandIn();
+  server->serve(RESPONSE, 300, 64);
+  WeatherFetch wx;
+  Run run = runFetch(wx, 5000);
+
+  TEST_ASSERT_TRUE(run.result);
+  TEST_ASSERT_EQUAL(61, wx.weatherCode());
+  TEST_ASSERT_GREATER_OR_EQUAL(300, wx.stats().lastMs[WX_HEADERS]);
+  TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, run.worstUs);
+}
+
+// A body over WEATHER_BODY_MAX fails as soon as that much is buffered, with
+// or without a Content-Length, and is never handed to a waiting parser.
+void test_oversized_body_fails_without_holding_loop() {
+  std::string body(RESPONSE);
+  body.insert(body.size() - 2, ",\"pad\":\"" +
+                                   std::string(2 * WEATHER_BODY_MAX, 'x') +
+                                   "\"");
+  for (bool withLength : {false, true}) {
+    std::string response(body);
+    if (withLength) {
+      size_t head = response.find("\r\n\r\n") + 4;
+      response.insert(head - 2, "Content-Length: " +
+                                    std::to_string(response.size() - head) +
+                                    "\r\n");
+    }
+    server = new StandIn();
+    server->serve(response.c_str(), 0, 512);
+    WeatherFetch wx;
+    Run run = runFetch(wx, WEATHER_BODY_TIMEOUT + 2000);
+    delete server;
+    server = nullptr;
+
+    TEST_ASSERT_FALSE(run.result);
+    TEST_ASSERT_EQUAL(1, wx.stats().failed);
+    TEST_ASSERT_EQUAL(-1, wx.weatherCode());
+    TEST_ASSERT_LESS_THAN(WEATHER_BODY_TIMEOUT, run.ms);
+    TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, run.worstUs);
+  }
+}
+
+void test_connect_refused() {
+  WeatherFetch wx; // nothing listening
+  Run run = runFetch(wx, 3000);
+
+  TEST_ASSERT_FALSE(run.result);
+  TEST_ASSERT_EQUAL(1, wx.stats().failed);
+  TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, run.worstUs);
+}
+
+// A server whose accept queue is full drops the SYN, so the connect stays
+// pending until WEATHER_CONNECT_TIMEOUT: the case that used to block.
+void test_pending_connect_times_out_without_blocking() {
+  server = new StandIn(0);
+  WiFiClient filler[2]; // fill the accept queue, never accepted
+  for (WiFiClient &c : filler)
+    c.beginConnect(IPAddress(127, 0, 0, 1), WEATHER_PORT);
+  delay(50);
+
+  WeatherFetch wx;
+  Run run = runFetch(wx, WEATHER_CONNECT_TIMEOUT + 2000);
+
+  TEST_ASSERT_FALSE(run.result);
+  TEST_ASSERT_FALSE(wx.busy());
+  TEST_ASSERT_EQUAL(1, wx.stats().failed);
+  TEST_ASSERT_GREATER_THAN(WEATHER_CONNECT_TIMEOUT - 1,
+                           wx.stats().lastMs[WX_CONNECT]);
+  TEST_ASSERT_LESS_THAN(LOOP_BUDGET_US, run.worstUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fetch_completes);
+  RUN_TEST(test_slow_server_does_not_hold_loop);
+  RUN_TEST(test_oversized_body_fails_without_holding_loop);
+  RUN_TEST(test_connect_refused);
+  RUN_TEST(test_pending_connect_times_out_without_blocking);
+  return UNITY_END();
+}
@@ -0,0 +1,191 @@
+// Peak heap and time of the Open-Meteo parse: the old path (whole body in
+// a String, as http.getString() left it, then an unfiltered document) next
+// to the filtered parse streamed from the client that WeatherFetch does.
+//
+// Bodies have the shape Open-Meteo returns: the `current` block the
+// firmware asks for, and the same with a day and a week of hourly data, for
+// a response that grows. Heap is what PeakAllocator saw plus, for the old
+// path, the body String. Host numbers: sizes are 64-bit ones, so larger
+// than on the ESP8266, but the comparison holds.
+//
+// The numbers are ArduinoJson's only when the test is built the way the
+// native env builds it, against the library from lib_deps:
+//
+//   pio test -e native -f test_weather_parse
+//
+// Built against anything else (a stand-in header without
+// ARDUINOJSON_VERSION), it still checks the two paths agree, but the
+// table describes the stand-in, and its first line says so.
+
+#include "peak_allocator.h"
+#include <ArduinoJson.h>
+#include <string>
+#include <unity.h>
+
+#define RUNS 200
+
+#ifdef ARDUINOJSON_VERSION
+#define JSON_LIBRARY "ArduinoJson " ARDUINOJSON_VERSION
+#else
+#define JSON_LIBRARY "an ArduinoJson stand-in: not the library's numbers"
+#endif
+
+static const char CURRENT[] =
+    "{\"latitude\":-23.5,\"longitude\":-46.625,\"generationtime_ms\":0.03,"
+    "\"utc_offset_seconds\":-10800,\"timezone\":\"America/Sao_Paulo\","
+    "\"timezone_abbreviation\":\"GMT-3\",\"elevation\":760.0,"
+    "\"current_units\":{\"time\":\"iso8601\",\"interval\":\"seconds\","
+    "\"is_day\":\"\",\"weather_code\":\"wmo code\"},"
+    "\"current\":{\"time\":\"2025-10-09T21:45\",\"interval\":900,"
+    "\"is_day\":0,\"weather_code\":61}";
+
+// CURRENT plus `hours` of hourly time/temperature/humidity/weather code
+static std::string withHourly(int hours) {
+  std::string body(CURRENT);
+  body += ",\"hourly_units\":{\"time\":\"iso8601\",\"temperature_2m\":"
+          "\"\\u00b0C\",\"relative_humidity_2m\":\"%\",\"weather_code\":"
+          "\"wmo code\"},\"hourly\":{\"time\":[";
+  char item[40];
+  for (int h = 0; h < hours; h++) {
+    snprintf(item, sizeof(item), "%s\"2025-10-%02dT%02d:00\"", h ? "," : "",
+             9 + h / 24, h % 24);
+    body += item;
+  }
+  const char *series[] = {"temperature_2m", "relative_humidity_2m",
+                          "weather_code"};
+  for (const char *name : series) {
+    body += "],\"";
+    body += name;
+    body += "\":[";
+    for (int h = 0; h < hours; h++) {
+      if (name[0] == 't')
+        snprintf(item, sizeof(item), "%s%d.%d", h ? "," : "", 14 + h % 12,
+                 h % 10);
+      else
+        snprintf(item, sizeof(item), "%s%d", h ? "," : "",
+                 name[0] == 'r' ? 40 + h % 50 : (h % 7) * 10);
+      body += item;
+    }
+  }
+  body += "]}";
+  return body;
+}
+
+static std::string closed(const std::string &body) { return body + "}"; }
+
+// The response body as the client stream deserializeJson() reads from
+class BodyStream : public Stream {
+public:
+  explicit BodyStream(const std::string &body) : _body(body), _pos(0) {}
+  int available() override { return _body.size() - _pos; }
+  int read() override {
+    return _pos < _body.size() ? (uint8_t)_body[_pos++] : -1;
+  }
+  int peek() override { return _pos < _body.size() ? (uint8_t)_body[_pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  const std::string &_body;
+  size_t _pos;
+};
+
+struct Result {
+  size_t peak;
+  uint32_t micros; // per parse
+  int code, isDay;
+};
+
+static Result oldPath(const std::string &body) {
+  Result r = {};
+  uint32_t t0 = micros();
+  for (int i = 0; i < RUNS; i++) {
+    PeakAllocator alloc;
+    String payload(body.c_str()); // http.getString()
+    JsonDocument doc(&alloc);
+    TEST_ASSERT_FALSE(deserializeJson(doc, payload));
+    r.code = doc["current"]["weather_code"];
+    r.isDay = doc["current"]["is_day"];
+    r.peak = payload.length() + 1 + alloc.peak();
+  }
+  r.micros = (micros() - t0) / RUNS;
+  return r;
+}
+
+static Result filteredPath(const std::string &body) {
+  JsonDocument filter; // as WeatherFetch::parseBody()
+  filter["current"]["is_day"] = true;
+  filter["current"]["weather_code"] = true;
+
+  Result r = {};
+  uint32_t t0 = micros();
+  for (int i = 0; i < RUNS; i++) {
+    BodyStream stream(body);
+    PeakAllocator alloc;
+    JsonDocument doc(&alloc);
+    TEST_ASSERT_FALSE(
+        deserializeJson(doc, stream, DeserializationOption::Filter(filter)));
+    r.code = doc["current"]["weather_code"];
+    r.isDay = doc["current"]["is_day"];
+    r.peak = alloc.peak();
+  }
+  r.micros = (micros() - t0) / RUNS;
+  return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_filtered_parse_peak_is_independent_of_body_size() {
+  const struct {
+    const char *name;
+    std::string body;
+  } bodies[] = {
+      {"current", closed(CURRENT)},
+      {"current+24h", closed(withHourly(24))},
+      {"current+168h", closed(withHourly(168))},
+  };
+
+  printf("parsed with %s (host build)\n", JSON_LIBRARY);
+  printf("%-13s %7s %10s %8s %10s %8s\n", "response", "bytes", "old peak",
+         "old us", "new peak", "new us");
+  size_t firstPeak = 0;
+  for (const auto &b : bodies) {
+    Result before = oldPath(b.body);
+    Result after = filteredPath(b.body);
+    printf("%-13s %7u %10u %8u %10u %8u\n", b.name, (unsigned)b.body.size(),
+           (unsigned)before.peak, (unsigned)before.micros,
+           (unsigned)after.peak, (unsigned)after.micros);
+
+    TEST_ASSERT_EQUAL(61, after.code);
+    TEST_ASSERT_EQUAL(0, after.isDay);
+    TEST_ASSERT_EQUAL(before.code, after.code);
+    TEST_ASSERT_EQUAL(before.isDay, after.isDay);
+    TEST_ASSERT_GREATER_THAN(b.body.size(), before.peak);
+    TEST_ASSERT_LESS_THAN(1024, after.peak);
+    if (!firstPeak)
+      firstPeak = after.peak;
+    TEST_ASSERT_EQUAL(firstPeak, after.peak);
+  }
+}
+
+// The peak is a high-water mark: it must not drop back once the document
+// shrinks, which is what the before/after free-heap difference measured.
+void test_peak_allocator_keeps_high_water_mark() {
+  PeakAllocator alloc;
+  void *a = alloc.allocate(100);
+  void *b = alloc.allocate(300);
+  alloc.deallocate(b);
+  a = alloc.reallocate(a, 50);
+  TEST_ASSERT_EQUAL(50, alloc.current());
+  TEST_ASSERT_EQUAL(400, alloc.peak());
+  alloc.deallocate(a);
+  TEST_ASSERT_EQUAL(0, alloc.current());
+  TEST_ASSERT_EQUAL(400, alloc.peak());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_peak_allocator_keeps_high_water_mark);
+  RUN_TEST(test_filtered_parse_peak_is_independent_of_body_size);
+  return UNITY_END();
+}
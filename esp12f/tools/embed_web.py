@@ -0,0 +1,107 @@
+"""
+Embeds the pages in web/ into include/web_assets.h.
+
+Runs as a PlatformIO pre-build script (extra_scripts = pre:tools/embed_web.py)
+and can also be run by hand: python tools/embed_web.py
+
+Each page is lightly minified (indentation, blank lines, HTML comments and
+whole-line // comments removed; lines are kept so JS semicolon insertion is
+unaffected), gzipped, and written out as a WebAsset with both the gzip and
+the plain body. Each body gets its own strong ETag, derived from the
+minified text, with "-gz" on the gzip one: the two are different
+representations, so a cache holding one must not revalidate as the other.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+# (source file, C identifier, content type)
+ASSETS = [
+    ("dashboard.html", "DASHBOARD_ASSET", "text/html"),
+    ("portal.html", "PORTAL_ASSET", "text/html"),
+]
+
+OUTPUT = os.path.join("include", "web_assets.h")
+
+
+def minify(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("//"):
+            continue
+        lines.append(line)
+    return "\n".join(lines)
+
+
+def c_bytes(data, indent="    ", per_line=16):
+    rows = []
+    for i in range(0, len(data), per_line):
+        rows.append(indent + ", ".join("0x%02x" % b for b in data[i:i + per_line]))
+    return ",\n".join(rows)
+
+
+def c_string(text):
+    out = []
+    for line in text.split("\n"):
+        line = line.replace("\\", "\\\\").replace('"', '\\"')
+        out.append('    "%s\\n"' % line)
+    return "\n".join(out)
+
+
+def render(project_dir):
+    parts = [
+        "// Generated by tools/embed_web.py from web/ -- do not edit.",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        '#include "web_asset.h"',
+        "",
+    ]
+    for source, name, content_type in ASSETS:
+        with open(os.path.join(project_dir, "web", source), encoding="utf-8") as f:
+            plain = minify(f.read()).encode("utf-8")
+        packed = gzip.compress(plain, compresslevel=9, mtime=0)
+        digest = hashlib.sha1(plain).hexdigest()[:16]
+        etag = '\\"%s\\"' % digest
+        etag_gz = '\\"%s-gz\\"' % digest
+
+        parts += [
+            "// %s: %d bytes minified, %d bytes gzipped" % (source, len(plain), len(packed)),
+            "static const uint8_t %s_GZ[] PROGMEM = {" % name,
+            c_bytes(packed),
+            "};",
+            "static const char %s_PLAIN[] PROGMEM =" % name,
+            c_string(plain.decode("utf-8")) + ";",
+            "static const WebAsset %s = {" % name,
+            '    "%s", %s_PLAIN, %d, %s_GZ, %d, "%s", "%s"};'
+            % (content_type, name, len(plain), name, len(packed), etag, etag_gz),
+            "",
+        ]
+    parts += ["#endif // WEB_ASSETS_H", ""]
+    return "\n".join(parts)
+
+
+def generate(project_dir):
+    output = os.path.join(project_dir, OUTPUT)
+    content = render(project_dir)
+    try:
+        with open(output, encoding="utf-8") as f:
+            if f.read() == content:
+                return  # unchanged: keep the timestamp so nothing rebuilds
+    except OSError:
+        pass
+    with open(output, "w", encoding="utf-8") as f:
+        f.write(content)
+    print("embed_web: wrote %s" % OUTPUT)
+
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,110 @@
+"""
+Builds include/glyph_atlas.h: Org_01 glyphs pre-scaled for setTextSize(2).
+
+Runs as a PlatformIO pre-build script (extra_scripts) and can also be run by
+hand: python tools/gen_glyph_atlas.py
+
+Adafruit_GFX draws a scaled custom-font glyph as one fillRect per source
+pixel. The atlas stores each glyph already scaled, as one uint16_t per
+screen column (bit 0 = top row), which is the SSD1306 buffer layout: the
+blitter in src/text_blit.cpp ORs a column into two or three page bytes.
+Only the characters the big UI text uses are included (' ' .. ':'), the
+rest fall back to Adafruit_GFX.
+"""
+
+import os
+import re
+
+FONT = os.path.join("include", "Org_01.h")
+OUTPUT = os.path.join("include", "glyph_atlas.h")
+SCALE = 2
+FIRST, LAST = 0x20, 0x3A  # ' ' .. ':' (digits, '%', '-', '/', ':')
+
+
+def parse_font(text):
+    bitmaps = re.search(r"Org_01Bitmaps\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", text, re.S)
+    data = [int(b, 16) for b in re.findall(r"0x[0-9A-Fa-f]{2}", bitmaps.group(1))]
+    glyphs = re.search(r"Org_01Glyphs\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", text, re.S)
+    table = [tuple(int(v) for v in g.split(","))
+             for g in re.findall(r"\{\s*(-?\d+(?:\s*,\s*-?\d+){5})\s*\}", glyphs.group(1))]
+    first = int(re.search(r"Org_01Glyphs,\s*(0x[0-9A-Fa-f]+)", text).group(1), 16)
+    return data, table, first
+
+
+def scaled_columns(data, glyph):
+    offset, w, h = glyph[0], glyph[1], glyph[2]
+    cols = [0] * (w * SCALE)
+    for yy in range(h):
+        for xx in range(w):
+            bit = yy * w + xx
+            if data[offset + bit // 8] & (0x80 >> (bit % 8)):
+                for sx in range(SCALE):
+                    for sy in range(SCALE):
+                        cols[xx * SCALE + sx] |= 1 << (yy * SCALE + sy)
+    return cols
+
+
+def render(project_dir):
+    with open(os.path.join(project_dir, FONT), encoding="utf-8") as f:
+        data, table, font_first = parse_font(f.read())
+
+    columns = []
+    entries = []
+    for code in range(FIRST, LAST + 1):
+        g = table[code - font_first]
+        assert g[2] * SCALE <= 16, "glyph too tall for a uint16_t column"
+        cols = scaled_columns(data, g)
+        entries.append("    {%d, %d, %d, %d, %d}, // 0x%02X '%s'" % (
+            len(columns), len(cols), g[3] * SCALE, g[4] * SCALE, g[5] * SCALE,
+            code, chr(code)))
+        columns += cols
+
+    rows = []
+    for i in range(0, len(columns), 12):
+        rows.append("    " + ", ".join("0x%04x" % c for c in columns[i:i + 12]))
+
+    return "\n".join([
+        "// Generated by tools/gen_glyph_atlas.py from %s -- do not edit." % FONT.replace(os.sep, "/"),
+        "#ifndef GLYPH_ATLAS_H",
+        "#define GLYPH_ATLAS_H",
+        "",
+        '#include "atlas_glyph.h"',
+        "",
+        "#define ATLAS_SCALE %d" % SCALE,
+        "#define ATLAS_FIRST 0x%02X" % FIRST,
+        "#define ATLAS_LAST 0x%02X" % LAST,
+        "",
+        "// %d columns, %d bytes" % (len(columns), len(columns) * 2),
+        "static const uint16_t ATLAS_COLUMNS[] PROGMEM = {",
+        ",\n".join(rows),
+        "};",
+        "",
+        "static const AtlasGlyph ATLAS_GLYPHS[] PROGMEM = {",
+        "\n".join(entries),
+        "};",
+        "",
+        "#endif // GLYPH_ATLAS_H",
+        "",
+    ])
+
+
+def generate(project_dir):
+    output = os.path.join(project_dir, OUTPUT)
+    content = render(project_dir)
+    try:
+        with open(output, encoding="utf-8") as f:
+            if f.read() == content:
+                return  # unchanged: keep the timestamp so nothing rebuilds
+    except OSError:
+        pass
+    with open(output, "w", encoding="utf-8") as f:
+        f.write(content)
+    print("gen_glyph_atlas: wrote %s" % OUTPUT)
+
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
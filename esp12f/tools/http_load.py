@@ -0,0 +1,207 @@
+"""
+Loads the esp12f web server with concurrent pollers and reports what it did
+to loop() latency, from the device's own /metrics histograms.
+
+    python tools/http_load.py 192.168.0.50
+    python tools/http_load.py 192.168.0.50 --pollers 10 --seconds 60 \\
+        --slow 2 --save after.json --compare before.json
+    python tools/http_load.py 127.0.0.1:18081 --path /metrics
+
+Each poller fetches /data over a fresh connection, like the dashboard
+does, every --interval seconds (0 = back to back); --path sets another
+route, e.g. /metrics or /frame.pbm for the large generated bodies. The
+host may carry a port, as for the host build in test/test_http_server. --slow adds clients that
+trickle their request out a byte at a time, the case that used to hold
+loop() for a whole request. The histograms are reset (/metrics?reset=1)
+before the run and read after it, so they cover the load only.
+
+The report has the client side (requests, errors, latency) and, per loop
+section, count, p50/p99 (upper bound of the bucket they fall in), max and
+passes over the stall threshold. --save writes it as JSON; --compare prints
+a saved run next to this one, e.g. the firmware before and after a change.
+"""
+
+import argparse
+import collections
+import json
+import re
+import socket
+import sys
+import threading
+import time
+import urllib.request
+
+SAMPLE = re.compile(r'^(esp12f_\w+)(?:\{([^}]*)\})? (\S+)$')
+
+
+def scrape(host, reset=False):
+    url = "http://%s/metrics%s" % (host, "?reset=1" if reset else "")
+    with urllib.request.urlopen(url, timeout=10) as resp:
+        text = resp.read().decode()
+    samples = []
+    for line in text.splitlines():
+        m = SAMPLE.match(line)
+        if m:
+            labels = dict(re.findall(r'(\w+)="([^"]*)"', m.group(2) or ""))
+            samples.append((m.group(1), labels, float(m.group(3))))
+    return samples
+
+
+def sections(samples):
+    """Per section: count, p50/p99 bucket bounds (ms), max (ms), stalls."""
+    buckets = collections.defaultdict(list)
+    out = collections.OrderedDict()
+    for name, labels, value in samples:
+        s = labels.get("section")
+        if not s:
+            continue
+        row = out.setdefault(s, {})
+        if name == "esp12f_loop_section_seconds_bucket":
+            buckets[s].append((float(labels["le"]), value))
+        elif name == "esp12f_loop_section_seconds_count":
+            row["count"] = int(value)
+        elif name == "esp12f_loop_section_max_seconds":
+            row["max"] = value * 1000
+        elif name == "esp12f_loop_section_stalls_total":
+            row["stalls"] = int(value)
+    for s, row in out.items():
+        total = row.get("count", 0)
+        for q in (50, 99):
+            le = float("inf")
+            for bound, cumulative in buckets[s]:
+                if total and cumulative >= total * q / 100.0:
+                    le = bound
+                    break
+            row["p%d" % q] = le * 1000 if total else 0
+    return out
+
+
+class Client:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = []
+        self.errors = collections.Counter()
+
+    def record(self, seconds=None, error=None):
+        with self.lock:
+            if error:
+                self.errors[error] += 1
+            else:
+                self.latencies.append(seconds)
+
+
+def poller(host, path, interval, stop, client):
+    while not stop.is_set():
+        t0 = time.monotonic()
+        try:
+            with urllib.request.urlopen("http://%s%s" % (host, path),
+                                        timeout=10) as resp:
+                resp.read()
+            client.record(time.monotonic() - t0)
+        except Exception as e:  # noqa: BLE001 - counted, the run goes on
+            client.record(error=type(e).__name__)
+        stop.wait(max(0.0, interval - (time.monotonic() - t0)))
+
+
+def slow_client(host, stop, client):
+    request = b"GET /data HTTP/1.1\r\nHost: %s\r\n\r\n" % host.encode()
+    name, _, port = host.partition(":")
+    while not stop.is_set():
+        t0 = time.monotonic()
+        try:
+            with socket.create_connection((name, int(port or 80)),
+                                          timeout=10) as s:
+                for i in range(len(request)):
+                    s.sendall(request[i:i + 1])
+                    if stop.wait(0.05):
+                        return
+                while s.recv(512):
+                    pass
+            client.record(time.monotonic() - t0)
+        except Exception as e:  # noqa: BLE001
+            client.record(error=type(e).__name__)
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * q / 100.0))]
+
+
+def print_report(run, other=None):
+    c = run["client"]
+    errors = " ".join("%s=%d" % e for e in sorted(c["errors"].items()))
+    print("client: %d requests, %d errors%s, p50 %.0f ms, p99 %.0f ms" % (
+        c["requests"], sum(c["errors"].values()),
+        " (%s)" % errors if errors else "", c["p50"], c["p99"]))
+    if other:
+        o = other["client"]
+        print("  was: %d requests, %d errors, p50 %.0f ms, p99 %.0f ms" % (
+            o["requests"], sum(o["errors"].values()), o["p50"], o["p99"]))
+    print()
+    print("%-8s %8s %9s %9s %9s %7s" % ("section", "count", "p50 ms",
+                                        "p99 ms", "max ms", "stalls"))
+    for s, row in run["sections"].items():
+        print("%-8s %8d %9.2f %9.2f %9.2f %7d" % (
+            s, row.get("count", 0), row["p50"], row["p99"],
+            row.get("max", 0), row.get("stalls", 0)))
+        was = other and other["sections"].get(s)
+        if was:
+            print("%-8s %8d %9.2f %9.2f %9.2f %7d" % (
+                "  was", was.get("count", 0), was["p50"], was["p99"],
+                was.get("max", 0), was.get("stalls", 0)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("host", help="device address[:port]")
+    ap.add_argument("--pollers", type=int, default=10)
+    ap.add_argument("--path", default="/data", help="route the pollers fetch")
+    ap.add_argument("--interval", type=float, default=0.5,
+                    help="seconds between one poller's requests")
+    ap.add_argument("--slow", type=int, default=0,
+                    help="clients sending their request a byte at a time")
+    ap.add_argument("--seconds", type=float, default=30)
+    ap.add_argument("--save", help="write this run as JSON")
+    ap.add_argument("--compare", help="a run saved with --save")
+    args = ap.parse_args()
+
+    scrape(args.host, reset=True)
+    client = Client()
+    stop = threading.Event()
+    threads = [threading.Thread(target=poller,
+                                args=(args.host, args.path, args.interval,
+                                      stop, client))
+               for _ in range(args.pollers)]
+    threads += [threading.Thread(target=slow_client,
+                                 args=(args.host, stop, client))
+                for _ in range(args.slow)]
+    for t in threads:
+        t.start()
+    time.sleep(args.seconds)
+    stop.set()
+    for t in threads:
+        t.join()
+
+    ms = [x * 1000 for x in client.latencies]
+    run = {
+        "pollers": args.pollers, "path": args.path, "slow": args.slow,
+        "seconds": args.seconds,
+        "client": {"requests": len(ms), "errors": dict(client.errors),
+                   "p50": percentile(ms, 50), "p99": percentile(ms, 99)},
+        "sections": sections(scrape(args.host)),
+    }
+    other = None
+    if args.compare:
+        with open(args.compare) as f:
+            other = json.load(f)
+    print_report(run, other)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(run, f, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
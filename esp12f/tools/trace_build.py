@@ -0,0 +1,202 @@
+"""
+Builds input traces for the host replay (test/test_replay, the firmware's
+LoopLogic on a virtual clock) and summarises the event logs it writes.
+
+    python tools/trace_build.py build gps.nmea -o trace.txt
+    python tools/trace_build.py build gps.nmea --dht dht.csv --vcc vcc.csv \\
+        --repeat 24 --seed 7 -o trace.txt
+    TRACE=trace.txt RENDER=1 pio test -e native -f test_replay
+    python tools/trace_build.py report .pio/test_replay/events.txt
+
+build: NMEA sentences are timed from their own UTC field (RMC/GGA/GLL/ZDA;
+other sentences share the time of the last one seen), so a raw log from
+the module or `pio device monitor` replays at the speed it was recorded.
+--dht takes "seconds,temp_c,hum_pct" and --vcc "seconds,mV" CSV files,
+seconds counted from the start of the trace. --repeat plays the inputs
+back to back N times (the NMEA clock is shifted so time keeps moving).
+
+report: prints time spent in each face, fix changes, weather fetch attempts
+and the redraws, with the share that changed no pixel when the replay
+rendered them (RENDER=1).
+"""
+
+import argparse
+import collections
+import csv
+import sys
+
+TIMED = ("RMC", "GGA", "GLL", "ZDA")
+FACES = ["normal", "happy", "sleepy", "surprised", "look"]  # FaceState
+
+
+def checksum(body):
+    c = 0
+    for ch in body:
+        c ^= ord(ch)
+    return c
+
+
+def with_time(sentence, seconds):
+    """Sentence with its hhmmss.ss field set to `seconds` past midnight (the
+    date is left alone, so a repeated trace may replay the same day)."""
+    body = sentence[1:sentence.index("*")]
+    fields = body.split(",")
+    i = 5 if fields[0].endswith("GLL") and len(fields) > 5 else 1
+    s = seconds % 86400
+    frac = fields[i].split(".", 1)[1] if "." in fields[i] else ""
+    fields[i] = "%02d%02d%02d" % (s // 3600, s // 60 % 60, s % 60)
+    if frac:
+        fields[i] += "." + frac
+    body = ",".join(fields)
+    return "$%s*%02X" % (body, checksum(body))
+
+
+def utc_seconds(sentence):
+    fields = sentence.split(",")
+    kind = fields[0][-3:]
+    if kind not in TIMED:
+        return None
+    field = fields[5] if kind == "GLL" and len(fields) > 5 else fields[1]
+    if len(field) < 6 or not field[:6].isdigit():
+        return None
+    return int(field[:2]) * 3600 + int(field[2:4]) * 60 + float(field[4:])
+
+
+def read_nmea(path):
+    """[(ms from the first timed sentence, sentence)], midnight-safe."""
+    out, start, last, wrap = [], None, None, 0.0
+    with open(path, errors="replace") as f:
+        for line in f:
+            i = line.find("$")
+            if i < 0 or "*" not in line[i:]:
+                continue
+            sentence = line[i:].strip()
+            t = utc_seconds(sentence)
+            if t is not None:
+                if last is not None and t + wrap < last - 43200:
+                    wrap += 86400
+                last = t + wrap
+                if start is None:
+                    start = last
+            if last is None:
+                continue  # nothing to time it by yet
+            out.append((int(round((last - start) * 1000)), sentence))
+    return out
+
+
+def read_csv(path, cols):
+    rows = []
+    with open(path) as f:
+        for row in csv.reader(f):
+            try:
+                rows.append([float(v) for v in row[:cols]])
+            except ValueError:
+                continue  # header
+    return rows
+
+
+def build(args):
+    nmea = read_nmea(args.nmea)
+    if not nmea:
+        sys.exit("%s: no timed NMEA sentences" % args.nmea)
+    dht = read_csv(args.dht, 3) if args.dht else []
+    vcc = read_csv(args.vcc, 2) if args.vcc else []
+
+    span = max([nmea[-1][0]] + [int(r[0] * 1000) for r in dht + vcc]) + 1000
+    lines = []
+    for n in range(args.repeat):
+        offset = n * span
+        for ms, s in nmea:
+            if n:
+                t = utc_seconds(s)
+                if t is not None:
+                    s = with_time(s, int(t + offset / 1000))
+            lines.append((ms + offset, 0, s))
+        for t, temp, hum in dht:
+            lines.append((int(t * 1000) + offset, 1,
+                          "D %d %d" % (round(temp * 10), round(hum * 10))))
+        for t, mv in vcc:
+            lines.append((int(t * 1000) + offset, 2, "V %d" % mv))
+    lines.sort(key=lambda x: (x[0], x[1]))
+
+    with open(args.output, "w") as f:
+        f.write("# %s x%d\n" % (args.nmea, args.repeat))
+        f.write("seed %d\n" % args.seed)
+        for ms, _, text in lines:
+            f.write("%d %s\n" % (ms, text))
+    size = sum(len(t) + 12 for _, _, t in lines)
+    print("%s: %d lines, %.1f h, ~%d KB" % (args.output, len(lines),
+                                           lines[-1][0] / 3.6e6, size // 1024))
+
+
+def read_events(path):
+    events = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) >= 3 and parts[0].isdigit() and len(parts[1]) == 1:
+                events.append((int(parts[0]), parts[1],
+                               [int(p) for p in parts[2:]]))
+    return events
+
+
+def report(args):
+    events = read_events(args.events)
+    if not events:
+        sys.exit("%s: no events" % args.events)
+    end = events[-1][0]
+    in_face = collections.Counter()
+    face, since = 0, 0
+    fixes = lost = fetches = frames = wasted = 0
+    rendered = False
+    for ms, kind, v in events:
+        if kind == "F":
+            in_face[face] += ms - since
+            face, since = v[0], ms
+        elif kind == "X":
+            fixes += v[0] == 1
+            lost += v[0] == 0
+        elif kind == "W":
+            fetches += 1
+        elif kind == "R":
+            frames += v[0]
+            if len(v) > 1:
+                rendered = True
+                wasted += v[1]
+    in_face[face] += end - since
+
+    hours = end / 3.6e6
+    print("%.1f h simulated, %d events" % (hours, len(events)))
+    for i, name in enumerate(FACES):
+        print("  %-10s %6.1f%%" % (name, 100.0 * in_face[i] / end if end else 0))
+    print("fix gained %d, lost %d" % (fixes, lost))
+    print("weather fetches %d (%.1f/h)" % (fetches, fetches / hours if hours else 0))
+    print("redraws %d (%.1f/min)" % (frames, frames / (end / 60000) if end else 0),
+          end="")
+    if rendered:
+        print(", %d changed nothing (%.1f%%)" % (
+            wasted, 100.0 * wasted / frames if frames else 0), end="")
+    print()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    b = sub.add_parser("build", help="NMEA/DHT/VCC logs -> trace.txt")
+    b.add_argument("nmea")
+    b.add_argument("--dht", help="seconds,temp_c,hum_pct CSV")
+    b.add_argument("--vcc", help="seconds,mV CSV")
+    b.add_argument("--repeat", type=int, default=1)
+    b.add_argument("--seed", type=int, default=1)
+    b.add_argument("-o", "--output", default="trace.txt")
+    r = sub.add_parser("report", help="summarise a replay event log")
+    r.add_argument("events", help=".pio/test_replay/events.txt")
+    args = ap.parse_args()
+    if args.cmd == "build":
+        build(args)
+    else:
+        report(args)
+
+
+if __name__ == "__main__":
+    main()
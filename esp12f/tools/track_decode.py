@@ -0,0 +1,264 @@
+"""
+Decodes GPS tracks recorded by TrackLog (src/track_log.cpp).
+
+    python tools/track_decode.py track.old track.bin          # summary
+    python tools/track_decode.py track.bin --csv track.csv    # export
+    python tools/track_decode.py --encode track.csv out.bin   # re-encode
+    python tools/track_decode.py track.bin --simplify 5       # simplifier
+
+The summary doubles as the size benchmark: it compares the binary log with
+the same fixes written as CSV ("epoch,lat,lon" with 6 decimals, what the
+device would otherwise have to store). --encode runs the device encoder on
+an existing CSV, so any recorded track can be measured without hardware.
+
+Format: "TRK1", then records starting with a varint h. h == 0 is a
+keyframe (uint32 epoch, int32 lat, int32 lon, little endian, microdegrees);
+h > 0 is a delta: h seconds, then zig-zag varint lat and lon differences.
+
+--simplify runs the device's streaming simplifier (src/track_simplify.cpp)
+on the fixes alongside a full Douglas-Peucker with the same tolerance, and
+reports the points each keeps and the worst deviation of the original
+fixes from each result. Use it on logs recorded with simplification off
+(TRACK_TOLERANCE_M=0 keeps all but exactly collinear fixes) to tune it.
+"""
+
+import argparse
+import math
+import struct
+import sys
+
+MAGIC = b"TRK1"
+# Must match include/track_log.h
+BLOCK = 256
+KEYFRAME_EVERY = 64
+RECORD_MAX = 15
+# Must match include/track_simplify.h
+WINDOW = 32
+M_PER_UDEG = 0.1113195
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def zigzag(v):
+    return ((v << 1) ^ (v >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode(data):
+    """Yields (epoch, lat_e6, lon_e6, is_keyframe)."""
+    if data[:4] != MAGIC:
+        raise ValueError("not a track file (bad magic)")
+    pos = 4
+    epoch = lat = lon = None
+    while pos < len(data):
+        try:
+            h, pos = read_varint(data, pos)
+            if h == 0:
+                epoch, lat, lon = struct.unpack_from("<Iii", data, pos)
+                pos += 12
+                yield epoch, lat, lon, True
+                continue
+            if epoch is None:
+                raise ValueError("delta before the first keyframe")
+            dlat, pos = read_varint(data, pos)
+            dlon, pos = read_varint(data, pos)
+        except (IndexError, struct.error):
+            sys.stderr.write("truncated record at offset %d\n" % pos)
+            return
+        epoch += h
+        lat += unzigzag(dlat)
+        lon += unzigzag(dlon)
+        yield epoch, lat, lon, False
+
+
+def put_varint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def encode(fixes):
+    """Same rules as TrackLog::add(): blocks, keyframe per block/interval."""
+    out = bytearray(MAGIC)
+    block = 0
+    since_key = 0
+    last = None
+    for epoch, lat, lon in fixes:
+        if block + RECORD_MAX > BLOCK:
+            block = 0
+        rec = bytearray()
+        if block == 0 or since_key >= KEYFRAME_EVERY or epoch <= last[0]:
+            rec.append(0)
+            rec += struct.pack("<Iii", epoch, lat, lon)
+            since_key = 0
+        else:
+            put_varint(rec, epoch - last[0])
+            put_varint(rec, zigzag(lat - last[1]))
+            put_varint(rec, zigzag(lon - last[2]))
+            since_key += 1
+        out += rec
+        block += len(rec)
+        last = (epoch, lat, lon)
+    return bytes(out)
+
+
+def offset_m(a, b, p, kx):
+    """Distance in metres from p to segment a-b (local flat projection)."""
+    bx, by = (b[2] - a[2]) * kx, (b[1] - a[1]) * M_PER_UDEG
+    px, py = (p[2] - a[2]) * kx, (p[1] - a[1]) * M_PER_UDEG
+    len2 = bx * bx + by * by
+    t = (px * bx + py * by) / len2 if len2 > 0 else 0.0
+    t = min(max(t, 0.0), 1.0)
+    return math.hypot(px - t * bx, py - t * by)
+
+
+def lon_scale(lat):
+    return M_PER_UDEG * math.cos(math.radians(lat / 1e6))
+
+
+def simplify_stream(fixes, tol):
+    """Python port of TrackSimplifier: sliding window, constant memory."""
+    out = []
+    anchor = None
+    window = []
+    for p in fixes:
+        if anchor is None:
+            anchor = p
+            out.append(p)
+            continue
+        kx = lon_scale(anchor[1])
+        if len(window) < WINDOW and all(
+                offset_m(anchor, p, w, kx) <= tol for w in window):
+            window.append(p)
+            continue
+        anchor = window[-1]
+        out.append(anchor)
+        window = [p]
+    if window:
+        out.append(window[-1])
+    return out
+
+
+def simplify_reference(fixes, tol):
+    """Classic Douglas-Peucker over the whole track."""
+    if len(fixes) < 3:
+        return list(fixes)
+    keep = [False] * len(fixes)
+    keep[0] = keep[-1] = True
+    stack = [(0, len(fixes) - 1)]
+    while stack:
+        lo, hi = stack.pop()
+        kx = lon_scale(fixes[lo][1])
+        worst, at = 0.0, -1
+        for i in range(lo + 1, hi):
+            d = offset_m(fixes[lo], fixes[hi], fixes[i], kx)
+            if d > worst:
+                worst, at = d, i
+        if worst > tol:
+            keep[at] = True
+            stack += [(lo, at), (at, hi)]
+    return [f for f, k in zip(fixes, keep) if k]
+
+
+def max_error(fixes, kept):
+    """Worst distance of an original fix from the simplified polyline."""
+    worst = 0.0
+    j = 0
+    for p in fixes:
+        while j + 1 < len(kept) - 1 and kept[j + 1][0] < p[0]:
+            j += 1
+        if j + 1 < len(kept):
+            a, b = kept[j], kept[j + 1]
+            worst = max(worst, offset_m(a, b, p, lon_scale(a[1])))
+    return worst
+
+
+def compare_simplify(fixes, tol):
+    pts = [f[:3] for f in fixes]
+    stream = simplify_stream(pts, tol)
+    ref = simplify_reference(pts, tol)
+    print("simplify:   tolerance %.1f m, window %d" % (tol, WINDOW))
+    for name, kept in (("streaming", stream), ("reference", ref)):
+        print("  %-10s %d -> %d points (%.1fx), max error %.2f m" %
+              (name, len(pts), len(kept), len(pts) / max(len(kept), 1),
+               max_error(pts, kept)))
+
+
+def csv_line(epoch, lat, lon):
+    return "%d,%.6f,%.6f\n" % (epoch, lat / 1e6, lon / 1e6)
+
+
+def read_csv(path):
+    fixes = []
+    with open(path) as f:
+        for line in f:
+            parts = line.strip().split(",")
+            if len(parts) < 3 or not parts[0].isdigit():
+                continue  # header or junk
+            fixes.append((int(parts[0]), round(float(parts[1]) * 1e6),
+                          round(float(parts[2]) * 1e6)))
+    return fixes
+
+
+def summary(fixes, binary_size):
+    n = len(fixes)
+    keys = sum(1 for f in fixes if f[3])
+    csv_size = sum(len(csv_line(*f[:3])) for f in fixes)
+    print("fixes:      %d (%d keyframes)" % (n, keys))
+    if n:
+        print("time span:  %d s" % (fixes[-1][0] - fixes[0][0]))
+        print("binary:     %d B, %.2f B/fix" % (binary_size, binary_size / n))
+        print("csv:        %d B, %.2f B/fix" % (csv_size, csv_size / n))
+        print("ratio:      %.1fx smaller" % (csv_size / max(binary_size, 1)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("files", nargs="*", help="track files, oldest first")
+    ap.add_argument("--csv", help="write the decoded fixes as CSV")
+    ap.add_argument("--simplify", type=float, metavar="METRES",
+                    help="compare streaming and reference simplification")
+    ap.add_argument("--encode", nargs=2, metavar=("CSV", "BIN"),
+                    help="encode a CSV track with the device format")
+    args = ap.parse_args()
+
+    if args.encode:
+        src, dst = args.encode
+        data = encode(read_csv(src))
+        with open(dst, "wb") as f:
+            f.write(data)
+        args.files = [dst]
+
+    fixes = []
+    size = 0
+    for path in args.files:
+        with open(path, "rb") as f:
+            data = f.read()
+        size += len(data)
+        fixes.extend(decode(data))
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("epoch,lat,lon\n")
+            for epoch, lat, lon, _ in fixes:
+                f.write(csv_line(epoch, lat, lon))
+    summary(fixes, size)
+    if args.simplify is not None:
+        compare_simplify(fixes, args.simplify)
+
+
+if __name__ == "__main__":
+    main()
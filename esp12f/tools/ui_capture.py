@@ -0,0 +1,115 @@
+"""
+Captures the esp12f UI off-screen through /frame.pbm and checks it against
+golden images.
+
+    python tools/ui_capture.py 192.168.0.50 out/                   # capture
+    python tools/ui_capture.py 192.168.0.50 out/ --golden golden/   # compare
+    python tools/ui_capture.py 192.168.0.50 out/ --golden golden/ --update
+
+Every face is rendered with every weather icon (and the night one), with
+the clock and the date, using the device's fixed telemetry (fixed=1), so
+the frames only change when the drawing code does. Each frame is saved as
+a PBM named after its state.
+
+The table doubles as the render benchmark: per state, the time render()
+took, the part of it spent on size-2 text, and the GFX calls it made
+(pixels/horizontal lines/vertical lines) as reported by the device.
+
+--golden compares each frame with the PBM of the same name in DIR and
+lists the ones that differ with their pixel count; the exit status is 1 if
+any does. --update writes the captured frames as the new goldens instead.
+The reference set is test/test_ui_render/golden, which the native test
+renders and checks on the host (pio test -e native -f test_ui_render), so
+--golden test/test_ui_render/golden checks a device against the same frames.
+"""
+
+import argparse
+import os
+import sys
+import urllib.request
+
+FACES = ["normal", "happy", "sleepy", "surprised", "look"]  # FaceState
+# One code per day icon (clear, cloudy, fog fallback, rain, storm); at night
+# the icon ignores the code, so one entry covers it
+SKY = [(c, 1) for c in (0, 2, 45, 61, 95)] + [(0, 0)]
+WIDTH, HEIGHT = 128, 64
+
+
+def capture(host, face, weather, day, date):
+    url = "http://%s/frame.pbm?fixed=1&face=%d&weather=%d&day=%d&date=%d" % (
+        host, face, weather, day, date)
+    with urllib.request.urlopen(url, timeout=10) as resp:
+        body = resp.read()
+        stats = (resp.headers.get("X-Render-Micros", "?"),
+                 resp.headers.get("X-Text-Micros", "?"),
+                 resp.headers.get("X-Pixel-Ops", "?"))
+    return body, stats
+
+
+def pixels(pbm):
+    """Raw bitmap of a P4 file written by the device (fixed header)."""
+    header = b"P4\n%d %d\n" % (WIDTH, HEIGHT)
+    if not pbm.startswith(header) or len(pbm) != len(header) + WIDTH * HEIGHT // 8:
+        raise ValueError("not a %dx%d PBM" % (WIDTH, HEIGHT))
+    return pbm[len(header):]
+
+
+def diff(a, b):
+    return sum(bin(x ^ y).count("1") for x, y in zip(pixels(a), pixels(b)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("host", help="device address")
+    ap.add_argument("out", help="directory for the captured frames")
+    ap.add_argument("--golden", help="directory with the reference frames")
+    ap.add_argument("--update", action="store_true",
+                    help="write the captured frames to --golden")
+    args = ap.parse_args()
+    if args.update and not args.golden:
+        ap.error("--update needs --golden")
+
+    os.makedirs(args.out, exist_ok=True)
+    if args.update:
+        os.makedirs(args.golden, exist_ok=True)
+
+    print("%-28s %9s %8s %16s %s" % ("state", "render us", "text us",
+                                     "px/h/v ops", "golden"))
+    failed = 0
+    for face, face_name in enumerate(FACES):
+        for weather, day in SKY:
+            for date in (0, 1):
+                name = "%s_%s_%s.pbm" % (
+                    face_name, "wx%d" % weather if day else "night",
+                    "date" if date else "time")
+                pbm, (render_us, text_us, ops) = capture(
+                    args.host, face, weather, day, date)
+                pixels(pbm)
+                with open(os.path.join(args.out, name), "wb") as f:
+                    f.write(pbm)
+
+                status = ""
+                if args.golden:
+                    path = os.path.join(args.golden, name)
+                    if args.update:
+                        with open(path, "wb") as f:
+                            f.write(pbm)
+                        status = "updated"
+                    elif not os.path.exists(path):
+                        status = "missing"
+                        failed += 1
+                    else:
+                        with open(path, "rb") as f:
+                            n = diff(f.read(), pbm)
+                        status = "ok" if n == 0 else "%d px differ" % n
+                        failed += n != 0
+                print("%-28s %9s %8s %16s %s" % (name[:-4], render_us,
+                                                 text_us, ops, status))
+
+    if args.golden and not args.update:
+        print("%d frame(s) differ from %s" % (failed, args.golden))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())